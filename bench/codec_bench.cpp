@@ -0,0 +1,110 @@
+#include "kafka/protocol/ireadable.hpp"
+#include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/readable_buffer.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace kafka;
+
+constexpr int values_per_buffer = 1024;
+
+// Values of 1 to 5 encoded bytes, like the lengths and offset deltas found in record batches.
+std::vector<VARINT> varint_values() {
+    std::mt19937 rng(1);
+    std::vector<VARINT> values;
+    for (int i = 0; i < values_per_buffer; i++) {
+        values.push_back(static_cast<VARINT>(rng()) >> (rng() % 32));
+    }
+    return values;
+}
+
+template<typename Write>
+BYTES encode(Write write) {
+    WritableBuffer wb;
+    for (int i = 0; i < values_per_buffer; i++) {
+        write(wb, i);
+    }
+    return wb.release();
+}
+
+void BM_WriteVarint(benchmark::State &state) {
+    auto values = varint_values();
+    for (auto _ : state) {
+        WritableBuffer wb;
+        for (VARINT value : values) {
+            write_varint(wb, value);
+        }
+        benchmark::DoNotOptimize(wb.buffer().data());
+    }
+    state.SetItemsProcessed(state.iterations() * values_per_buffer);
+}
+
+void BM_ReadVarint(benchmark::State &state) {
+    auto values = varint_values();
+    BYTES bytes = encode([&](IWritable &writable, int i) { write_varint(writable, values[i]); });
+    for (auto _ : state) {
+        ReadableBuffer rb(bytes);
+        for (int i = 0; i < values_per_buffer; i++) {
+            benchmark::DoNotOptimize(read_varint(rb));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * values_per_buffer);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+void BM_ReadUnsignedVarint(benchmark::State &state) {
+    auto values = varint_values();
+    BYTES bytes = encode([&](IWritable &writable, int i) {
+        write_unsigned_varint(writable, static_cast<UNSIGNED_VARINT>(values[i]));
+    });
+    for (auto _ : state) {
+        ReadableBuffer rb(bytes);
+        for (int i = 0; i < values_per_buffer; i++) {
+            benchmark::DoNotOptimize(read_unsigned_varint(rb));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * values_per_buffer);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+void BM_ReadInt32(benchmark::State &state) {
+    BYTES bytes = encode([](IWritable &writable, int i) { write_int32(writable, i); });
+    for (auto _ : state) {
+        ReadableBuffer rb(bytes);
+        for (int i = 0; i < values_per_buffer; i++) {
+            benchmark::DoNotOptimize(read_int32(rb));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * values_per_buffer);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+// Topic names, the strings requests are mostly made of.
+void BM_ReadCompactString(benchmark::State &state) {
+    std::string name = "benchmark-topic-000000";
+    BYTES bytes = encode([&](IWritable &writable, int) { write_compact_nullable_string(writable, name); });
+    for (auto _ : state) {
+        ReadableBuffer rb(bytes);
+        for (int i = 0; i < values_per_buffer; i++) {
+            benchmark::DoNotOptimize(read_compact_string(rb));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * values_per_buffer);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+}
+
+BENCHMARK(BM_WriteVarint);
+BENCHMARK(BM_ReadVarint);
+BENCHMARK(BM_ReadUnsignedVarint);
+BENCHMARK(BM_ReadInt32);
+BENCHMARK(BM_ReadCompactString);
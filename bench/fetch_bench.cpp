@@ -0,0 +1,114 @@
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/utils.hpp"
+#include "record_batches.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+
+namespace {
+
+using namespace kafka;
+
+constexpr const char *benchmark_topic = "kafka-bench-fetch";
+constexpr const char *benchmark_records_topic = "kafka-bench-fetch-records";
+constexpr int batches_per_log = 16;
+constexpr int records_per_batch = 10;
+constexpr std::size_t record_value_size = 100;
+
+// A temporary log directory, removed with everything in it when the benchmarks end. The
+// broker's own log directory is left alone, since it would recover the logs as partitions.
+class BenchmarkLogDir {
+public:
+    BenchmarkLogDir() {
+        std::string path = (std::filesystem::temp_directory_path() / "kafka-bench-logs-XXXXXX").string();
+        if (!mkdtemp(path.data())) {
+            throw_system_error("mkdtemp");
+        }
+        path_ = path;
+    }
+
+    ~BenchmarkLogDir() {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+
+    // Returns the directory of the log of a partition.
+    std::string partition_dir(const char *topic) const {
+        return (path_ / std::format("{}-0", topic)).string();
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+// Writes (once per topic) a partition log of a few record batches and returns its directory.
+std::string write_benchmark_log(const char *topic, int records) {
+    static BenchmarkLogDir log_dir;
+    static std::mutex mutex;
+    static std::set<std::string> written;
+    std::string partition_dir = log_dir.partition_dir(topic);
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!written.insert(topic).second) {
+        return partition_dir;
+    }
+    std::filesystem::create_directories(partition_dir);
+    BYTES bytes = bench::encode_record_batches(batches_per_log, records, record_value_size);
+    std::ofstream(partition_dir + "/00000000000000000000.log", std::ios::binary)
+        .write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    return partition_dir;
+}
+
+// A fetch of a partition that has no log, as a client probing unknown topics sends.
+void BM_ReadRecordBatchesUnknownPartition(benchmark::State &state) {
+    for (auto _ : state) {
+        auto record_batches = read_record_batches("kafka-bench-unknown-topic", 0);
+        benchmark::DoNotOptimize(record_batches.has_value());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ReadRecordBatches(benchmark::State &state) {
+    std::string partition_dir = write_benchmark_log(benchmark_topic, 0);
+    for (auto _ : state) {
+        auto record_batches = read_record_batches(partition_dir);
+        benchmark::DoNotOptimize(record_batches->size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// The same log with records in its batches, read from the file.
+void BM_ReadRecordBatchesWithRecords(benchmark::State &state) {
+    std::string partition_dir = write_benchmark_log(benchmark_records_topic, records_per_batch);
+    for (auto _ : state) {
+        auto record_batches = read_record_batches(partition_dir);
+        benchmark::DoNotOptimize(record_batches->size());
+    }
+    state.SetItemsProcessed(state.iterations() * batches_per_log);
+}
+
+// The same batches parsed from memory, which leaves out opening and reading the file.
+void BM_ParseRecordBatches(benchmark::State &state) {
+    BYTES bytes = bench::encode_record_batches(batches_per_log, records_per_batch, record_value_size);
+    for (auto _ : state) {
+        auto record_batches = bench::parse_record_batches(bytes, batches_per_log);
+        benchmark::DoNotOptimize(record_batches.data());
+    }
+    state.SetItemsProcessed(state.iterations() * batches_per_log);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+}
+
+BENCHMARK(BM_ReadRecordBatchesUnknownPartition)->Threads(1)->Threads(8)->UseRealTime();
+BENCHMARK(BM_ReadRecordBatches)->Threads(1)->Threads(8)->UseRealTime();
+BENCHMARK(BM_ReadRecordBatchesWithRecords)->Threads(1)->Threads(8)->UseRealTime();
+BENCHMARK(BM_ParseRecordBatches);
@@ -0,0 +1,198 @@
+#include "kafka/message/api_registry.hpp"
+#include "kafka/message/api_versions.hpp"
+#include "kafka/message/describe_topic_partitions.hpp"
+#include "kafka/message/fetch.hpp"
+#include "kafka/message/messages.hpp"
+#include "kafka/message/metadata.hpp"
+#include "record_batches.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+using namespace kafka;
+
+constexpr int partitions_per_topic = 3;
+
+std::string topic_name(std::size_t i) {
+    return std::format("benchmark-topic-{:06}", i);
+}
+
+UUID topic_id(std::size_t i) {
+    UUID uuid{};
+    for (std::size_t byte = 0; byte < sizeof(i); byte++) {
+        uuid.data()[byte] = static_cast<unsigned char>(i >> (8 * byte));
+    }
+    return uuid;
+}
+
+// Requests naming `topic_count` topics of a few partitions each, as a client would send them.
+FetchRequest make_request(std::type_identity<FetchRequest>, std::size_t topic_count) {
+    FetchRequest request;
+    request.max_wait_ms = 500;
+    request.min_bytes = 1;
+    request.max_bytes = 50 << 20;
+    for (std::size_t i = 0; i < topic_count; i++) {
+        auto &topic = request.topics.emplace_back();
+        topic.topic_id = topic_id(i);
+        for (INT32 p = 0; p < partitions_per_topic; p++) {
+            auto &partition = topic.partitions.emplace_back();
+            partition.partition = p;
+            partition.fetch_offset = 1000;
+            partition.partition_max_bytes = 1 << 20;
+        }
+    }
+    return request;
+}
+
+MetadataRequest make_request(std::type_identity<MetadataRequest>, std::size_t topic_count) {
+    MetadataRequest request;
+    request.topics.emplace();
+    for (std::size_t i = 0; i < topic_count; i++) {
+        request.topics->emplace_back().name = topic_name(i);
+    }
+    return request;
+}
+
+ApiVersionsRequest make_request(std::type_identity<ApiVersionsRequest>, std::size_t) {
+    ApiVersionsRequest request;
+    request.client_software_name = "kafka-bench";
+    request.client_software_version = "1.0";
+    return request;
+}
+
+DescribeTopicPartitionsRequest make_request(std::type_identity<DescribeTopicPartitionsRequest>,
+                                            std::size_t topic_count) {
+    DescribeTopicPartitionsRequest request;
+    request.response_partition_limit = 2000;
+    for (std::size_t i = 0; i < topic_count; i++) {
+        request.topics.emplace_back().name = topic_name(i);
+    }
+    return request;
+}
+
+// Encodes a request frame (excluding the size prefix) in the newest version served of its API.
+template<typename Request>
+BYTES encode_request_frame(std::size_t topic_count) {
+    constexpr INT16 version = SupportedApis::versions[*find_api(Request::api_key)].max_version;
+    WritableBuffer wb;
+    write_api_key(wb, Request::api_key);
+    write_int16(wb, version);
+    write_int32(wb, 1);  // Correlation ID.
+    std::string client_id = "kafka-bench";
+    write_int16(wb, static_cast<INT16>(client_id.size()));
+    wb.write(client_id.data(), client_id.size());
+    if (Request::is_flexible(version)) {
+        write_tagged_fields(wb);
+    }
+    make_request(std::type_identity<Request>(), topic_count).write(wb, version);
+    return wb.release();
+}
+
+// Decodes a request frame into its header and request, as a handler thread does first. The
+// frame is copied, since decoding consumes it.
+template<typename Request>
+void BM_DecodeRequest(benchmark::State &state) {
+    BYTES frame = encode_request_frame<Request>(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        RequestMessage request_message;
+        request_message.read(frame);
+        benchmark::DoNotOptimize(&request_message.request());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+
+void BM_EncodeResponse(benchmark::State &state, const ResponseMessage &response) {
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        WritableBuffer wb;
+        response.write(wb);
+        bytes = wb.buffer().size();
+        benchmark::DoNotOptimize(wb.buffer().data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+// A fetch response carrying `topic_count` topics whose partitions each return a few batches.
+void BM_EncodeFetchResponse(benchmark::State &state) {
+    auto topic_count = static_cast<std::size_t>(state.range(0));
+    constexpr int batch_count = 4;
+    auto batches = bench::parse_record_batches(bench::encode_record_batches(batch_count, 10, 100), batch_count);
+    auto response = std::make_unique<FetchResponse>();
+    response->error_code() = ErrorCode::NONE;
+    response->throttle_time_ms() = 0;
+    response->session_id() = 0;
+    for (std::size_t i = 0; i < topic_count; i++) {
+        FetchResponse::FetchableTopicResponse topic{};
+        topic.topic_id() = topic_id(i);
+        for (INT32 p = 0; p < partitions_per_topic; p++) {
+            FetchResponse::PartitionData partition{};
+            partition.partition_index() = p;
+            partition.error_code() = ErrorCode::NONE;
+            partition.records() = batches;
+            topic.partitions().push_back(std::move(partition));
+        }
+        response->responses().push_back(std::move(topic));
+    }
+    BM_EncodeResponse(state, ResponseMessage(ResponseHeader(1), std::move(response)));
+}
+
+// A metadata response whose topics are encoded for this request, as for unknown topics.
+void BM_EncodeMetadataResponse(benchmark::State &state) {
+    auto topic_count = static_cast<std::size_t>(state.range(0));
+    std::array<INT32, partitions_per_topic> partition_ids{0, 1, 2};
+    auto response = std::make_unique<MetadataResponse>(metadata_max_version);
+    response->brokers().emplace_back(1, "localhost", 9092);
+    response->cluster_id() = "kafka-bench-cluster";
+    response->controller_id() = 1;
+    for (std::size_t i = 0; i < topic_count; i++) {
+        response->add_topic(ErrorCode::NONE, std::string_view(topic_name(i)), topic_id(i), partition_ids, 1);
+    }
+    BM_EncodeResponse(state, ResponseMessage(ResponseHeader(1), std::move(response)));
+}
+
+void BM_EncodeDescribeTopicPartitionsResponse(benchmark::State &state) {
+    auto topic_count = static_cast<std::size_t>(state.range(0));
+    auto response = std::make_unique<DescribeTopicPartitionsResponse>();
+    for (std::size_t i = 0; i < topic_count; i++) {
+        auto &topic = response->data().topics.emplace_back();
+        topic.name = topic_name(i);
+        topic.topic_id = topic_id(i);
+        for (INT32 p = 0; p < partitions_per_topic; p++) {
+            topic.partitions.push_back(DescribeTopicPartitionsResponse::leader_only_partition(p, 1));
+        }
+    }
+    BM_EncodeResponse(state, ResponseMessage(ResponseHeader(1), std::move(response)));
+}
+
+void BM_EncodeApiVersionsResponse(benchmark::State &state) {
+    auto response = std::make_unique<ApiVersionsResponse>(ApiVersionsResponseData::max_version);
+    for (const auto &versions : SupportedApis::versions) {
+        auto &api = response->data().api_keys.emplace_back();
+        api.api_key = std::to_underlying(versions.api_key);
+        api.min_version = versions.min_version;
+        api.max_version = versions.max_version;
+    }
+    BM_EncodeResponse(state, ResponseMessage(ResponseHeader(1), std::move(response)));
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_DecodeRequest, FetchRequest)->Arg(1)->Arg(100);
+BENCHMARK_TEMPLATE(BM_DecodeRequest, MetadataRequest)->Arg(1)->Arg(100);
+BENCHMARK_TEMPLATE(BM_DecodeRequest, ApiVersionsRequest)->Arg(0);
+BENCHMARK_TEMPLATE(BM_DecodeRequest, DescribeTopicPartitionsRequest)->Arg(1)->Arg(100);
+BENCHMARK(BM_EncodeFetchResponse)->Arg(1)->Arg(100);
+BENCHMARK(BM_EncodeMetadataResponse)->Arg(1)->Arg(100);
+BENCHMARK(BM_EncodeDescribeTopicPartitionsResponse)->Arg(1)->Arg(100);
+BENCHMARK(BM_EncodeApiVersionsResponse);
@@ -0,0 +1,122 @@
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/protocol/uuid.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using kafka::MetadataSnapshot;
+using kafka::UUID;
+
+constexpr int partitions_per_topic = 3;
+
+struct Dataset {
+    std::vector<std::string> names;
+    std::vector<UUID> ids;
+    MetadataSnapshot snapshot;
+};
+
+UUID random_uuid(std::mt19937_64 &rng) {
+    UUID uuid;
+    for (std::size_t i = 0; i < uuid.size(); i++) {
+        uuid.data()[i] = static_cast<unsigned char>(rng());
+    }
+    return uuid;
+}
+
+// Builds (once per size) a snapshot with `n` topics of a few partitions each.
+const Dataset &dataset(std::size_t n) {
+    static std::map<std::size_t, std::unique_ptr<Dataset>> datasets;
+    auto &dataset = datasets[n];
+    if (!dataset) {
+        dataset = std::make_unique<Dataset>();
+        std::mt19937_64 rng(n);
+        for (std::size_t i = 0; i < n; i++) {
+            dataset->names.push_back(std::format("benchmark-topic-{:06}", i));
+            dataset->ids.push_back(random_uuid(rng));
+            dataset->snapshot.add_topic(dataset->names.back(), dataset->ids.back());
+            for (int p = 0; p < partitions_per_topic; p++) {
+                dataset->snapshot.add_partition(dataset->ids.back(), p);
+            }
+        }
+        dataset->snapshot.seal();
+    }
+    return *dataset;
+}
+
+// Visits the topics in a shuffled order so that lookups aren't served from a warm neighbour.
+std::vector<std::size_t> shuffled_order(std::size_t n) {
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+    return order;
+}
+
+void BM_FindTopicByName(benchmark::State &state) {
+    const Dataset &data = dataset(state.range(0));
+    auto order = shuffled_order(data.names.size());
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto *topic = data.snapshot.find_topic(data.names[order[i++ % order.size()]]);
+        benchmark::DoNotOptimize(data.snapshot.partition_ids(*topic).size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FindTopicById(benchmark::State &state) {
+    const Dataset &data = dataset(state.range(0));
+    auto order = shuffled_order(data.ids.size());
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto *topic = data.snapshot.find_topic(data.ids[order[i++ % order.size()]]);
+        benchmark::DoNotOptimize(data.snapshot.topic_name(*topic).size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FindUnknownTopic(benchmark::State &state) {
+    const Dataset &data = dataset(state.range(0));
+    std::vector<std::string> unknown_names;
+    for (std::size_t i = 0; i < 1024; i++) {
+        unknown_names.push_back(std::format("unknown-topic-{:06}", i));
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(data.snapshot.find_topic(unknown_names[i++ % unknown_names.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Reference point: the ordered-map layout the snapshot used to have.
+void BM_StdMapFindTopicByName(benchmark::State &state) {
+    const Dataset &data = dataset(state.range(0));
+    std::map<std::string, UUID, std::less<>> topic_ids;
+    for (std::size_t i = 0; i < data.names.size(); i++) {
+        topic_ids.emplace(data.names[i], data.ids[i]);
+    }
+    auto order = shuffled_order(data.names.size());
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(topic_ids.find(data.names[order[i++ % order.size()]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK(BM_FindTopicByName)->Arg(1'000)->Arg(50'000)->Arg(500'000);
+BENCHMARK(BM_FindTopicById)->Arg(1'000)->Arg(50'000)->Arg(500'000);
+BENCHMARK(BM_FindUnknownTopic)->Arg(1'000)->Arg(50'000)->Arg(500'000);
+BENCHMARK(BM_StdMapFindTopicByName)->Arg(1'000)->Arg(50'000)->Arg(500'000);
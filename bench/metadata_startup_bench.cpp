@@ -0,0 +1,120 @@
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/metadata/log_tailer.hpp"
+#include "kafka/metadata/snapshot_file.hpp"
+#include "kafka/storage/record_batch_format.hpp"
+#include "loadgen/dataset.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using namespace kafka;
+
+constexpr INT32 partitions_per_topic = 3;
+constexpr INT32 node_id = 1;
+constexpr std::size_t records_per_batch = 1000;
+
+// Appends `topic_count` topics with their partitions to the metadata log in `log_dir`.
+void append_topics(const std::string &log_dir, std::size_t first_topic, std::size_t topic_count, INT64 &next_offset) {
+    std::ofstream log(segment_path(log_dir, 0), std::ios::binary | std::ios::app);
+    std::vector<BYTES> values;
+    auto flush = [&] {
+        BYTES batch = encode_record_batch(next_offset, values);
+        log.write(reinterpret_cast<const char *>(batch.data()), batch.size());
+        next_offset += values.size();
+        values.clear();
+    };
+    for (std::size_t i = first_topic; i < first_topic + topic_count; i++) {
+        values.push_back(loadgen::encode_topic_record(i));
+        for (INT32 p = 0; p < partitions_per_topic; p++) {
+            values.push_back(loadgen::encode_partition_record(i, p, node_id));
+        }
+        if (values.size() >= records_per_batch) {
+            flush();
+        }
+    }
+    if (!values.empty()) {
+        flush();
+    }
+}
+
+void replay(LogTailer &tailer, MetadataSnapshot &snapshot) {
+    std::vector<RecordBatch> record_batches;
+    tailer.read_new_batches(record_batches);
+    for (const auto &record_batch : record_batches) {
+        for (const auto &record : record_batch.records()) {
+            snapshot.apply(record);
+        }
+    }
+    snapshot.seal();
+}
+
+// Creates (once per size) a metadata log of about `record_count` records. A snapshot file
+// covers the first 99% of it, so starting from the snapshot still replays a short suffix.
+const std::string &metadata_log(std::size_t record_count) {
+    static std::map<std::size_t, std::string> log_dirs;
+    auto &log_dir = log_dirs[record_count];
+    if (log_dir.empty()) {
+        static const auto root = std::filesystem::temp_directory_path() / std::format("kafka-bench-{}", getpid());
+        log_dir = (root / std::format("__cluster_metadata-{}", record_count)).string();
+        std::filesystem::create_directories(log_dir);
+        std::atexit([] { std::filesystem::remove_all(root); });
+
+        std::size_t topic_count = record_count / (1 + partitions_per_topic);
+        std::size_t snapshot_topic_count = topic_count * 99 / 100;
+        INT64 next_offset = 0;
+        append_topics(log_dir, 0, snapshot_topic_count, next_offset);
+
+        LogTailer tailer(log_dir);
+        MetadataSnapshot snapshot;
+        replay(tailer, snapshot);
+        MetadataSnapshotFile::write(metadata_snapshot_path(log_dir), snapshot,
+                                    {tailer.segment_base_offset(), tailer.position(), tailer.next_offset(),
+                                     tailer.last_batch()});
+
+        append_topics(log_dir, snapshot_topic_count, topic_count - snapshot_topic_count, next_offset);
+    }
+    return log_dir;
+}
+
+void BM_ColdStartReplayLog(benchmark::State &state) {
+    const std::string &log_dir = metadata_log(state.range(0));
+    for (auto _ : state) {
+        LogTailer tailer(log_dir);
+        MetadataSnapshot snapshot;
+        replay(tailer, snapshot);
+        benchmark::DoNotOptimize(snapshot.topics().size());
+    }
+}
+
+void BM_ColdStartFromSnapshot(benchmark::State &state) {
+    const std::string &log_dir = metadata_log(state.range(0));
+    for (auto _ : state) {
+        LogTailer tailer(log_dir);
+        MetadataSnapshot snapshot;
+        MetadataLogPosition position;
+        if (!MetadataSnapshotFile::read(metadata_snapshot_path(log_dir), snapshot, position) ||
+            !tailer.resume(position.segment_base_offset, position.segment_position, position.next_offset,
+                           position.last_batch)) {
+            state.SkipWithError("invalid snapshot file");
+            return;
+        }
+        replay(tailer, snapshot);
+        benchmark::DoNotOptimize(snapshot.topics().size());
+    }
+}
+
+}
+
+BENCHMARK(BM_ColdStartReplayLog)->Arg(1'000'000)->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(BM_ColdStartFromSnapshot)->Arg(1'000'000)->Unit(benchmark::kMillisecond)->Iterations(3);
@@ -0,0 +1,128 @@
+#include "kafka/metrics/latency_histogram.hpp"
+#include "kafka/network/cpu_topology.hpp"
+#include "kafka/network/mpmc_queue.hpp"
+#include "kafka/protocol/types.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace kafka;
+
+// Where the network and handler threads of a benchmark run.
+enum Placement : std::int64_t {
+    // Both are left to the scheduler.
+    FLOATING,
+    // Both run on the CPUs of the first node.
+    SAME_NODE,
+    // The network thread runs on the first node and the handler thread on the last.
+    CROSS_NODE,
+};
+
+// A mixed load: three small requests for every large, Fetch-sized one.
+constexpr std::size_t small_frame_size = 256;
+constexpr std::size_t large_frame_size = 256 * 1024;
+constexpr std::size_t frames_per_large_frame = 4;
+
+// Restores the affinity of the calling thread when it goes out of scope.
+class AffinityGuard {
+public:
+    AffinityGuard() {
+        pthread_getaffinity_np(pthread_self(), sizeof(saved_), &saved_);
+    }
+
+    ~AffinityGuard() {
+        pthread_setaffinity_np(pthread_self(), sizeof(saved_), &saved_);
+    }
+
+private:
+    cpu_set_t saved_;
+};
+
+// A frame written by a network thread is handed through a queue to a handler thread, which
+// reads it all and hands it back, like a request going to a handler thread and its response
+// coming back. Reports the percentiles of the round trip, which include the cache misses of the
+// handler on memory the network thread wrote.
+void BM_HandoffLatency(benchmark::State &state) {
+    CpuTopology topology = CpuTopology::detect();
+    const auto &nodes = topology.nodes();
+    CpuSlot network_slot;
+    CpuSlot handler_slot;
+    if (state.range(0) == SAME_NODE) {
+        network_slot = handler_slot = CpuSlot{nodes.front().id, nodes.front().cpus};
+    } else if (state.range(0) == CROSS_NODE) {
+        if (nodes.size() < 2) {
+            state.SkipWithError("needs two NUMA nodes");
+            return;
+        }
+        network_slot = CpuSlot{nodes.front().id, nodes.front().cpus};
+        handler_slot = CpuSlot{nodes.back().id, nodes.back().cpus};
+    }
+    AffinityGuard guard;
+    pin_thread(pthread_self(), network_slot);
+
+    MpmcQueue<BYTES *> requests(1);
+    MpmcQueue<BYTES *> responses(1);
+    std::atomic<bool> stopping{false};
+    std::thread handler([&] {
+        BYTES *frame = nullptr;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            if (!requests.try_pop(frame)) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto sum = std::accumulate(frame->begin(), frame->end(), std::uint64_t(0));
+            frame->front() = static_cast<unsigned char>(sum);
+            while (!responses.try_push(std::move(frame))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    pin_thread(handler.native_handle(), handler_slot);
+
+    std::vector<BYTES> frames(frames_per_large_frame, BYTES(small_frame_size));
+    frames.back().resize(large_frame_size);
+    LatencyHistogram histogram;
+    std::size_t next = 0;
+    for (auto _ : state) {
+        BYTES &frame = frames[next++ % frames.size()];
+        auto start = std::chrono::steady_clock::now();
+        std::fill(frame.begin(), frame.end(), static_cast<unsigned char>(next));
+        BYTES *request = &frame;
+        while (!requests.try_push(std::move(request))) {
+            std::this_thread::yield();
+        }
+        BYTES *response = nullptr;
+        while (!responses.try_pop(response)) {
+            std::this_thread::yield();
+        }
+        histogram.record(std::chrono::steady_clock::now() - start);
+    }
+    stopping.store(true);
+    handler.join();
+
+    LatencyHistogram::Snapshot snapshot;
+    histogram.add_to(snapshot);
+    auto microseconds = [&](double quantile) {
+        return std::chrono::duration<double, std::micro>(snapshot.value_at_quantile(quantile)).count();
+    };
+    state.counters["p50_us"] = microseconds(0.5);
+    state.counters["p99_us"] = microseconds(0.99);
+    state.counters["p999_us"] = microseconds(0.999);
+    state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK(BM_HandoffLatency)->Arg(FLOATING)->Arg(SAME_NODE)->Arg(CROSS_NODE)->UseRealTime();
@@ -0,0 +1,39 @@
+#ifndef CODECRAFTERS_KAFKA_BENCH_RECORD_BATCHES_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_BENCH_RECORD_BATCHES_HPP_INCLUDED
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/protocol/readable_buffer.hpp"
+#include "kafka/protocol/types.hpp"
+#include "kafka/storage/record_batch_format.hpp"
+
+namespace kafka::bench {
+
+// Encodes `batch_count` record batches as they are laid out in a partition log, each holding
+// `records_per_batch` records with a null key and a `value_size`-byte value.
+inline BYTES encode_record_batches(int batch_count, int records_per_batch, std::size_t value_size) {
+    std::vector<BYTES> values(records_per_batch, BYTES(value_size, 'v'));
+    BYTES bytes;
+    for (int i = 0; i < batch_count; i++) {
+        BYTES batch = encode_record_batch(static_cast<INT64>(i) * records_per_batch, values);
+        bytes.insert(bytes.end(), batch.begin(), batch.end());
+    }
+    return bytes;
+}
+
+// Parses record batches encoded by `encode_record_batches`.
+inline ARRAY<RecordBatch> parse_record_batches(BYTES bytes, int batch_count) {
+    ReadableBuffer rb(std::move(bytes));
+    ARRAY<RecordBatch> batches(batch_count);
+    for (auto &batch : batches) {
+        batch.read(rb);
+    }
+    return batches;
+}
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_BENCH_RECORD_BATCHES_HPP_INCLUDED
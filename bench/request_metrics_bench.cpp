@@ -0,0 +1,43 @@
+#include "kafka/metrics/request_metrics.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <string>
+
+namespace {
+
+using namespace kafka;
+
+// What the request path adds per request: the clock reads between stages, the five stage
+// latencies and the request and error counters.
+void BM_RecordRequestMetrics(benchmark::State &state) {
+    static RequestMetrics metrics;
+    ErrorCounts error_counts{};
+    for (auto _ : state) {
+        RequestTimes times;
+        times.enqueued = times.dequeued = std::chrono::steady_clock::now();
+        times.decoded = std::chrono::steady_clock::now();
+        times.handled = std::chrono::steady_clock::now();
+        times.encoded = std::chrono::steady_clock::now();
+        metrics.record_request(ApiKey::FETCH, times, error_counts);
+        metrics.record_stage(ApiKey::FETCH, RequestStage::SEND, times.encoded - times.enqueued);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A scrape, which sums the shards of every thread.
+void BM_WritePrometheus(benchmark::State &state) {
+    RequestMetrics metrics;
+    metrics.record_request(ApiKey::FETCH, RequestTimes{}, ErrorCounts{});
+    for (auto _ : state) {
+        std::string out;
+        metrics.write_prometheus(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+}
+
+BENCHMARK(BM_RecordRequestMetrics)->Threads(1)->Threads(8)->UseRealTime();
+BENCHMARK(BM_WritePrometheus);
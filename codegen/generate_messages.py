@@ -0,0 +1,482 @@
+#!/usr/bin/env python3
+"""Generates C++ message classes from Kafka's JSON message schemas.
+
+Usage: generate_messages.py SCHEMA.json OUTPUT.hpp
+
+Every message and nested struct becomes a struct with public fields named in snake_case and
+three member templates per encoding, `read<Version>`, `write<Version>` and `size<Version>`.
+Fields absent from a version and the choice between compact and fixed-width encodings are
+resolved with `if constexpr`, so every version compiles to straight-line code. Run-time
+versions are dispatched through `visit_version`. Tagged fields that a version does not know
+are skipped when read.
+
+Requests keep their schema name. Responses are suffixed with `Data`, as in Kafka's own generator,
+because the response classes that the server sends wrap them.
+"""
+
+import json
+import os
+import re
+import sys
+
+INFINITY = 0x7FFF
+
+PRIMITIVES = {
+    # type: (C++ type, reader, writer, size in bytes)
+    'bool': ('BOOLEAN', 'read_int8({r}) != 0', 'write_boolean({w}, {v})', 1),
+    'int8': ('INT8', 'read_int8({r})', 'write_int8({w}, {v})', 1),
+    'int16': ('INT16', 'read_int16({r})', 'write_int16({w}, {v})', 2),
+    'uint16': ('std::uint16_t', 'read_uint16({r})', 'write_uint16({w}, {v})', 2),
+    'int32': ('INT32', 'read_int32({r})', 'write_int32({w}, {v})', 4),
+    'uint32': ('UINT32', 'read_uint32({r})', 'write_uint32({w}, {v})', 4),
+    'int64': ('INT64', 'read_int64({r})', 'write_int64({w}, {v})', 8),
+    'float64': ('double', 'read_float64({r})', 'write_float64({w}, {v})', 8),
+    'uuid': ('UUID', 'read_uuid({r})', 'write_uuid({w}, {v})', 16),
+}
+
+
+class Versions:
+    """An inclusive range of versions, parsed from strings such as "3+", "0-4", "7" or "none"."""
+
+    def __init__(self, spec):
+        spec = (spec or 'none').strip()
+        if spec == 'none':
+            self.low, self.high = 1, 0
+        elif spec.endswith('+'):
+            self.low, self.high = int(spec[:-1]), INFINITY
+        elif '-' in spec:
+            low, high = spec.split('-')
+            self.low, self.high = int(low), int(high)
+        else:
+            self.low = self.high = int(spec)
+
+    def empty(self):
+        return self.low > self.high
+
+    def intersect(self, other):
+        result = Versions('none')
+        result.low, result.high = max(self.low, other.low), min(self.high, other.high)
+        return result
+
+    def contains(self, other):
+        return other.empty() or (self.low <= other.low and other.high <= self.high)
+
+    def condition(self, valid):
+        """Returns a C++ condition on `Version` that holds for this range within `valid`."""
+        effective = self.intersect(valid)
+        if effective.empty():
+            return 'false'
+        terms = []
+        if effective.low > valid.low:
+            terms.append(f'Version >= {effective.low}')
+        if effective.high < valid.high:
+            terms.append(f'Version <= {effective.high}')
+        return ' && '.join(terms) or 'true'
+
+
+def snake_case(name):
+    name = re.sub(r'([A-Z]+)([A-Z][a-z])', r'\1_\2', name)
+    name = re.sub(r'([a-z0-9])([A-Z])', r'\1_\2', name)
+    return name.lower()
+
+
+def load_schema(path):
+    # Kafka's schemas are JSON with // comments.
+    with open(path) as f:
+        lines = [line for line in f if not line.lstrip().startswith('//')]
+    return json.loads(''.join(lines))
+
+
+class Field:
+    def __init__(self, spec, valid, structs):
+        self.name = spec['name']
+        self.member = snake_case(self.name)
+        self.type = spec['type']
+        self.versions = Versions(spec.get('versions')).intersect(valid)
+        self.nullable = not Versions(spec.get('nullableVersions')).intersect(self.versions).empty()
+        self.tagged = 'tag' in spec
+        self.tag = spec.get('tag')
+        if self.tagged:
+            self.versions = self.versions.intersect(Versions(spec.get('taggedVersions')))
+        self.default = spec.get('default')
+        self.about = spec.get('about', '')
+        self.is_array = self.type.startswith('[]')
+        self.element = self.type[2:] if self.is_array else self.type
+        self.is_struct = self.element not in PRIMITIVES and self.element not in ('string', 'bytes', 'records')
+        if self.is_struct and 'fields' in spec:
+            structs.append(Struct(self.element, spec['fields'], valid, structs))
+
+    def element_cpp(self):
+        if self.element in PRIMITIVES:
+            return PRIMITIVES[self.element][0]
+        if self.element == 'string':
+            return 'std::string'
+        if self.element in ('bytes', 'records'):
+            return 'BYTES'
+        return self.element
+
+    def cpp_type(self):
+        cpp = f'std::vector<{self.element_cpp()}>' if self.is_array else self.element_cpp()
+        if self.nullable and self.element != 'records':
+            cpp = f'std::optional<{cpp}>'
+        return cpp
+
+    def initializer(self):
+        default = self.default
+        if self.nullable and (default is None or default == 'null'):
+            return ''
+        if self.is_array or self.is_struct or self.element in ('bytes', 'records', 'uuid'):
+            return ''
+        if self.element == 'string':
+            return f' = {json.dumps(default)}' if default else ''
+        if self.element == 'bool':
+            return ' = true' if str(default).lower() == 'true' else ' = false'
+        if default in (None, ''):
+            return ' = 0'
+        value = int(str(default), 0)
+        if self.element in ('int64',) and value < -(2 ** 31):
+            return f' = {value}LL'
+        return f' = {value}'
+
+    def is_present(self, value):
+        """C++ condition that holds when `value` differs from the field's default, for tagged fields."""
+        if self.nullable and (self.default is None or self.default == 'null'):
+            return f'{value}.has_value()'
+        if self.is_array:
+            return f'!{value}.empty()'
+        if self.is_struct:
+            return f'{value} != {self.element}()'
+        initializer = self.initializer()
+        return f'{value} != {initializer[3:]}' if initializer else f'{value} != {self.cpp_type()}{{}}'
+
+
+class Struct:
+    def __init__(self, name, field_specs, valid, structs):
+        self.name = name
+        self.fields = [Field(spec, valid, structs) for spec in field_specs]
+
+
+class Generator:
+    def __init__(self, schema):
+        self.schema = schema
+        self.name = schema['name']
+        self.class_name = self.name + 'Data' if schema.get('type') == 'response' else self.name
+        self.valid = Versions(schema['validVersions'])
+        self.flexible = Versions(schema.get('flexibleVersions', 'none'))
+        self.structs = []
+        for common in schema.get('commonStructs', []):
+            self.structs.append(Struct(common['name'], common['fields'], self.valid, self.structs))
+        self.fields = [Field(spec, self.valid, self.structs) for spec in schema.get('fields', [])]
+        self.out = []
+
+    def emit(self, line='', indent=0):
+        self.out.append(('    ' * indent + line) if line else '')
+
+    # Reading ----------------------------------------------------------------------------------
+
+    def read_value(self, field, element, target, indent):
+        """Emits code that reads one value of type `element` into `target`."""
+        if element in PRIMITIVES:
+            self.emit(f'{target} = {PRIMITIVES[element][1].format(r="readable")};', indent)
+        elif element == 'string':
+            reader = 'read_nullable_string_field' if field.nullable and not field.is_array else 'read_string_field'
+            self.emit(f'{target} = {reader}<flexible>(readable);', indent)
+        elif element in ('bytes', 'records'):
+            nullable = field.nullable and not field.is_array and element == 'bytes'
+            reader = 'read_nullable_bytes_field' if nullable else 'read_bytes_field'
+            self.emit(f'{target} = {reader}<flexible>(readable);', indent)
+        else:
+            self.emit(f'{target}.read<Version>(readable);', indent)
+
+    def read_field(self, field, indent):
+        target = field.member
+        if field.is_array:
+            length = f'{target}_length'
+            self.emit(f'INT32 {length} = read_length<flexible>(readable);', indent)
+            self.emit(f'check_length(readable, {length});', indent)
+            if field.nullable:
+                self.emit(f'if ({length} < 0) {{', indent)
+                self.emit(f'{target}.reset();', indent + 1)
+                self.emit('} else {', indent)
+                self.emit(f'{target}.emplace({length});', indent + 1)
+                self.emit(f'for (auto &element : *{target}) {{', indent + 1)
+                self.read_value(field, field.element, 'element', indent + 2)
+                self.emit('}', indent + 1)
+                self.emit('}', indent)
+            else:
+                self.emit(f'{target}.assign(std::max<INT32>({length}, 0), {{}});', indent)
+                self.emit(f'for (auto &element : {target}) {{', indent)
+                self.read_value(field, field.element, 'element', indent + 1)
+                self.emit('}', indent)
+        elif field.is_struct and field.nullable:
+            self.emit(f'if (read_int8(readable) < 0) {{', indent)
+            self.emit(f'{target}.reset();', indent + 1)
+            self.emit('} else {', indent)
+            self.emit(f'{target}.emplace().read<Version>(readable);', indent + 1)
+            self.emit('}', indent)
+        else:
+            self.read_value(field, field.element, target, indent)
+
+    def emit_read(self, fields, indent):
+        self.emit('template<INT16 Version>', indent)
+        self.emit('void read(IReadable &readable) {', indent)
+        self.emit(f'constexpr bool flexible = {self.flexible.condition(self.valid)};', indent + 1)
+        for field in fields:
+            if field.tagged or field.versions.empty():
+                continue
+            self.emit_conditional(field, indent + 1, self.read_field)
+        self.emit('if constexpr (flexible) {', indent + 1)
+        self.emit('for (UNSIGNED_VARINT n = read_unsigned_varint(readable); n > 0; n--) {', indent + 2)
+        self.emit('UNSIGNED_VARINT tag = read_unsigned_varint(readable);', indent + 3)
+        self.emit('UNSIGNED_VARINT size = read_unsigned_varint(readable);', indent + 3)
+        first = True
+        for field in fields:
+            if not field.tagged or field.versions.empty():
+                continue
+            condition = field.versions.condition(self.valid)
+            keyword = 'if' if first else '} else if'
+            self.emit(f'{keyword} (tag == {field.tag} && ({condition})) {{', indent + 3)
+            self.read_field(field, indent + 4)
+            first = False
+        if first:
+            self.emit('static_cast<void>(tag);', indent + 3)
+            self.emit('skip_bytes(readable, size);', indent + 3)
+        else:
+            self.emit('} else {', indent + 3)
+            self.emit('skip_bytes(readable, size);', indent + 4)
+            self.emit('}', indent + 3)
+        self.emit('}', indent + 2)
+        self.emit('}', indent + 1)
+        self.emit('}', indent)
+
+    def emit_conditional(self, field, indent, body):
+        condition = field.versions.condition(self.valid)
+        if condition == 'true':
+            body(field, indent)
+        else:
+            self.emit(f'if constexpr ({condition}) {{', indent)
+            body(field, indent + 1)
+            self.emit('}', indent)
+
+    # Writing ----------------------------------------------------------------------------------
+
+    def write_value(self, field, element, value, indent, nullable):
+        if element in PRIMITIVES:
+            self.emit(PRIMITIVES[element][2].format(w='writable', v=value) + ';', indent)
+        elif element == 'string':
+            writer = 'write_nullable_string_field' if nullable else 'write_string_field'
+            self.emit(f'{writer}<flexible>(writable, {value});', indent)
+        elif element in ('bytes', 'records'):
+            writer = 'write_nullable_bytes_field' if nullable else 'write_bytes_field'
+            self.emit(f'{writer}<flexible>(writable, {value});', indent)
+        else:
+            self.emit(f'{value}.write<Version>(writable);', indent)
+
+    def write_field(self, field, indent):
+        value = field.member
+        if field.is_array:
+            items = f'(*{value})' if field.nullable else value
+            if field.nullable:
+                self.emit(f'if (!{value}) {{', indent)
+                self.emit('write_length<flexible>(writable, -1);', indent + 1)
+                self.emit('} else {', indent)
+                indent += 1
+            self.emit(f'write_length<flexible>(writable, static_cast<INT32>({items}.size()));', indent)
+            self.emit(f'for (const auto &element : {items}) {{', indent)
+            self.write_value(field, field.element, 'element', indent + 1, False)
+            self.emit('}', indent)
+            if field.nullable:
+                self.emit('}', indent - 1)
+        elif field.is_struct and field.nullable:
+            self.emit(f'write_int8(writable, {value} ? 1 : -1);', indent)
+            self.emit(f'if ({value}) {{', indent)
+            self.emit(f'{value}->write<Version>(writable);', indent + 1)
+            self.emit('}', indent)
+        else:
+            nullable = field.nullable and field.element != 'records'
+            self.write_value(field, field.element, value, indent, nullable)
+
+    def tagged_present(self, field):
+        return f'({field.versions.condition(self.valid)}) && {field.is_present(field.member)}'
+
+    def emit_write(self, fields, indent):
+        self.emit('template<INT16 Version>', indent)
+        self.emit('void write(IWritable &writable) const {', indent)
+        self.emit(f'constexpr bool flexible = {self.flexible.condition(self.valid)};', indent + 1)
+        for field in fields:
+            if field.tagged or field.versions.empty():
+                continue
+            self.emit_conditional(field, indent + 1, self.write_field)
+        tagged = [field for field in fields if field.tagged and not field.versions.empty()]
+        self.emit('if constexpr (flexible) {', indent + 1)
+        if not tagged:
+            self.emit('write_unsigned_varint(writable, 0);', indent + 2)
+        else:
+            self.emit('UNSIGNED_VARINT tag_count = 0;', indent + 2)
+            for field in tagged:
+                self.emit(f'tag_count += {self.tagged_present(field)};', indent + 2)
+            self.emit('write_unsigned_varint(writable, tag_count);', indent + 2)
+            for field in sorted(tagged, key=lambda f: f.tag):
+                self.emit(f'if ({self.tagged_present(field)}) {{', indent + 2)
+                self.emit(f'write_unsigned_varint(writable, {field.tag});', indent + 3)
+                self.emit(f'write_unsigned_varint(writable, {self.field_size_expression(field)});', indent + 3)
+                self.write_field(field, indent + 3)
+                self.emit('}', indent + 2)
+        self.emit('}', indent + 1)
+        self.emit('}', indent)
+
+    # Sizes ------------------------------------------------------------------------------------
+
+    def value_size(self, element, value, nullable):
+        if element in PRIMITIVES:
+            return str(PRIMITIVES[element][3])
+        if element == 'string':
+            return f'{"nullable_" if nullable else ""}string_field_size<flexible>({value})'
+        if element in ('bytes', 'records'):
+            return f'{"nullable_" if nullable else ""}bytes_field_size<flexible>({value})'
+        return f'{value}.size<Version>()'
+
+    def field_size_expression(self, field):
+        value = field.member
+        if field.is_array:
+            items = f'(*{value})' if field.nullable else value
+            element_size = self.value_size(field.element, 'element', False)
+            if field.element in PRIMITIVES:
+                total = f'{items}.size() * {element_size}'
+            else:
+                total = (f'[&] {{ std::size_t total = 0; for (const auto &element : {items}) '
+                         f'{{ total += {element_size}; }} return total; }}()')
+            expression = f'length_size<flexible>(static_cast<INT32>({items}.size())) + {total}'
+            if field.nullable:
+                expression = f'({value} ? {expression} : length_size<flexible>(-1))'
+            return expression
+        if field.is_struct and field.nullable:
+            return f'(1 + ({value} ? {value}->size<Version>() : 0))'
+        nullable = field.nullable and field.element != 'records'
+        return self.value_size(field.element, value, nullable)
+
+    def emit_size(self, fields, indent):
+        self.emit('template<INT16 Version>', indent)
+        self.emit('std::size_t size() const {', indent)
+        self.emit(f'constexpr bool flexible = {self.flexible.condition(self.valid)};', indent + 1)
+        self.emit('std::size_t size = 0;', indent + 1)
+        for field in fields:
+            if field.tagged or field.versions.empty():
+                continue
+            self.emit_conditional(field, indent + 1,
+                                  lambda f, i: self.emit(f'size += {self.field_size_expression(f)};', i))
+        tagged = [field for field in fields if field.tagged and not field.versions.empty()]
+        self.emit('if constexpr (flexible) {', indent + 1)
+        self.emit('UNSIGNED_VARINT tag_count = 0;', indent + 2)
+        for field in tagged:
+            self.emit(f'if ({self.tagged_present(field)}) {{', indent + 2)
+            self.emit('tag_count++;', indent + 3)
+            self.emit(f'std::size_t field_size = {self.field_size_expression(field)};', indent + 3)
+            self.emit(f'size += unsigned_varint_size({field.tag}) + unsigned_varint_size(field_size) + field_size;',
+                      indent + 3)
+            self.emit('}', indent + 2)
+        self.emit('size += unsigned_varint_size(tag_count);', indent + 2)
+        self.emit('}', indent + 1)
+        self.emit('return size;', indent + 1)
+        self.emit('}', indent)
+
+    # Classes ----------------------------------------------------------------------------------
+
+    def emit_members(self, fields, indent):
+        for field in fields:
+            if field.versions.empty():
+                continue
+            if field.about:
+                self.emit(f'// {field.about}', indent)
+            self.emit(f'{field.cpp_type()} {field.member}{field.initializer()};', indent)
+
+    def emit_struct(self, struct, indent):
+        self.emit(f'struct {struct.name} {{', indent)
+        self.emit_members(struct.fields, indent + 1)
+        self.emit()
+        self.emit(f'bool operator==(const {struct.name} &other) const = default;', indent + 1)
+        self.emit()
+        self.emit_read(struct.fields, indent + 1)
+        self.emit()
+        self.emit_write(struct.fields, indent + 1)
+        self.emit()
+        self.emit_size(struct.fields, indent + 1)
+        self.emit('};', indent)
+
+    def generate(self, source_name):
+        guard = f'CODECRAFTERS_KAFKA_GENERATED_{snake_case(self.name).upper()}_HPP_INCLUDED'
+        self.emit(f'// Generated by codegen/generate_messages.py from {source_name}. Do not edit.')
+        self.emit()
+        self.emit(f'#ifndef {guard}')
+        self.emit(f'#define {guard}')
+        self.emit()
+        for header in ('algorithm', 'cstddef', 'cstdint', 'optional', 'string', 'vector'):
+            self.emit(f'#include <{header}>')
+        self.emit()
+        for header in ('constants', 'field_codec', 'ireadable', 'iwritable', 'types', 'uuid'):
+            self.emit(f'#include "kafka/protocol/{header}.hpp"')
+        self.emit()
+        self.emit('namespace kafka {')
+        self.emit()
+        self.emit(f'struct {self.class_name} {{')
+        if 'apiKey' in self.schema:
+            self.emit(f'static constexpr ApiKey api_key = static_cast<ApiKey>({self.schema["apiKey"]});', 1)
+        self.emit(f'static constexpr INT16 min_version = {self.valid.low};', 1)
+        self.emit(f'static constexpr INT16 max_version = {self.valid.high};', 1)
+        self.emit()
+        self.emit('// Returns whether a version uses compact lengths and tagged fields.', 1)
+        self.emit('static constexpr bool is_flexible([[maybe_unused]] INT16 version) {', 1)
+        condition = self.flexible.condition(self.valid).replace('Version', 'version')
+        self.emit(f'return {condition};', 2)
+        self.emit('}', 1)
+        for struct in self.structs:
+            self.emit()
+            self.emit_struct(struct, 1)
+        self.emit()
+        self.emit_members(self.fields, 1)
+        self.emit()
+        self.emit_read(self.fields, 1)
+        self.emit()
+        self.emit('// Reads this message in the encoding of `version`.', 1)
+        self.emit('void read(IReadable &readable, INT16 version) {', 1)
+        self.emit('visit_version<min_version, max_version>(version, [&]<INT16 Version>() { read<Version>(readable); });', 2)
+        self.emit('}', 1)
+        self.emit()
+        self.emit_write(self.fields, 1)
+        self.emit()
+        self.emit('// Writes this message in the encoding of `version`.', 1)
+        self.emit('void write(IWritable &writable, INT16 version) const {', 1)
+        self.emit('visit_version<min_version, max_version>(version, [&]<INT16 Version>() { write<Version>(writable); });', 2)
+        self.emit('}', 1)
+        self.emit()
+        self.emit_size(self.fields, 1)
+        self.emit()
+        self.emit('// Returns the number of bytes that `write` produces for `version`.', 1)
+        self.emit('std::size_t size(INT16 version) const {', 1)
+        self.emit('return visit_version<min_version, max_version>(version, [&]<INT16 Version>() { return size<Version>(); });', 2)
+        self.emit('}', 1)
+        self.emit('};')
+        self.emit()
+        self.emit('}')
+        self.emit()
+        self.emit(f'#endif  // {guard}')
+        return '\n'.join(self.out) + '\n'
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(f'usage: {sys.argv[0]} SCHEMA.json OUTPUT.hpp')
+    schema_path, output_path = sys.argv[1:]
+    code = Generator(load_schema(schema_path)).generate(os.path.basename(schema_path))
+    os.makedirs(os.path.dirname(output_path) or '.', exist_ok=True)
+    # Leave an unchanged header alone, so that dependent sources are not rebuilt.
+    if os.path.exists(output_path):
+        with open(output_path) as f:
+            if f.read() == code:
+                return
+    with open(output_path, 'w') as f:
+        f.write(code)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,111 @@
+#ifndef CODECRAFTERS_KAFKA_CONFIG_SERVER_CONFIG_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_CONFIG_SERVER_CONFIG_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Key-value pairs read from a Java-style `.properties` file.
+using Properties = std::map<std::string, std::string>;
+
+// Reads the properties stored in the specified file.
+Properties read_properties(const std::string &path);
+
+// Limits on the traffic of one client ID or user. Zero means unlimited.
+struct ClientQuota {
+    // Response bytes per second.
+    std::size_t byte_rate = 0;
+    // Time spent handling requests, as a percentage of one handler thread.
+    std::size_t request_percentage = 0;
+};
+
+// Broker settings. Names follow the matching `server.properties` keys.
+struct ServerConfig {
+    // `node.id`: the ID of this broker, which also acts as the controller.
+    INT32 node_id = 1;
+    // `advertised.listeners`: host and port that clients are told to connect to.
+    std::string advertised_host = "localhost";
+    INT32 advertised_port = 9092;
+    // `num.network.threads`: threads that own sockets and frame requests.
+    std::size_t num_network_threads = 3;
+    // `num.io.threads`: threads that decode, handle and encode requests.
+    std::size_t num_io_threads = 8;
+    // `queued.max.requests`: requests that may wait for a handler thread.
+    std::size_t queued_max_requests = 500;
+    // `queued.max.request.bytes`: memory of the requests received but not handled yet.
+    // Connections stop being read while their next request does not fit.
+    std::size_t queued_max_request_bytes = 512 * 1024 * 1024;
+    // `socket.request.max.bytes`: the largest request accepted; larger ones close the connection.
+    std::size_t socket_request_max_bytes = 100 * 1024 * 1024;
+    // `output.queue.high.water.bytes`: responses queued for one connection at which it stops
+    // being read until they have been sent.
+    std::size_t output_queue_high_water_bytes = 4 * 1024 * 1024;
+    // `fetch.wait.recheck.ms`: how often a Fetch waiting for `min_bytes` of records reads its
+    // partitions again, until `max_wait_ms` has passed.
+    std::size_t fetch_wait_recheck_ms = 100;
+    // `log.cold.read.drop.bytes`: segments of at least this size that are no longer active and
+    // were not all in the page cache when a Fetch read them are dropped from it after the read,
+    // so that catching up on old segments does not evict the active ones. 0 keeps them.
+    std::size_t log_cold_read_drop_bytes = 0;
+    // `max.request.partition.size.limit`: partitions described by one DescribeTopicPartitions
+    // response, whatever the request asks for.
+    std::size_t max_request_partition_size_limit = 2000;
+    // `client.quota.byte.rate` and `client.quota.request.percentage`: the quota of every
+    // client ID without its own.
+    ClientQuota client_quota_default;
+    // Quotas of single users and client IDs, keyed `user:<name>` or `client-id:<id>`, from
+    // keys such as `client.quota.byte.rate.client-id.<id>`. Unset limits take the default.
+    std::map<std::string, ClientQuota, std::less<>> client_quota_overrides;
+    // `quota.window.num` and `quota.window.size.seconds`: quota rates are measured over this
+    // many windows of this length.
+    std::size_t quota_window_num = 11;
+    std::size_t quota_window_size_seconds = 1;
+    // `metrics.port`: port on 127.0.0.1 that serves the metrics to Prometheus at `/metrics`,
+    // or 0 for none.
+    INT32 metrics_port = 0;
+    // `request.trace.buffer.size`: traces of the latest requests kept per network thread, served
+    // as Chrome trace-event JSON at `/trace` on the metrics port. 0 keeps none.
+    std::size_t request_trace_buffer_size = 4096;
+    // `slow.request.threshold.ms`: requests that take longer from their arrival to the sending
+    // of their response are logged with the time spent in every stage. 0 logs none.
+    std::size_t slow_request_threshold_ms = 1000;
+    // `request.capture.file`: file that every request frame received and response sent is
+    // captured into, for replaying with `kafka_replay`, or empty for none.
+    std::string request_capture_file;
+    // `request.capture.max.bytes`: size of the capture file at most. 0 leaves it unbounded.
+    std::size_t request_capture_max_bytes = std::size_t(1) << 30;
+    // `perf.counters.enable`: counts cycles, instructions, cache misses, branch misses and context
+    // switches per API and stage with `perf_event_open`, served on the metrics port.
+    bool perf_counters_enable = false;
+    // `cpu.affinity.acceptor`, `cpu.affinity.network` and `cpu.affinity.handler`: CPU lists such
+    // as `0-3,8` that the acceptor, network and handler threads run on, spread over the NUMA
+    // nodes of those CPUs. Empty leaves the threads to the scheduler.
+    std::vector<int> cpu_affinity_acceptor;
+    std::vector<int> cpu_affinity_network;
+    std::vector<int> cpu_affinity_handler;
+    // `num.recovery.threads.per.data.dir`: threads that recover partition logs at startup.
+    std::size_t num_recovery_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    // `log.recovery.truncate.enable`: truncates segments at a torn or corrupted batch found at
+    // startup and deletes the segments after it. Otherwise the damage is only reported.
+    bool log_recovery_truncate_enable = false;
+
+    // Builds a `ServerConfig` from properties, keeping defaults for missing keys.
+    static ServerConfig from_properties(const Properties &properties);
+
+    // Builds a `ServerConfig` from the specified `server.properties` file.
+    static ServerConfig load(const std::string &path) {
+        return from_properties(read_properties(path));
+    }
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_CONFIG_SERVER_CONFIG_HPP_INCLUDED
@@ -1,19 +1,26 @@
 #ifndef CODECRAFTERS_KAFKA_MESSAGE_ABSTRACT_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_MESSAGE_ABSTRACT_HPP_INCLUDED
 
+#include <array>
+#include <cstdint>
+#include <span>
+
 #include "kafka/protocol/constants.hpp"
 #include "kafka/protocol/ireadable.hpp"
 #include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/types.hpp"
 
 namespace kafka {
 
-class AbstractRequest {
-public:
-    virtual ~AbstractRequest() = default;
+// Number of each error code in a response, indexed by `error_code_index`.
+using ErrorCounts = std::array<std::uint32_t, error_code_count>;
 
-    // Reads this request from a byte stream.
-    virtual void read(IReadable &readable) = 0;
-};
+// Counts one occurrence of `error_code` unless it is NONE.
+inline void count_error(ErrorCounts &counts, ErrorCode error_code) {
+    if (error_code != ErrorCode::NONE) {
+        counts[error_code_index(error_code)]++;
+    }
+}
 
 class AbstractResponse {
 public:
@@ -24,6 +31,33 @@ public:
 
     // Writes this response to a byte stream.
     virtual void write(IWritable &writable) const = 0;
+
+    // Sets how long the client is throttled for, in the responses that carry it.
+    virtual void set_throttle_time_ms(INT32) {}
+
+    // Adds the error codes of this response, other than NONE, to `counts`, like Kafka's
+    // `AbstractResponse.errorCounts()`.
+    virtual void add_error_counts(ErrorCounts &) const {}
+};
+
+// Response whose body was encoded in advance.
+class EncodedResponse : public AbstractResponse {
+public:
+    EncodedResponse(ApiKey api_key, std::span<const unsigned char> body) : api_key_(api_key), body_(body) {}
+
+    // The API key of this `EncodedResponse`.
+    constexpr ApiKey api_key() const override {
+        return api_key_;
+    }
+
+    // Writes this `EncodedResponse` to a byte stream.
+    void write(IWritable &writable) const override {
+        writable.write(body_.data(), body_.size());
+    }
+
+private:
+    ApiKey api_key_;
+    std::span<const unsigned char> body_;
 };
 
 }
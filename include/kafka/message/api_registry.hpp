@@ -0,0 +1,134 @@
+#ifndef CODECRAFTERS_KAFKA_MESSAGE_API_REGISTRY_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_MESSAGE_API_REGISTRY_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <variant>
+
+#include "kafka/generated/api_versions_request.hpp"
+#include "kafka/generated/describe_topic_partitions_request.hpp"
+#include "kafka/generated/fetch_request.hpp"
+#include "kafka/generated/metadata_request.hpp"
+#include "kafka/message/fetch.hpp"
+#include "kafka/message/metadata.hpp"
+#include "kafka/protocol/constants.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// One supported API: its key, the versions served and the type its requests decode into,
+// which is generated from the API's message schema. The versions served are only those the
+// API's response can be written in.
+template<ApiKey Key, INT16 MinVersion, INT16 MaxVersion, typename Request>
+struct ApiSpec {
+    static_assert(Request::api_key == Key, "the request type belongs to another API");
+    static_assert(Request::min_version <= MinVersion && MaxVersion <= Request::max_version,
+                  "the request type cannot decode every version served");
+
+    static constexpr ApiKey api_key = Key;
+    static constexpr INT16 min_version = MinVersion;
+    static constexpr INT16 max_version = MaxVersion;
+    using request_type = Request;
+};
+
+// Key and versions of a supported API, as advertised by ApiVersions.
+struct ApiVersionRange {
+    ApiKey api_key;
+    INT16 min_version;
+    INT16 max_version;
+};
+
+template<typename... Specs>
+struct ApiList {
+    // Holds a decoded request of any of the APIs, in place.
+    using request_variant = std::variant<typename Specs::request_type...>;
+
+    static constexpr std::size_t size = sizeof...(Specs);
+
+    static constexpr std::array<ApiVersionRange, size> versions = {
+        ApiVersionRange{Specs::api_key, Specs::min_version, Specs::max_version}...};
+};
+
+// Every API this broker serves. An API added here is decoded into its request type and
+// advertised by ApiVersions, and the server fails to compile until it handles that type.
+using SupportedApis = ApiList<
+    ApiSpec<ApiKey::FETCH, fetch_min_version, fetch_max_version, FetchRequest>,
+    ApiSpec<ApiKey::METADATA, metadata_min_version, metadata_max_version, MetadataRequest>,
+    ApiSpec<ApiKey::API_VERSIONS, 0, 4, ApiVersionsRequest>,
+    ApiSpec<ApiKey::DESCRIBE_TOPIC_PARTITIONS, 0, 0, DescribeTopicPartitionsRequest>>;
+
+using RequestVariant = SupportedApis::request_variant;
+
+namespace detail {
+
+inline constexpr INT16 max_supported_api_key =
+    std::to_underlying(std::ranges::max(SupportedApis::versions, {}, &ApiVersionRange::api_key).api_key);
+
+// Position in `SupportedApis` of every API key up to the largest one, or -1.
+inline constexpr auto api_positions = [] {
+    std::array<INT8, max_supported_api_key + 1> positions{};
+    positions.fill(-1);
+    for (std::size_t i = 0; i < SupportedApis::size; i++) {
+        positions[std::to_underlying(SupportedApis::versions[i].api_key)] = static_cast<INT8>(i);
+    }
+    return positions;
+}();
+
+template<std::size_t Position>
+RequestVariant make_request() {
+    return RequestVariant(std::in_place_index<Position>);
+}
+
+template<std::size_t... Positions>
+constexpr auto make_request_factories(std::index_sequence<Positions...>) {
+    return std::array<RequestVariant (*)(), sizeof...(Positions)>{&make_request<Positions>...};
+}
+
+}
+
+// Returns the position in `SupportedApis` of an API, or std::nullopt if it is not supported.
+constexpr std::optional<std::size_t> find_api(ApiKey api_key) {
+    auto key = std::to_underlying(api_key);
+    if (key < 0 || key > detail::max_supported_api_key || detail::api_positions[key] < 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(detail::api_positions[key]);
+}
+
+// Creates an empty request of the API at `position` in `SupportedApis`, ready to be read.
+inline RequestVariant make_request(std::size_t position) {
+    static constexpr auto factories =
+        detail::make_request_factories(std::make_index_sequence<SupportedApis::size>());
+    return factories[position]();
+}
+
+// Body of a successful ApiVersions response (versions 3 and later) listing `SupportedApis`,
+// encoded at compile time.
+inline constexpr auto api_versions_response_body = [] {
+    static_assert(SupportedApis::size + 1 < 0x80, "the array length must fit in one varint byte");
+    constexpr std::size_t entry_size = 3 * sizeof(INT16) + 1;
+    std::array<unsigned char, sizeof(INT16) + 1 + SupportedApis::size * entry_size + sizeof(INT32) + 1> body{};
+    std::size_t n = 0;
+    auto put_int16 = [&](INT16 value) {
+        body[n++] = static_cast<unsigned char>(static_cast<std::uint16_t>(value) >> 8);
+        body[n++] = static_cast<unsigned char>(value);
+    };
+    put_int16(std::to_underlying(ErrorCode::NONE));
+    body[n++] = static_cast<unsigned char>(SupportedApis::size + 1);
+    for (const auto &range : SupportedApis::versions) {
+        put_int16(std::to_underlying(range.api_key));
+        put_int16(range.min_version);
+        put_int16(range.max_version);
+        body[n++] = 0;  // No tagged fields.
+    }
+    // Zero throttle_time_ms and no tagged fields are already in place.
+    return body;
+}();
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_MESSAGE_API_REGISTRY_HPP_INCLUDED
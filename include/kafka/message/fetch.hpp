@@ -1,6 +1,7 @@
 #ifndef CODECRAFTERS_KAFKA_MESSAGE_FETCH_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_MESSAGE_FETCH_HPP_INCLUDED
 
+#include "kafka/generated/fetch_request.hpp"
 #include "kafka/message/abstract.hpp"
 #include "kafka/metadata/cluster_metadata.hpp"
 #include "kafka/protocol/constants.hpp"
@@ -11,99 +12,10 @@
 
 namespace kafka {
 
-class FetchRequest : public AbstractRequest {
-public:
-    class FetchPartition {
-    public:
-        // Reads this `FetchPartition` from a byte stream.
-        void read(IReadable &readable) {
-            partition_ = read_int32(readable);
-            current_leader_epoch_ = read_int32(readable);
-            fetch_offset_ = read_int64(readable);
-            last_fetched_epoch_ = read_int32(readable);
-            log_start_offset_ = read_int64(readable);
-            partition_max_bytes_ = read_int32(readable);
-            read_tagged_fields(readable);
-        }
-
-        const INT32 &partition() const {
-            return partition_;
-        }
-
-    private:
-        INT32 partition_;
-        INT32 current_leader_epoch_;
-        INT64 fetch_offset_;
-        INT32 last_fetched_epoch_;
-        INT64 log_start_offset_;
-        INT32 partition_max_bytes_;
-    };
-
-    class FetchTopic {
-    public:
-        // Reads this `FetchTopic` from a byte stream.
-        void read(IReadable &readable) {
-            topic_id_ = read_uuid(readable);
-            partitions_ = read_compact_array<FetchPartition>(readable);
-            read_tagged_fields(readable);
-        }
-
-        const UUID &topic_id() const {
-            return topic_id_;
-        }
-
-        const COMPACT_ARRAY<FetchPartition> &partitions() const {
-            return partitions_;
-        }
-
-    private:
-        UUID topic_id_;
-        COMPACT_ARRAY<FetchPartition> partitions_;
-    };
-
-    class ForgottonTopic {
-    public:
-        // Reads this `ForgottonTopic` from a byte stream.
-        void read(IReadable &readable) {
-            topic_id_ = read_uuid(readable);
-            partitions_ = read_compact_array(readable, ReadObjectFunction<INT32>(read_int32));
-            read_tagged_fields(readable);
-        }
-
-    private:
-        UUID topic_id_;
-        COMPACT_ARRAY<INT32> partitions_;
-    };
-
-    // Reads this `FetchRequest` from a byte stream.
-    void read(IReadable &readable) override {
-        max_wait_ms_ = read_int32(readable);
-        min_bytes_ = read_int32(readable);
-        max_bytes_ = read_int32(readable);
-        isolation_level_ = read_int8(readable);
-        session_id_ = read_int32(readable);
-        session_epoch_ = read_int32(readable);
-        topics_ = read_compact_array<FetchTopic>(readable);
-        forgotten_topics_data_ = read_compact_array<ForgottonTopic>(readable);
-        rack_id_ = read_compact_string(readable);
-        read_tagged_fields(readable);
-    }
-
-    const COMPACT_ARRAY<FetchTopic> &topics() const {
-        return topics_;
-    }
-
-private:
-    INT32 max_wait_ms_;
-    INT32 min_bytes_;
-    INT32 max_bytes_;
-    INT8 isolation_level_;
-    INT32 session_id_;
-    INT32 session_epoch_;
-    COMPACT_ARRAY<FetchTopic> topics_;
-    COMPACT_ARRAY<ForgottonTopic> forgotten_topics_data_;
-    COMPACT_STRING rack_id_;
-};
+// Fetch versions served. All of them use the flexible (compact) encoding and identify topics by
+// ID, which is the only layout `FetchResponse` writes.
+inline constexpr INT16 fetch_min_version = 13;
+inline constexpr INT16 fetch_max_version = 16;
 
 class FetchResponse : public AbstractResponse {
 public:
@@ -148,15 +60,22 @@ public:
             return records_;
         }
 
+        MemoryCharge &records_memory() {
+            return records_memory_;
+        }
+
     private:
+        friend class FetchResponse;
+
         INT32 partition_index_;
         ErrorCode error_code_;
-        INT64 high_watermark_;
-        INT64 last_stable_offset_;
-        INT64 log_start_offset_;
+        INT64 high_watermark_ = 0;
+        INT64 last_stable_offset_ = 0;
+        INT64 log_start_offset_ = 0;
         COMPACT_ARRAY<AbortedTransaction> aborted_transactions_;
-        INT32 preferred_read_replica_;
+        INT32 preferred_read_replica_ = -1;
         COMPACT_ARRAY<RecordBatch> records_;
+        MemoryCharge records_memory_;
     };
 
     class FetchableTopicResponse {
@@ -177,6 +96,8 @@ public:
         }
 
     private:
+        friend class FetchResponse;
+
         UUID topic_id_;
         COMPACT_ARRAY<PartitionData> partitions_;
     };
@@ -199,6 +120,21 @@ public:
         return throttle_time_ms_;
     }
 
+    // Sets the throttle time of this `FetchResponse`.
+    void set_throttle_time_ms(INT32 throttle_time_ms) override {
+        throttle_time_ms_ = throttle_time_ms;
+    }
+
+    // Adds the error codes of this `FetchResponse` and its partitions to `counts`.
+    void add_error_counts(ErrorCounts &counts) const override {
+        count_error(counts, error_code_);
+        for (const auto &topic : responses_) {
+            for (const auto &partition : topic.partitions_) {
+                count_error(counts, partition.error_code_);
+            }
+        }
+    }
+
     ErrorCode &error_code() {
         return error_code_;
     }
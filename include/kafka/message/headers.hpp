@@ -10,13 +10,13 @@ namespace kafka {
 
 class RequestHeader {
 public:
-    // Reads this `RequestHeader` from a byte stream.
+    // Reads this `RequestHeader` from a byte stream, up to the tagged fields that only the
+    // headers of flexible versions have.
     void read(IReadable &readable) {
         request_api_key_ = read_api_key(readable);
         request_api_version_ = read_int16(readable);
         correlation_id_ = read_int32(readable);
         client_id_ = read_nullable_string(readable);
-        read_tagged_fields(readable);
     }
 
     const ApiKey &request_api_key() const {
@@ -31,6 +31,10 @@ public:
         return correlation_id_;
     }
 
+    const NULLABLE_STRING &client_id() const {
+        return client_id_;
+    }
+
 private:
     ApiKey request_api_key_;
     INT16 request_api_version_;
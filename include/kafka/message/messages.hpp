@@ -3,11 +3,10 @@
 
 #include <memory>
 #include <utility>
+#include <variant>
 
 #include "kafka/message/abstract.hpp"
-#include "kafka/message/api_versions.hpp"
-#include "kafka/message/describe_topic_partitions.hpp"
-#include "kafka/message/fetch.hpp"
+#include "kafka/message/api_registry.hpp"
 #include "kafka/message/headers.hpp"
 #include "kafka/protocol/constants.hpp"
 #include "kafka/protocol/ireadable.hpp"
@@ -19,36 +18,50 @@ namespace kafka {
 
 class RequestMessage {
 public:
-    // Reads this `RequestMessage` (including the size prefix) from a byte stream.
-    void read(IReadable &readable) {
-        ReadableBuffer rb(read_bytes(readable));
+    // Reads this `RequestMessage` from a complete frame (excluding the size prefix).
+    void read(BYTES frame) {
+        ReadableBuffer rb(std::move(frame));
         header_.read(rb);
-        switch (header_.request_api_key()) {
-            case ApiKey::FETCH:
-                request_ = std::make_unique<FetchRequest>();
-                break;
-            case ApiKey::API_VERSIONS:
-                request_ = std::make_unique<ApiVersionsRequest>();
-                break;
-            case ApiKey::DESCRIBE_TOPIC_PARTITIONS:
-                request_ = std::make_unique<DescribeTopicPartitionsRequest>();
-                break;
+        auto position = find_api(header_.request_api_key());
+        if (!position) {
+            throw_runtime_error("unsupported API key");
         }
-        request_->read(rb);
+        request_ = make_request(*position);
+        INT16 version = header_.request_api_version();
+        const auto &versions = SupportedApis::versions[*position];
+        if (version < versions.min_version || version > versions.max_version) {
+            // ApiVersions answers any version, so that clients can find the supported ones.
+            if (header_.request_api_key() != ApiKey::API_VERSIONS) {
+                throw_runtime_error("unsupported API version");
+            }
+            return;
+        }
+        std::visit([&](auto &request) {
+            // Flexible versions use the request header that ends with tagged fields.
+            if (request.is_flexible(version)) {
+                read_tagged_fields(rb);
+            }
+            request.read(rb, version);
+        }, request_);
     }
 
     const RequestHeader &header() const {
         return header_;
     }
 
+    // Returns the decoded request, whose type is that of its API in `SupportedApis`.
+    const RequestVariant &request() const {
+        return request_;
+    }
+
     template<class ConcreteRequest>
     const ConcreteRequest *request() const {
-        return dynamic_cast<ConcreteRequest *>(request_.get());
+        return std::get_if<ConcreteRequest>(&request_);
     }
 
 private:
     RequestHeader header_;
-    std::unique_ptr<AbstractRequest> request_;
+    RequestVariant request_;
 };
 
 class ResponseMessage {
@@ -65,6 +78,16 @@ public:
         write_bytes(writable, wb.buffer());
     }
 
+    // Sets how long the client is throttled for, if the response carries it.
+    void set_throttle_time_ms(INT32 throttle_time_ms) {
+        response_->set_throttle_time_ms(throttle_time_ms);
+    }
+
+    // Adds the error codes of the response, other than NONE, to `counts`.
+    void add_error_counts(ErrorCounts &counts) const {
+        response_->add_error_counts(counts);
+    }
+
 private:
     ResponseHeader header_;
     std::unique_ptr<AbstractResponse> response_;
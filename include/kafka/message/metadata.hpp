@@ -0,0 +1,180 @@
+#ifndef CODECRAFTERS_KAFKA_MESSAGE_METADATA_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_MESSAGE_METADATA_HPP_INCLUDED
+
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "kafka/generated/metadata_request.hpp"
+#include "kafka/message/abstract.hpp"
+#include "kafka/protocol/constants.hpp"
+#include "kafka/protocol/ireadable.hpp"
+#include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/types.hpp"
+#include "kafka/protocol/uuid.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+#include "kafka/utils.hpp"
+
+namespace kafka {
+
+// Metadata versions served. All of them use the flexible (compact) encoding.
+inline constexpr INT16 metadata_min_version = 9;
+inline constexpr INT16 metadata_max_version = 12;
+
+// Value of `topic_authorized_operations` when the client did not ask for them.
+inline constexpr INT32 authorized_operations_omitted = std::numeric_limits<INT32>::min();
+
+class MetadataResponse : public AbstractResponse {
+public:
+    class MetadataResponseBroker {
+    public:
+        MetadataResponseBroker(INT32 node_id, COMPACT_STRING host, INT32 port)
+            : node_id_(node_id), host_(std::move(host)), port_(port) {}
+
+        // Writes this `MetadataResponseBroker` to a byte stream.
+        void write(IWritable &writable) const {
+            write_int32(writable, node_id_);
+            write_compact_nullable_string(writable, host_);
+            write_int32(writable, port_);
+            write_unsigned_varint(writable, 0);  // Null rack.
+            write_tagged_fields(writable);
+        }
+
+    private:
+        INT32 node_id_;
+        COMPACT_STRING host_;
+        INT32 port_;
+    };
+
+    explicit MetadataResponse(INT16 version) : version_(version) {}
+
+    // Writes one entry of the `topics` array. Every partition is led by `leader_id`, which is
+    // also its only replica. A null `name` is written as null from v12 on, where the field
+    // becomes nullable, and as an empty string before.
+    static void write_topic(IWritable &writable, INT16 version, ErrorCode error_code,
+                            const std::optional<std::string_view> &name, const UUID &topic_id,
+                            std::span<const INT32> partition_ids, INT32 leader_id) {
+        write_error_code(writable, error_code);
+        if (name) {
+            write_unsigned_varint(writable, name->size() + 1);
+            writable.write(name->data(), name->size());
+        } else {
+            write_unsigned_varint(writable, version >= 12 ? 0 : 1);
+        }
+        if (version >= 10) {
+            write_uuid(writable, topic_id);
+        }
+        write_boolean(writable, name && name->starts_with("__"));
+        write_unsigned_varint(writable, partition_ids.size() + 1);
+        for (INT32 partition_id : partition_ids) {
+            write_error_code(writable, ErrorCode::NONE);
+            write_int32(writable, partition_id);
+            write_int32(writable, leader_id);
+            write_int32(writable, 0);  // Leader epoch.
+            for (int replica_list = 0; replica_list < 2; replica_list++) {  // Replicas and ISR.
+                write_unsigned_varint(writable, 2);
+                write_int32(writable, leader_id);
+            }
+            write_unsigned_varint(writable, 1);  // No offline replicas.
+            write_tagged_fields(writable);
+        }
+        write_int32(writable, authorized_operations_omitted);
+        write_tagged_fields(writable);
+    }
+
+    // The API key of this `MetadataResponse`.
+    constexpr ApiKey api_key() const override {
+        return ApiKey::METADATA;
+    }
+
+    // Writes this `MetadataResponse` to a byte stream.
+    void write(IWritable &writable) const override {
+        write_int32(writable, throttle_time_ms_);
+        write_compact_array(writable, brokers_);
+        if (cluster_id_.empty()) {
+            write_unsigned_varint(writable, 0);
+        } else {
+            write_compact_nullable_string(writable, cluster_id_);
+        }
+        write_int32(writable, controller_id_);
+        write_unsigned_varint(writable, topic_count_ + 1);
+        for (auto topics : topics_) {
+            writable.write(topics.data(), topics.size());
+        }
+        if (version_ <= 10) {
+            write_int32(writable, authorized_operations_omitted);
+        }
+        write_tagged_fields(writable);
+    }
+
+    INT32 &throttle_time_ms() {
+        return throttle_time_ms_;
+    }
+
+    // Sets the throttle time of this `MetadataResponse`.
+    void set_throttle_time_ms(INT32 throttle_time_ms) override {
+        throttle_time_ms_ = throttle_time_ms;
+    }
+
+    COMPACT_ARRAY<MetadataResponseBroker> &brokers() {
+        return brokers_;
+    }
+
+    // The cluster ID. An empty ID is written as null.
+    COMPACT_NULLABLE_STRING &cluster_id() {
+        return cluster_id_;
+    }
+
+    INT32 &controller_id() {
+        return controller_id_;
+    }
+
+    // Appends `count` topic entries that are already encoded with `write_topic`. The bytes are
+    // not copied, so `owner` is kept alive with the response.
+    void add_encoded_topics(std::span<const unsigned char> topics, std::size_t count,
+                            std::shared_ptr<const void> owner) {
+        topics_.push_back(topics);
+        topic_count_ += count;
+        if (owner && (owners_.empty() || owners_.back() != owner)) {
+            owners_.push_back(std::move(owner));
+        }
+    }
+
+    // Adds the error codes of the topics of this `MetadataResponse` to `counts`. Topics added
+    // already encoded never carry an error.
+    void add_error_counts(ErrorCounts &counts) const override {
+        for (std::size_t i = 0; i < error_code_count; i++) {
+            counts[i] += topic_error_counts_[i];
+        }
+    }
+
+    // Encodes one topic entry and appends it.
+    template<typename... Args>
+    void add_topic(ErrorCode error_code, Args &&...args) {
+        count_error(topic_error_counts_, error_code);
+        WritableBuffer wb;
+        write_topic(wb, version_, error_code, std::forward<Args>(args)...);
+        auto bytes = std::make_shared<const BYTES>(wb.release());
+        add_encoded_topics(*bytes, 1, bytes);
+    }
+
+private:
+    INT16 version_;
+    INT32 throttle_time_ms_ = 0;
+    COMPACT_ARRAY<MetadataResponseBroker> brokers_;
+    COMPACT_NULLABLE_STRING cluster_id_;
+    INT32 controller_id_ = -1;
+    // Gather list of encoded topic entries and the objects that own their bytes.
+    std::vector<std::span<const unsigned char>> topics_;
+    std::size_t topic_count_ = 0;
+    std::vector<std::shared_ptr<const void>> owners_;
+    ErrorCounts topic_error_counts_{};
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_MESSAGE_METADATA_HPP_INCLUDED
@@ -1,10 +1,24 @@
 #ifndef CODECRAFTERS_KAFKA_METADATA_CLUSTER_METADATA_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_METADATA_CLUSTER_METADATA_HPP_INCLUDED
 
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+#include "kafka/metadata/flat_hash_index.hpp"
+#include "kafka/metrics/memory_accounting.hpp"
+#include "kafka/protocol/constants.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
 #include "kafka/protocol/ireadable.hpp"
 #include "kafka/protocol/iwritable.hpp"
 #include "kafka/protocol/types.hpp"
@@ -29,7 +43,8 @@ public:
         }
 
         value_len_ = read_varint(readable);
-        value_.resize(value_len_);
+        check_length(readable, value_len_);
+        value_.resize(std::max<VARINT>(value_len_, 0));
         readable.read(value_.data(), value_.size());
 
         readable.read(&c, sizeof(c));
@@ -104,6 +119,22 @@ public:
         write_array(writable, records_);
     }
 
+    const INT64 &base_offset() const {
+        return base_offset_;
+    }
+
+    const INT32 &batch_length() const {
+        return batch_length_;
+    }
+
+    const INT32 &last_offset_delta() const {
+        return last_offset_delta_;
+    }
+
+    const INT64 &max_timestamp() const {
+        return max_timestamp_;
+    }
+
     const ARRAY<Record> &records() const {
         return records_;
     }
@@ -124,9 +155,136 @@ private:
     ARRAY<Record> records_;
 };
 
-// Reads every `RecordBatch` that belongs to a given partition.
-std::vector<RecordBatch> read_record_batches(const std::string &topic_name, INT32 partition_index);
+// Directory that holds the logs of every partition.
+inline constexpr const char *default_log_dir = "/tmp/kraft-combined-logs";
+
+// Returns the directory that holds the log of a given partition.
+std::string partition_log_dir(std::string_view topic_name, INT32 partition_index);
+
+// Reads every complete `RecordBatch` that belongs to a given partition. Returns
+// UNKNOWN_TOPIC_OR_PARTITION if the partition has no log here, without throwing.
+std::expected<std::vector<RecordBatch>, ErrorCode> read_record_batches(std::string_view topic_name,
+                                                                       INT32 partition_index);
+
+// Reads every complete `RecordBatch` of the partition log in `partition_dir`, as above.
+std::expected<std::vector<RecordBatch>, ErrorCode> read_record_batches(const std::string &partition_dir);
+
+// Immutable view of the cluster metadata at one point in time. Results point into the
+// snapshot, so they stay valid for as long as the caller holds it.
+//
+// Topics are stored contiguously and found through flat hash indexes by name and by UUID.
+// Partitions are kept as parallel arrays sorted by topic and partition ID, so the partitions
+// of a topic form one contiguous range. A name-ordered permutation of the topics supports
+// listing them in name order and resuming such a listing from a name.
+class MetadataSnapshot {
+public:
+    struct Topic {
+        UUID topic_id;
+        // Location of the name in the name arena.
+        std::uint32_t name_offset;
+        std::uint32_t name_size;
+        // Location of the partitions in the partition arrays.
+        std::uint32_t first_partition;
+        std::uint32_t partition_count;
+    };
+
+    // The version of this snapshot. Every published snapshot has a higher version.
+    std::uint64_t version() const {
+        return version_;
+    }
+
+    // Returns every topic, in creation order.
+    std::span<const Topic> topics() const {
+        return topics_;
+    }
+
+    // Returns the positions in `topics()` of every topic, ordered by name.
+    std::span<const std::uint32_t> topics_by_name() const {
+        return topic_name_order_;
+    }
+
+    // Finds the topic with the specified name. Returns nullptr if there is none.
+    const Topic *find_topic(std::string_view topic_name) const;
+
+    // Finds the topic with the specified UUID. Returns nullptr if there is none.
+    const Topic *find_topic(const UUID &topic_id) const;
+
+    // Gets the name of a topic of this snapshot.
+    std::string_view topic_name(const Topic &topic) const {
+        return std::string_view(names_).substr(topic.name_offset, topic.name_size);
+    }
+
+    // Gets the partition IDs of a topic of this snapshot, in ascending order.
+    std::span<const INT32> partition_ids(const Topic &topic) const {
+        return std::span<const INT32>(partition_ids_).subspan(topic.first_partition, topic.partition_count);
+    }
+
+    // Adds a topic. Topics that already exist are left unchanged.
+    void add_topic(std::string_view topic_name, const UUID &topic_id);
+
+    // Adds a partition to an existing topic. Takes effect in lookups after `seal()`.
+    void add_partition(const UUID &topic_id, INT32 partition_id);
+
+    // Applies a record of the `__cluster_metadata` log to this snapshot. A record that can't be
+    // decoded throws before the snapshot is changed.
+    void apply(const Record &record);
+
+    // Sorts the topics and partitions added since the last call and recomputes partition ranges.
+    void seal();
+
+private:
+    friend class ClusterMetadata;
+    friend class MetadataSnapshotFile;
+
+    std::uint64_t version_ = 0;
+    std::vector<Topic> topics_;
+    std::string names_;
+    FlatHashIndex topics_by_name_;
+    FlatHashIndex topics_by_id_;
+    // Covers the topics before `topic_name_order_.size()`; later ones are added by `seal()`.
+    std::vector<std::uint32_t> topic_name_order_;
+    // Parallel arrays: the index of the owning topic and the ID of every partition.
+    std::vector<std::uint32_t> partition_topics_;
+    std::vector<INT32> partition_ids_;
+    bool sealed_ = true;
+    // The bytes of the arrays and indexes, charged to the metadata for as long as this lives.
+    MemoryCharge memory_{MemoryCategory::METADATA, 0};
+
+    // Rebuilds both hash indexes and the name order from the topic array.
+    void rebuild_indexes();
+
+    // Adds the topics created since the last call to the name order.
+    void sort_new_topic_names();
+
+    // Charges the bytes this snapshot holds now.
+    void account_memory();
+};
+
+// Progress of applying the `__cluster_metadata` log.
+struct MetadataApplyStats {
+    // Offset after the last applied record.
+    INT64 next_offset;
+    // Records applied since startup.
+    std::uint64_t records_applied;
+    // Records skipped since startup because they could not be decoded.
+    std::uint64_t records_skipped;
+    // Records applied per second over the last measurement window.
+    double records_per_second;
+    // Milliseconds between the append of the newest applied record and now.
+    INT64 apply_lag_ms;
+};
+
+class LogTailer;
 
+// Cluster metadata published as read-copy-update snapshots. Writers copy the current snapshot,
+// modify the copy and swap it in, applying every batch that a catch-up read returns to one copy.
+// Every thread caches its own reference to the snapshot and refreshes it only when the published
+// version changes, so readers take no lock and update no reference count that other threads
+// share; until then, an idle thread keeps the snapshot it last read alive.
+//
+// A background thread tails the `__cluster_metadata` log, so topics created while the broker
+// runs become visible without a restart. It also checkpoints the tables to a snapshot file
+// from time to time, and startup loads that file and replays only the log after it.
 class ClusterMetadata {
 public:
     // Returns the only instance of `ClusterMetadata`.
@@ -135,23 +293,58 @@ public:
         return cluster_metadata;
     }
 
-    // Gets the UUID of the topic with the specified name.
-    UUID get_topic_id(const std::string &topic_name) const;
+    ~ClusterMetadata();
 
-    // Gets the name of the topic with the specified UUID.
-    std::string get_topic_name(const UUID &topic_id) const;
+    // Returns the current snapshot.
+    std::shared_ptr<const MetadataSnapshot> snapshot() const;
 
-    // Gets the partition IDs of the topic with the specified UUID.
-    std::vector<INT32> get_partition_ids(const UUID &topic_id) const;
+    // Returns the progress of applying the metadata log.
+    MetadataApplyStats apply_stats() const;
+
+    // Returns the `cluster.id` of the log directory's `meta.properties`, or an empty string.
+    const std::string &cluster_id() const {
+        return cluster_id_;
+    }
 
 private:
-    mutable std::mutex mutex_;
-    std::map<std::string, UUID> topic_ids_;
-    std::map<UUID, std::string, UUIDCompare> topic_names_;
-    std::map<UUID, std::vector<INT32>, UUIDCompare> partition_ids_;
+    std::string cluster_id_;
+    std::atomic<std::shared_ptr<const MetadataSnapshot>> snapshot_;
+    // The version of `snapshot_`, which readers check before they load it.
+    std::atomic<std::uint64_t> version_;
+    // Serializes writers; readers never take it.
+    std::mutex update_mutex_;
+
+    // Only used by the tailing thread once construction is done.
+    std::unique_ptr<LogTailer> tailer_;
+    std::chrono::steady_clock::time_point rate_window_start_;
+    std::uint64_t rate_window_records_;
+    std::string snapshot_path_;
+    std::chrono::steady_clock::time_point last_snapshot_time_;
+    std::uint64_t records_since_snapshot_;
+
+    std::atomic<INT64> next_offset_;
+    std::atomic<std::uint64_t> records_applied_;
+    std::atomic<std::uint64_t> records_skipped_;
+    std::atomic<double> records_per_second_;
+    std::atomic<INT64> last_record_timestamp_ms_;
+
+    FileDescriptor stop_fd_;
+    std::thread tail_thread_;
 
     ClusterMetadata();
 
+    // Publishes a copy of the current snapshot modified by `update`.
+    void update(const std::function<void(MetadataSnapshot &)> &update);
+
+    // Applies the records appended to the metadata log since the last call.
+    void catch_up();
+
+    // Writes a snapshot file if enough records were applied or enough time passed since the last.
+    void maybe_write_snapshot();
+
+    // Waits for the metadata log to change and applies the new records, until stopped.
+    void tail();
+
     ClusterMetadata(const ClusterMetadata &other) = delete;
     ClusterMetadata &operator=(const ClusterMetadata &other) = delete;
     ClusterMetadata(ClusterMetadata &&other) = delete;
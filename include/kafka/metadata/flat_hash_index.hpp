@@ -0,0 +1,89 @@
+#ifndef CODECRAFTERS_KAFKA_METADATA_FLAT_HASH_INDEX_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METADATA_FLAT_HASH_INDEX_HPP_INCLUDED
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace kafka {
+
+// Open-addressing hash index that maps keys to positions in a contiguous array owned by the
+// caller. Slots hold only a hash and a position, so a probe touches one cache line in the
+// common case and compares the key itself only when the hashes match.
+class FlatHashIndex {
+public:
+    FlatHashIndex() : slots_(min_capacity), size_(0) {}
+
+    // Returns the number of indexed positions.
+    std::size_t size() const {
+        return size_;
+    }
+
+    // Returns the bytes of the slots.
+    std::size_t memory_bytes() const {
+        return slots_.capacity() * sizeof(Slot);
+    }
+
+    // Grows the index so that `n` positions fit while at most half of the slots are used.
+    void reserve(std::size_t n) {
+        if (n * 2 > slots_.size()) {
+            std::vector<Slot> slots(std::bit_ceil(n * 2));
+            slots.swap(slots_);
+            for (const Slot &slot : slots) {
+                if (slot.position != 0) {
+                    place(slot);
+                }
+            }
+        }
+    }
+
+    // Indexes `position` under `hash`. The key must not already be indexed.
+    void insert(std::size_t hash, std::uint32_t position) {
+        reserve(size_ + 1);
+        place(Slot{static_cast<std::uint32_t>(hash), position + 1});
+        size_++;
+    }
+
+    // Finds the position whose key has the given hash and satisfies `matches(position)`.
+    template<typename Matches>
+    std::optional<std::uint32_t> find(std::size_t hash, Matches matches) const {
+        auto hash32 = static_cast<std::uint32_t>(hash);
+        std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = hash32 & mask; ; i = (i + 1) & mask) {
+            const Slot &slot = slots_[i];
+            if (slot.position == 0) {
+                return std::nullopt;
+            }
+            if (slot.hash == hash32 && matches(slot.position - 1)) {
+                return slot.position - 1;
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t min_capacity = 16;
+
+    struct Slot {
+        std::uint32_t hash;
+        // Position plus one, so that zero marks an empty slot.
+        std::uint32_t position;
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t size_;
+
+    void place(Slot slot) {
+        std::size_t mask = slots_.size() - 1;
+        std::size_t i = slot.hash & mask;
+        while (slots_[i].position != 0) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = slot;
+    }
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METADATA_FLAT_HASH_INDEX_HPP_INCLUDED
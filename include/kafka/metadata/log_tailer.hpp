@@ -0,0 +1,89 @@
+#ifndef CODECRAFTERS_KAFKA_METADATA_LOG_TAILER_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METADATA_LOG_TAILER_HPP_INCLUDED
+
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// A record batch read from a log, by where it was and the CRC it had, to tell whether the log
+// was rewritten since.
+struct LogBatchMark {
+    // Base offset of the segment of the batch, or -1 for no batch.
+    INT64 segment_base_offset = -1;
+    // Byte position of the batch in the segment.
+    INT64 position = 0;
+    INT64 base_offset = 0;
+    UINT32 crc = 0;
+};
+
+// Follows the segments of a partition log and returns the record batches appended since the
+// previous read. A batch that is still being written is left for a later read.
+class LogTailer {
+public:
+    // Creates a tailer that starts at the beginning of the log in directory `log_dir`.
+    explicit LogTailer(std::string log_dir)
+        : log_dir_(std::move(log_dir)), segment_base_offset_(-1), position_(0), next_offset_(0) {}
+
+    // Returns the directory of the tailed log.
+    const std::string &log_dir() const {
+        return log_dir_;
+    }
+
+    // Returns the offset after the last batch returned so far.
+    INT64 next_offset() const {
+        return next_offset_;
+    }
+
+    // Returns the base offset of the segment being read, or -1 before the first segment.
+    INT64 segment_base_offset() const {
+        return segment_base_offset_;
+    }
+
+    // Returns the byte position after the last batch returned from the current segment.
+    off_t position() const {
+        return position_;
+    }
+
+    // Returns the last batch read, whether or not it could be decoded.
+    const LogBatchMark &last_batch() const {
+        return last_batch_;
+    }
+
+    // Continues from a position recorded earlier, skipping everything before it, where
+    // `last_batch` was the last batch read. Returns false, leaving the tailer unchanged, if that
+    // position no longer exists in the log or the log no longer holds that batch there.
+    bool resume(INT64 segment_base_offset, off_t position, INT64 next_offset, const LogBatchMark &last_batch);
+
+    // Appends every complete record batch written since the previous call to `batches`. Moves
+    // on to the next segment once the current one has been rolled.
+    void read_new_batches(std::vector<RecordBatch> &batches);
+
+private:
+    std::string log_dir_;
+    std::optional<FileDescriptor> segment_fd_;
+    INT64 segment_base_offset_;
+    off_t position_;
+    INT64 next_offset_;
+    LogBatchMark last_batch_;
+
+    // Opens the segment after the current one, if there is one.
+    bool open_next_segment();
+};
+
+// Returns the base offsets of the segments in a log directory, in ascending order.
+std::vector<INT64> list_segments(const std::string &log_dir);
+
+// Returns the path of the segment file with the specified base offset.
+std::string segment_path(const std::string &log_dir, INT64 base_offset);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METADATA_LOG_TAILER_HPP_INCLUDED
@@ -0,0 +1,60 @@
+#ifndef CODECRAFTERS_KAFKA_METADATA_METADATA_FRAGMENTS_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METADATA_METADATA_FRAGMENTS_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Metadata API topic entries of one snapshot, encoded once and shared by every Metadata
+// response served from that snapshot. Entries are stored back to back in snapshot order, so
+// a response listing every topic copies a single byte range.
+class MetadataTopicFragments {
+public:
+    // Prepares the entries of `snapshot`, whose partitions are all led by `leader_id`.
+    MetadataTopicFragments(std::shared_ptr<const MetadataSnapshot> snapshot, INT32 leader_id)
+        : snapshot_(std::move(snapshot)), leader_id_(leader_id) {}
+
+    // Returns the entries of `snapshot`. They are encoded only the first time a snapshot
+    // version is seen; later calls with the same version return the cached entries.
+    static std::shared_ptr<const MetadataTopicFragments> get(std::shared_ptr<const MetadataSnapshot> snapshot,
+                                                              INT32 leader_id);
+
+    // Returns the snapshot the entries were encoded from.
+    const MetadataSnapshot &snapshot() const {
+        return *snapshot_;
+    }
+
+    // Returns the encoded entry of a topic of the snapshot, for a Metadata `version`.
+    std::span<const unsigned char> topic(const MetadataSnapshot::Topic &topic, INT16 version) const;
+
+    // Returns the encoded entries of every topic of the snapshot, for a Metadata `version`.
+    std::span<const unsigned char> all_topics(INT16 version) const;
+
+private:
+    // Versions before 10 have no topic ID, so there are two encodings.
+    struct Encoding {
+        std::once_flag once;
+        BYTES bytes;
+        // Where the entry of every topic starts, followed by the total size.
+        std::vector<std::size_t> offsets;
+    };
+
+    std::shared_ptr<const MetadataSnapshot> snapshot_;
+    INT32 leader_id_;
+    mutable std::array<Encoding, 2> encodings_;
+
+    // Returns the encoding for a Metadata `version`, encoding it on first use.
+    const Encoding &encoding(INT16 version) const;
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METADATA_METADATA_FRAGMENTS_HPP_INCLUDED
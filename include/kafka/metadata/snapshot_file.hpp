@@ -0,0 +1,42 @@
+#ifndef CODECRAFTERS_KAFKA_METADATA_SNAPSHOT_FILE_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METADATA_SNAPSHOT_FILE_HPP_INCLUDED
+
+#include <string>
+
+#include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/metadata/log_tailer.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Point in the metadata log up to which a snapshot file includes every record.
+struct MetadataLogPosition {
+    // Base offset of the segment, and byte position in it, at which tailing resumes.
+    INT64 segment_base_offset;
+    INT64 segment_position;
+    // Offset after the last included record.
+    INT64 next_offset;
+    // The last batch included, which the log must still hold for the snapshot to be used.
+    LogBatchMark last_batch;
+};
+
+// Compact binary checkpoint of a `MetadataSnapshot`. The topic array, the partition arrays and
+// the name arena are stored exactly as they are laid out in memory, so loading is a few bulk
+// copies out of a memory-mapped file plus rebuilding the hash indexes, however long the
+// metadata log behind it is.
+class MetadataSnapshotFile {
+public:
+    // Writes `snapshot` to `path`, replacing any previous file atomically.
+    static void write(const std::string &path, const MetadataSnapshot &snapshot, const MetadataLogPosition &position);
+
+    // Reads the snapshot at `path`. Returns false if it is missing, not a valid snapshot file or
+    // fails its checksum.
+    static bool read(const std::string &path, MetadataSnapshot &snapshot, MetadataLogPosition &position);
+};
+
+// Returns the path of the snapshot file kept next to the metadata log in `log_dir`.
+std::string metadata_snapshot_path(const std::string &log_dir);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METADATA_SNAPSHOT_FILE_HPP_INCLUDED
@@ -0,0 +1,84 @@
+#ifndef CODECRAFTERS_KAFKA_METRICS_LATENCY_HISTOGRAM_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METRICS_LATENCY_HISTOGRAM_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kafka {
+
+// HDR-style histogram of durations in nanoseconds. Buckets are log-linear: every power of two
+// is split into 16 equal buckets, so a recorded value is known within 1/16 of itself, from
+// 1 ns up to about 18 minutes. It has a single writer, which records with plain loads and
+// stores instead of atomic read-modify-writes; any thread may read it at the same time.
+class LatencyHistogram {
+public:
+    static constexpr unsigned sub_bucket_bits = 4;
+    static constexpr std::size_t sub_bucket_count = std::size_t(1) << sub_bucket_bits;
+    static constexpr unsigned max_value_bits = 40;
+    static constexpr std::size_t bucket_count = (max_value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+    // Counts summed over any number of histograms.
+    struct Snapshot {
+        std::array<std::uint64_t, bucket_count> counts{};
+        std::uint64_t count = 0;
+        std::uint64_t sum_ns = 0;
+
+        // Returns the value below which the `quantile` (0 to 1) of the values lie, as the
+        // middle of its bucket.
+        std::chrono::nanoseconds value_at_quantile(double quantile) const;
+    };
+
+    // Records one duration. Must only be called by the owning thread.
+    void record(std::chrono::nanoseconds duration) {
+        auto value = static_cast<std::uint64_t>(duration.count() < 0 ? 0 : duration.count());
+        increment(counts_[bucket_index(value)], 1);
+        increment(count_, 1);
+        increment(sum_ns_, value);
+    }
+
+    // Adds the counts recorded so far to `snapshot`.
+    void add_to(Snapshot &snapshot) const;
+
+    // Returns the bucket of a value, clamping values past the largest bucket into it.
+    static constexpr std::size_t bucket_index(std::uint64_t value) {
+        if (value < sub_bucket_count) {
+            return static_cast<std::size_t>(value);
+        }
+        unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - sub_bucket_bits;
+        if (shift >= max_value_bits - sub_bucket_bits) {
+            return bucket_count - 1;
+        }
+        return (shift + 1) * sub_bucket_count + static_cast<std::size_t>((value >> shift) - sub_bucket_count);
+    }
+
+    // Returns the smallest value of a bucket.
+    static constexpr std::uint64_t bucket_lower_bound(std::size_t index) {
+        if (index < sub_bucket_count) {
+            return index;
+        }
+        std::size_t shift = index / sub_bucket_count - 1;
+        return (sub_bucket_count + index % sub_bucket_count) << shift;
+    }
+
+    // Returns the number of values a bucket covers.
+    static constexpr std::uint64_t bucket_width(std::size_t index) {
+        return index < sub_bucket_count ? 1 : std::uint64_t(1) << (index / sub_bucket_count - 1);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_ns_{0};
+
+    static void increment(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METRICS_LATENCY_HISTOGRAM_HPP_INCLUDED
@@ -0,0 +1,205 @@
+#ifndef CODECRAFTERS_KAFKA_METRICS_MEMORY_ACCOUNTING_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METRICS_MEMORY_ACCOUNTING_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace kafka {
+
+// What the memory charged to the accounting holds.
+enum class MemoryCategory {
+    // Receive buffers of the connections.
+    RECEIVE_BUFFERS,
+    // Request frames from their receipt until their request has been handled.
+    REQUEST_FRAMES,
+    // Record batches read from partition logs for Fetch responses.
+    RECORD_BATCHES,
+    // Encoded responses from their completion until they have been sent.
+    RESPONSES,
+    // Cluster metadata snapshots, including those still held by requests.
+    METADATA,
+};
+
+inline constexpr std::size_t memory_category_count = 5;
+
+// Returns the label of a category in the metrics, such as "request_frames".
+constexpr std::string_view memory_category_name(MemoryCategory category) {
+    switch (category) {
+    case MemoryCategory::RECEIVE_BUFFERS:
+        return "receive_buffers";
+    case MemoryCategory::REQUEST_FRAMES:
+        return "request_frames";
+    case MemoryCategory::RECORD_BATCHES:
+        return "record_batches";
+    case MemoryCategory::RESPONSES:
+        return "responses";
+    case MemoryCategory::METADATA:
+        return "metadata";
+    }
+    return "unknown";
+}
+
+// The bytes charged on behalf of one connection, and the most it ever held at once.
+class ConnectionMemory {
+public:
+    ConnectionMemory(std::uint64_t id, std::string peer) : id_(id), peer_(std::move(peer)) {}
+
+    void add(std::int64_t delta) {
+        std::int64_t current = current_.fetch_add(delta, std::memory_order_relaxed) + delta;
+        std::int64_t peak = peak_.load(std::memory_order_relaxed);
+        while (current > peak && !peak_.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Numbers the connections in the order they were accepted.
+    std::uint64_t id() const {
+        return id_;
+    }
+
+    // Address and port of the client.
+    const std::string &peer() const {
+        return peer_;
+    }
+
+    std::int64_t current() const {
+        return current_.load(std::memory_order_relaxed);
+    }
+
+    std::int64_t peak() const {
+        return peak_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const std::uint64_t id_;
+    const std::string peer_;
+    std::atomic<std::int64_t> current_{0};
+    std::atomic<std::int64_t> peak_{0};
+};
+
+// Bytes charged to a category, and to a connection if any, for as long as the charge lives.
+// It is kept next to the buffer or container whose memory it accounts for. Like that memory,
+// a copy is charged again.
+class MemoryCharge {
+public:
+    MemoryCharge() = default;
+
+    MemoryCharge(MemoryCategory category, std::size_t bytes, std::shared_ptr<ConnectionMemory> connection = nullptr)
+        : category_(category), connection_(std::move(connection)) {
+        resize(bytes);
+    }
+
+    MemoryCharge(const MemoryCharge &other) : MemoryCharge(other.category_, other.bytes_, other.connection_) {}
+
+    MemoryCharge(MemoryCharge &&other) noexcept
+        : category_(other.category_), bytes_(std::exchange(other.bytes_, 0)),
+          connection_(std::move(other.connection_)) {}
+
+    ~MemoryCharge() {
+        resize(0);
+    }
+
+    MemoryCharge &operator=(MemoryCharge other) noexcept {
+        std::swap(category_, other.category_);
+        std::swap(bytes_, other.bytes_);
+        std::swap(connection_, other.connection_);
+        return *this;
+    }
+
+    // Returns the number of bytes charged.
+    std::size_t bytes() const {
+        return bytes_;
+    }
+
+    // Charges `bytes` instead of the bytes charged so far.
+    void resize(std::size_t bytes);
+
+private:
+    MemoryCategory category_ = MemoryCategory::RECEIVE_BUFFERS;
+    std::size_t bytes_ = 0;
+    std::shared_ptr<ConnectionMemory> connection_;
+};
+
+// Accounts for the memory of the broker per category and per connection. Memory is charged
+// per buffer, not per allocation, by `MemoryCharge`s. Every thread adds its charges to
+// counters of its own and folds them into the shared totals only once they have moved by
+// `flush_bytes`, so that accounting is cheap enough to be always on. Current bytes are exact;
+// peaks are taken when the totals change, so they may be off by up to `flush_bytes` per thread.
+class MemoryAccounting {
+public:
+    static constexpr std::int64_t flush_bytes = 64 * 1024;
+    // Connections reported in the metrics, those holding the most memory first.
+    static constexpr std::size_t reported_connections = 10;
+
+    struct CategoryStats {
+        std::int64_t current;
+        std::int64_t peak;
+    };
+
+    // Returns the only instance of `MemoryAccounting`.
+    static MemoryAccounting &get_instance();
+
+    // Adds `delta` bytes to a category.
+    void add(MemoryCategory category, std::int64_t delta);
+
+    // Starts accounting for a new connection from `peer`.
+    std::shared_ptr<ConnectionMemory> open_connection(std::string peer);
+
+    // Returns the current and peak bytes of every category.
+    std::array<CategoryStats, memory_category_count> stats() const;
+
+    // Returns the open connections that hold the most memory, at most `count` of them.
+    std::vector<std::shared_ptr<const ConnectionMemory>> top_connections(std::size_t count) const;
+
+    // Appends the bytes per category and of the connections holding the most, and the resident
+    // memory of the process, in the Prometheus text exposition format.
+    void write_prometheus(std::string &out) const;
+
+    MemoryAccounting(const MemoryAccounting &other) = delete;
+    MemoryAccounting &operator=(const MemoryAccounting &other) = delete;
+
+private:
+    // Bytes a thread added that are not in the totals yet. Only its thread writes them.
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::int64_t>, memory_category_count> pending{};
+    };
+
+    std::array<std::atomic<std::int64_t>, memory_category_count> totals_{};
+    std::array<std::atomic<std::int64_t>, memory_category_count> peaks_{};
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::weak_ptr<ConnectionMemory>> connections_;
+    std::uint64_t next_connection_id_ = 0;
+
+    MemoryAccounting() = default;
+
+    Shard &local_shard();
+
+    // Moves the pending bytes of a category into its total.
+    void flush(Shard &shard, std::size_t category);
+
+    friend struct LocalMemoryShard;
+};
+
+inline void MemoryCharge::resize(std::size_t bytes) {
+    auto delta = static_cast<std::int64_t>(bytes) - static_cast<std::int64_t>(bytes_);
+    if (delta == 0) {
+        return;
+    }
+    bytes_ = bytes;
+    MemoryAccounting::get_instance().add(category_, delta);
+    if (connection_) {
+        connection_->add(delta);
+    }
+}
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METRICS_MEMORY_ACCOUNTING_HPP_INCLUDED
@@ -0,0 +1,49 @@
+#ifndef CODECRAFTERS_KAFKA_METRICS_METRICS_SERVER_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METRICS_METRICS_SERVER_HPP_INCLUDED
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Minimal HTTP endpoint on the loopback interface that serves diagnostics, such as
+// `GET /metrics` for Prometheus. One thread answers one request per connection, so a scrape
+// never touches the request path.
+class MetricsServer {
+public:
+    // Renders the body of a page. Called on the endpoint thread.
+    using Renderer = std::function<std::string()>;
+
+    struct Page {
+        std::string path;
+        std::string content_type;
+        Renderer renderer;
+    };
+
+    // Starts listening on 127.0.0.1:`port` and serving `pages`.
+    MetricsServer(INT32 port, std::vector<Page> pages);
+
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer &other) = delete;
+    MetricsServer &operator=(const MetricsServer &other) = delete;
+
+private:
+    std::vector<Page> pages_;
+    FileDescriptor listen_fd_;
+    std::atomic<bool> stopping_;
+    std::thread thread_;
+
+    void run();
+    void serve(int client_socket);
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METRICS_METRICS_SERVER_HPP_INCLUDED
@@ -0,0 +1,121 @@
+#ifndef CODECRAFTERS_KAFKA_METRICS_PERF_PROFILE_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METRICS_PERF_PROFILE_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kafka/message/api_registry.hpp"
+#include "kafka/metrics/request_metrics.hpp"
+#include "kafka/protocol/constants.hpp"
+
+namespace kafka {
+
+// Events counted per thread with `perf_event_open`.
+enum class PerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    // Misses of the last-level cache.
+    CACHE_MISSES,
+    BRANCH_MISSES,
+    CONTEXT_SWITCHES,
+};
+
+inline constexpr std::size_t perf_event_count = 5;
+
+// Returns the label of an event in the metrics, such as "cache_misses".
+constexpr std::string_view perf_event_name(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::CYCLES:
+        return "cycles";
+    case PerfEvent::INSTRUCTIONS:
+        return "instructions";
+    case PerfEvent::CACHE_MISSES:
+        return "cache_misses";
+    case PerfEvent::BRANCH_MISSES:
+        return "branch_misses";
+    case PerfEvent::CONTEXT_SWITCHES:
+        return "context_switches";
+    }
+    return "unknown";
+}
+
+// Values of the events counted by the calling thread so far, 0 for those that are unavailable.
+using PerfCounts = std::array<std::uint64_t, perf_event_count>;
+
+// Attributes hardware and scheduler events to the stages of requests per API, from counters
+// that every handler thread opens for itself on first use. Only the stages that run on the
+// handler thread are counted: decoding, handling and encoding. Counting costs a system call
+// at every stage boundary, so it is off unless `perf.counters.enable` is set.
+class PerfProfile {
+public:
+    // Counts nothing.
+    PerfProfile() = default;
+
+    // Counts the events that this machine and `perf_event_paranoid` allow, if `enable`. Logs the
+    // events that cannot be counted.
+    explicit PerfProfile(bool enable);
+
+    // Whether requests are profiled.
+    bool enabled() const {
+        return enabled_;
+    }
+
+    // Reads the counters of the calling thread, opening them on its first call.
+    PerfCounts read() const;
+
+    // Adds the events counted between `begin` and `end` to a stage of requests of `api_key`.
+    void record(ApiKey api_key, RequestStage stage, const PerfCounts &begin, const PerfCounts &end);
+
+    // Appends the event totals and averages per API and stage in the Prometheus text
+    // exposition format.
+    void write_prometheus(std::string &out) const;
+
+    PerfProfile(const PerfProfile &other) = delete;
+    PerfProfile &operator=(const PerfProfile &other) = delete;
+
+private:
+    // A counter with a single writer, like `RequestMetrics::Counter`.
+    class Counter {
+    public:
+        void add(std::uint64_t value) {
+            value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::uint64_t get() const {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> value_{0};
+    };
+
+    struct StageCounts {
+        Counter samples;
+        std::array<Counter, perf_event_count> events;
+    };
+
+    struct alignas(64) Shard {
+        std::array<std::array<StageCounts, request_stage_count>, SupportedApis::size> stages;
+    };
+
+    bool enabled_ = false;
+    // Events that could be opened.
+    std::array<bool, perf_event_count> available_{};
+    // Tells the instances apart in the shard cache of each thread.
+    std::uint64_t id_ = 0;
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard &local_shard();
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METRICS_PERF_PROFILE_HPP_INCLUDED
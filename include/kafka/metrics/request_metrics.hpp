@@ -0,0 +1,122 @@
+#ifndef CODECRAFTERS_KAFKA_METRICS_REQUEST_METRICS_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METRICS_REQUEST_METRICS_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kafka/message/abstract.hpp"
+#include "kafka/message/api_registry.hpp"
+#include "kafka/metrics/latency_histogram.hpp"
+#include "kafka/protocol/constants.hpp"
+
+namespace kafka {
+
+// Stages of a request, each timed separately: waiting for a handler thread, decoding,
+// handling, encoding the response, and waiting for the response to be sent in order.
+enum class RequestStage {
+    QUEUE_WAIT,
+    DECODE,
+    HANDLE,
+    ENCODE,
+    SEND,
+};
+
+inline constexpr std::size_t request_stage_count = 5;
+
+// Returns the label of a stage in the metrics, such as "queue_wait".
+constexpr std::string_view request_stage_name(RequestStage stage) {
+    switch (stage) {
+    case RequestStage::QUEUE_WAIT:
+        return "queue_wait";
+    case RequestStage::DECODE:
+        return "decode";
+    case RequestStage::HANDLE:
+        return "handle";
+    case RequestStage::ENCODE:
+        return "encode";
+    case RequestStage::SEND:
+        return "send";
+    }
+    return "unknown";
+}
+
+// When a request entered each stage on its handler thread, up to its encoded response.
+struct RequestTimes {
+    std::chrono::steady_clock::time_point enqueued;
+    std::chrono::steady_clock::time_point dequeued;
+    std::chrono::steady_clock::time_point decoded;
+    std::chrono::steady_clock::time_point handled;
+    std::chrono::steady_clock::time_point encoded;
+};
+
+// Latency histograms per API and stage, and request, error and byte counters. Every thread
+// records into a shard of its own, without locks or contended cache lines; the shards are
+// summed only when the metrics are read.
+class RequestMetrics {
+public:
+    RequestMetrics();
+
+    // Records the time a request of `api_key` spent in `stage`.
+    void record_stage(ApiKey api_key, RequestStage stage, std::chrono::nanoseconds duration);
+
+    // Counts a handled request of `api_key` and the errors in its response, and records the
+    // time it spent in every stage up to the encoding of the response.
+    void record_request(ApiKey api_key, const RequestTimes &times, const ErrorCounts &error_counts);
+
+    // Counts a request that could not be decoded or handled, which closes its connection.
+    void record_failed_request();
+
+    // Counts bytes received from and sent to clients, including size prefixes.
+    void record_bytes_received(std::size_t bytes);
+    void record_bytes_sent(std::size_t bytes);
+
+    // Appends every metric in the Prometheus text exposition format.
+    void write_prometheus(std::string &out) const;
+
+    RequestMetrics(const RequestMetrics &other) = delete;
+    RequestMetrics &operator=(const RequestMetrics &other) = delete;
+
+private:
+    // A counter with a single writer, like `LatencyHistogram`.
+    class Counter {
+    public:
+        void add(std::uint64_t value) {
+            value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::uint64_t get() const {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> value_{0};
+    };
+
+    struct alignas(64) Shard {
+        std::array<std::array<LatencyHistogram, request_stage_count>, SupportedApis::size> latencies;
+        std::array<Counter, SupportedApis::size> requests;
+        std::array<std::array<Counter, error_code_count>, SupportedApis::size> errors;
+        Counter failed_requests;
+        Counter bytes_received;
+        Counter bytes_sent;
+    };
+
+    // Tells the instances apart in the shard cache of each thread.
+    const std::uint64_t id_;
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard &local_shard();
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METRICS_REQUEST_METRICS_HPP_INCLUDED
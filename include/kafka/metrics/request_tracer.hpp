@@ -0,0 +1,105 @@
+#ifndef CODECRAFTERS_KAFKA_METRICS_REQUEST_TRACER_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_METRICS_REQUEST_TRACER_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kafka/metrics/request_metrics.hpp"
+#include "kafka/protocol/constants.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Everything known about one request once its response has been sent: what it asked for and
+// when it entered each stage, on the CLOCK_MONOTONIC time line of `std::chrono::steady_clock`.
+struct RequestTrace {
+    static constexpr std::size_t max_client_id_size = 31;
+
+    ApiKey api_key{};
+    INT16 api_version = 0;
+    INT32 correlation_id = 0;
+    // Topics and partitions named by the request.
+    std::uint32_t topic_count = 0;
+    std::uint32_t partition_count = 0;
+    // Client ID, truncated to `max_client_id_size` bytes, so that a trace is trivially copyable.
+    std::array<char, max_client_id_size + 1> client_id{};
+    RequestTimes times;
+    std::chrono::steady_clock::time_point sent;
+
+    // Sets the client ID, truncating it.
+    void set_client_id(std::string_view id);
+
+    // Returns the client ID.
+    std::string_view client_id_view() const {
+        return std::string_view(client_id.data());
+    }
+
+    // Returns the time spent in a stage.
+    std::chrono::nanoseconds stage_duration(RequestStage stage) const;
+};
+
+// Keeps the traces of the latest requests in a ring buffer per recording thread, and logs the
+// requests that took longer than a threshold with the time they spent in every stage. The
+// traces can be exported in the Chrome trace-event format, for chrome://tracing or Perfetto.
+class RequestTracer {
+public:
+    // Keeps `ring_capacity` traces per thread (none if 0) and logs the requests slower than
+    // `slow_request_threshold` (none if 0) to `std::clog`.
+    RequestTracer(std::size_t ring_capacity, std::chrono::milliseconds slow_request_threshold);
+
+    // Whether `record` does anything.
+    bool enabled() const {
+        return ring_capacity_ > 0 || slow_request_threshold_.count() > 0;
+    }
+
+    // Records the trace of a request whose response was sent.
+    void record(const RequestTrace &trace);
+
+    // Returns the traces currently in the ring buffers, oldest first.
+    std::vector<RequestTrace> traces() const;
+
+    // Appends the traces in the ring buffers as Chrome trace-event JSON.
+    void write_chrome_trace(std::string &out) const;
+
+    // Returns the line logged for a slow request.
+    static std::string format_slow_request(const RequestTrace &trace);
+
+    RequestTracer(const RequestTracer &other) = delete;
+    RequestTracer &operator=(const RequestTracer &other) = delete;
+
+private:
+    // Slot of a ring, guarded by a sequence number that is odd while the slot is written, so
+    // that readers can copy it without stopping the writer.
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        RequestTrace trace;
+    };
+
+    // Ring of one thread, which is its only writer.
+    struct Ring {
+        explicit Ring(std::size_t capacity) : slots(std::make_unique<Slot[]>(capacity)) {}
+
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<std::uint64_t> written{0};
+    };
+
+    const std::uint64_t id_;
+    const std::size_t ring_capacity_;
+    const std::chrono::milliseconds slow_request_threshold_;
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    Ring &local_ring();
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_METRICS_REQUEST_TRACER_HPP_INCLUDED
@@ -1,30 +1,209 @@
 #ifndef CODECRAFTERS_KAFKA_NETWORK_CLIENT_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_NETWORK_CLIENT_HPP_INCLUDED
 
-#include "kafka/message/messages.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "kafka/metrics/memory_accounting.hpp"
+#include "kafka/metrics/request_metrics.hpp"
+#include "kafka/metrics/request_tracer.hpp"
+#include "kafka/network/memory_pool.hpp"
+#include "kafka/network/request_capture.hpp"
+#include "kafka/protocol/constants.hpp"
 #include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/protocol/types.hpp"
 
 namespace kafka {
 
+// A request frame (excluding the size prefix) and the pool memory reserved for it.
+struct RequestFrame {
+    BYTES bytes;
+    MemoryLease memory;
+    MemoryCharge charge;
+};
+
+// An encoded response (with size prefix), as a request handler returns it.
+struct ResponseFrame {
+    BYTES bytes;
+    // How long the connection should not be read afterwards because the client exceeded a quota.
+    std::chrono::milliseconds throttle_time{0};
+    // What the request asked for and when it went through each stage, completed once the
+    // response has been sent.
+    RequestTrace trace;
+    // Charged to the connection once the response is complete.
+    MemoryCharge charge;
+};
+
 // Kafka client connection.
 class Client {
 public:
-    explicit Client(int client_socket) : client_fd_(client_socket) {}
+    // Creates a connection whose request frames are reserved from `memory_pool` and may not
+    // be larger than `max_request_size`, and which stops being read while `output_high_water`
+    // bytes of responses are waiting to be sent. Sent responses are recorded in `metrics` and
+    // `tracer`, and requests and responses are captured by `capture` if it is enabled. The
+    // buffers, frames and responses of the connection are charged to its memory account.
+    Client(int client_socket, MemoryPool &memory_pool, RequestMetrics &metrics, RequestTracer &tracer,
+           RequestCapture &capture, std::size_t max_request_size, std::size_t output_high_water)
+        : client_fd_(client_socket), memory_pool_(memory_pool), metrics_(metrics), tracer_(tracer),
+          capture_(capture), capture_connection_(capture.enabled() ? capture.next_connection() : 0),
+          max_request_size_(max_request_size),
+          output_high_water_(output_high_water), receive_buffer_(initial_receive_buffer_size), receive_begin_(0),
+          receive_end_(0), memory_(MemoryAccounting::get_instance().open_connection(peer_address(client_socket))),
+          receive_buffer_charge_(MemoryCategory::RECEIVE_BUFFERS, initial_receive_buffer_size, memory_),
+          large_frame_received_(0), waiting_for_memory_(false), output_offset_(0), output_bytes_(0), output_full_(false),
+          closing_(false), epoll_events_(0), throttled_(false), next_sequence_(0), next_response_(0),
+          failed_sequence_(0), failed_(false) {}
+
+    ~Client() {
+        if (waiting_for_memory_) {
+            memory_pool_.end_wait(std::chrono::steady_clock::now() - wait_start_, false);
+        }
+    }
+
+    // Returns the socket of this client connection.
+    int socket() const {
+        return client_fd_.get();
+    }
+
+    // Receives whatever is available on this client connection without blocking and appends
+    // every complete request frame to `frames`. Pipelined requests that arrive together are
+    // framed from a single receive. Nothing is received while the next frame waits for pool
+    // memory; calling this again retries the reservation. Returns false once the client has
+    // disconnected. Throws if a frame is larger than the maximum request size.
+    bool receive_frames(std::vector<RequestFrame> &frames);
 
-    // Reads a `RequestMessage` from this client connection.
-    RequestMessage read_request() {
-        RequestMessage request_message;
-        request_message.read(client_fd_);
-        return request_message;
+    // Whether the next frame is waiting for pool memory, so the connection should not be read.
+    bool waiting_for_memory() const {
+        return waiting_for_memory_;
     }
 
-    // Writes a `ResponseMessage` to this client connection.
-    void write_response(const ResponseMessage &response_message) {
-        response_message.write(client_fd_);
+    // Assigns the next request sequence number. Responses are written in this order.
+    std::uint64_t next_sequence() {
+        return next_sequence_++;
+    }
+
+    // Records the encoded response to the request with the given sequence number. A request
+    // that failed is recorded with `succeeded` unset, and the connection is closed after the
+    // responses that precede it have been written. A client over its quota is throttled for
+    // the throttle time of the response from now.
+    void complete(std::uint64_t sequence, ResponseFrame response, bool succeeded);
+
+    // Moves every completed response whose predecessors have all been queued to the output
+    // queue, without copying it, and takes over the throttle times of the completed requests.
+    void queue_completed_responses();
+
+    // Time until which the connection should not be read because the client exceeded a quota.
+    std::chrono::steady_clock::time_point throttled_until() const {
+        return throttled_until_;
+    }
+
+    // Whether the connection is muted until `throttled_until()`.
+    bool throttled() const {
+        return throttled_;
+    }
+
+    void set_throttled(bool throttled) {
+        throttled_ = throttled;
+    }
+
+    // Sends as much of the output queue as the socket takes without blocking, with gathering
+    // writes. Returns false if the socket failed.
+    bool send_output();
+
+    // Returns the number of response bytes waiting to be sent.
+    std::size_t output_bytes() const {
+        return output_bytes_;
+    }
+
+    // Whether responses are waiting for the socket to become writable.
+    bool output_pending() const {
+        return !output_queue_.empty();
+    }
+
+    // Whether the output queue reached the high-water mark and has not drained since, so the
+    // connection should not be read.
+    bool output_full() const {
+        return output_full_;
+    }
+
+    // Whether the connection should be closed: a request failed and every response before it
+    // has been sent.
+    bool finished() const {
+        return closing_ && output_queue_.empty();
+    }
+
+    // Events this connection is registered for in the epoll set of its processor.
+    std::uint32_t epoll_events() const {
+        return epoll_events_;
+    }
+
+    void set_epoll_events(std::uint32_t events) {
+        epoll_events_ = events;
     }
 
 private:
+    static constexpr std::size_t initial_receive_buffer_size = 64 * 1024;
+
     FileDescriptor client_fd_;
+    MemoryPool &memory_pool_;
+    RequestMetrics &metrics_;
+    RequestTracer &tracer_;
+    RequestCapture &capture_;
+    // Number of this connection in the capture.
+    std::uint32_t capture_connection_;
+    std::size_t max_request_size_;
+    std::size_t output_high_water_;
+    BYTES receive_buffer_;
+    std::size_t receive_begin_;
+    std::size_t receive_end_;
+    std::shared_ptr<ConnectionMemory> memory_;
+    MemoryCharge receive_buffer_charge_;
+    // Memory reserved for the frame at `receive_begin_`, once its size is known.
+    std::optional<MemoryLease> frame_memory_;
+    // A frame too large for the receive buffer, received directly up to `large_frame_received_`.
+    RequestFrame large_frame_;
+    std::size_t large_frame_received_;
+    bool waiting_for_memory_;
+    std::chrono::steady_clock::time_point wait_start_;
+    // Encoded responses in order, the first of which is sent up to `output_offset_`.
+    std::deque<ResponseFrame> output_queue_;
+    std::size_t output_offset_;
+    std::size_t output_bytes_;
+    bool output_full_;
+    bool closing_;
+    std::uint32_t epoll_events_;
+    std::chrono::steady_clock::time_point throttled_until_;
+    bool throttled_;
+    std::uint64_t next_sequence_;
+
+    std::mutex response_mutex_;
+    std::map<std::uint64_t, ResponseFrame> completed_responses_;
+    std::uint64_t next_response_;
+    std::chrono::steady_clock::time_point completed_throttled_until_;
+    std::uint64_t failed_sequence_;
+    bool failed_;
+
+    // Moves the next complete frame out of the receive buffer, if there is one and its memory
+    // could be reserved. A frame too large for the receive buffer moves to `large_frame_`.
+    bool take_frame(RequestFrame &frame);
+
+    // Records a received request frame in the capture, if it is enabled.
+    void capture_request(const BYTES &frame);
+
+    // Returns the address and port of the peer of a socket, or "unknown".
+    static std::string peer_address(int socket);
+
+    // Reserves pool memory for the next frame. Returns false, and starts waiting, if it does
+    // not fit.
+    bool reserve_frame_memory(std::size_t frame_size);
 };
 
 }
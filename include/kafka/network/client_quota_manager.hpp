@@ -0,0 +1,130 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_CLIENT_QUOTA_MANAGER_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_CLIENT_QUOTA_MANAGER_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "kafka/config/server_config.hpp"
+
+namespace kafka {
+
+// Principal of every connection, as this broker does not authenticate clients.
+inline constexpr std::string_view anonymous_user = "ANONYMOUS";
+
+// Rate of a quantity over the last `samples` windows, the newest of which is still filling.
+// Recording adds to one of several counters chosen by thread, so concurrent handler threads
+// don't contend; the counters are merged into the window when it ends.
+class RateSensor {
+public:
+    RateSensor(std::size_t samples, std::chrono::nanoseconds window, std::chrono::steady_clock::time_point now);
+
+    // Adds `value` at time `now`.
+    void record(std::uint64_t value, std::chrono::steady_clock::time_point now);
+
+    // Returns the rate per second at time `now`.
+    double rate(std::chrono::steady_clock::time_point now) const;
+
+    // Returns the time span the rate is measured over at time `now`.
+    std::chrono::nanoseconds measured_span(std::chrono::steady_clock::time_point now) const;
+
+    RateSensor(const RateSensor &other) = delete;
+    RateSensor &operator=(const RateSensor &other) = delete;
+
+private:
+    static constexpr std::size_t stripes = 16;
+
+    struct alignas(64) Stripe {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    const std::int64_t window_ns_;
+    std::vector<std::atomic<std::uint64_t>> samples_;
+    std::atomic<std::size_t> current_;
+    std::atomic<std::int64_t> current_start_ns_;
+    std::array<Stripe, stripes> stripes_;
+    std::mutex roll_mutex_;
+
+    void roll(std::int64_t now_ns);
+};
+
+// Enforces Kafka-style client quotas: a byte rate on responses and a request-time rate, as a
+// percentage of one handler thread. Quotas apply to a user if one is configured for it, and
+// otherwise to each client ID. A client above a quota is told to back off for as long as
+// brings it back to the quota, and its connection is not read for that long.
+//
+// The rates of a user or client ID are dropped once it has recorded nothing for all the
+// windows that rates are measured over, like Kafka expires idle quota sensors: all their
+// samples are zero by then, so fresh rates behave the same. Clients that keep changing their
+// client ID so take memory only for the IDs of the last few seconds.
+class ClientQuotaManager {
+public:
+    explicit ClientQuotaManager(const ServerConfig &config);
+
+    // Whether any quota is configured.
+    bool enabled() const {
+        return enabled_;
+    }
+
+    // Records a handled request and returns how long its client should be throttled for.
+    std::chrono::milliseconds record(std::string_view user, std::string_view client_id, std::size_t response_bytes,
+                                     std::chrono::nanoseconds request_time);
+
+    ClientQuotaManager(const ClientQuotaManager &other) = delete;
+    ClientQuotaManager &operator=(const ClientQuotaManager &other) = delete;
+
+private:
+    struct Entity {
+        Entity(const ClientQuotaManager &manager, const ClientQuota &quota, std::chrono::steady_clock::time_point now);
+
+        ClientQuota quota;
+        RateSensor bytes;
+        RateSensor request_time;
+        // When the entity last recorded a request, in steady clock nanoseconds.
+        std::atomic<std::int64_t> last_record_ns;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view str) const {
+            return std::hash<std::string_view>()(str);
+        }
+    };
+
+    using Entities = std::unordered_map<std::string, std::unique_ptr<Entity>, StringHash, std::equal_to<>>;
+
+    std::size_t samples_;
+    std::chrono::nanoseconds window_;
+    ClientQuota default_quota_;
+    // The configured quotas of single users and client IDs, by name.
+    std::map<std::string, ClientQuota, std::less<>> user_quotas_;
+    std::map<std::string, ClientQuota, std::less<>> client_id_quotas_;
+    bool enabled_;
+
+    // Guards the maps; recording into an entity takes it shared.
+    std::shared_mutex mutex_;
+    Entities user_entities_;
+    Entities client_id_entities_;
+    std::int64_t last_expiry_ns_;
+
+    std::chrono::milliseconds record(Entity &entity, std::size_t response_bytes, std::chrono::nanoseconds request_time,
+                                     std::chrono::steady_clock::time_point now) const;
+    void expire_idle_entities(std::chrono::steady_clock::time_point now);
+    std::chrono::milliseconds throttle_time(const RateSensor &sensor, double quota,
+                                            std::chrono::steady_clock::time_point now) const;
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_CLIENT_QUOTA_MANAGER_HPP_INCLUDED
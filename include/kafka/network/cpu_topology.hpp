@@ -0,0 +1,86 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_CPU_TOPOLOGY_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_CPU_TOPOLOGY_HPP_INCLUDED
+
+#include <cstddef>
+#include <pthread.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kafka {
+
+// Parses a Linux CPU list such as `0-3,8,10-11` into sorted, distinct CPU numbers. Throws on
+// anything else.
+std::vector<int> parse_cpu_list(std::string_view text);
+
+// Formats CPU numbers as a CPU list, joining runs into ranges.
+std::string format_cpu_list(const std::vector<int> &cpus);
+
+// A NUMA node and the CPUs of it that this process may run on.
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// The NUMA nodes of the machine, from `/sys/devices/system/node`, restricted to the CPUs in
+// the affinity mask of the process. A machine without NUMA information is one node.
+class CpuTopology {
+public:
+    static CpuTopology detect();
+
+    const std::vector<NumaNode> &nodes() const {
+        return nodes_;
+    }
+
+    // Splits CPUs by the node they belong to, leaving out nodes without any of them. Throws if
+    // a CPU is not in the topology.
+    std::vector<NumaNode> split(const std::vector<int> &cpus) const;
+
+    // Describes the nodes, such as `node 0 (CPUs 0-7), node 1 (CPUs 8-15)`.
+    std::string describe() const;
+
+private:
+    std::vector<NumaNode> nodes_;
+};
+
+// CPUs that one thread runs on, all of one node; or none, which leaves it to the scheduler.
+struct CpuSlot {
+    // The node of the CPUs, or -1.
+    int node = -1;
+    std::vector<int> cpus;
+};
+
+// Restricts a thread to the CPUs of a slot. Does nothing for a slot without CPUs.
+void pin_thread(pthread_t thread, const CpuSlot &slot);
+
+// Where the threads of one class run. The CPUs configured for the class are split by node, and
+// the threads are spread over the nodes in turn; every thread may run on any of the CPUs of its
+// node, so the scheduler still balances the threads within a node while their memory stays
+// local to it.
+class ThreadPlacement {
+public:
+    // Leaves every thread to the scheduler.
+    ThreadPlacement() = default;
+
+    // Places threads on `cpus`, or leaves them to the scheduler if it is empty.
+    ThreadPlacement(const CpuTopology &topology, const std::vector<int> &cpus) : nodes_(topology.split(cpus)) {}
+
+    // Returns the slot of the thread numbered `index` within its class.
+    CpuSlot slot(std::size_t index) const {
+        if (nodes_.empty()) {
+            return CpuSlot();
+        }
+        const NumaNode &node = nodes_[index % nodes_.size()];
+        return CpuSlot{node.id, node.cpus};
+    }
+
+    // Describes where `count` threads run, such as `node 0 (CPUs 0-3): 2, node 1 (CPUs 8-11): 1`.
+    std::string describe(std::size_t count) const;
+
+private:
+    std::vector<NumaNode> nodes_;
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_CPU_TOPOLOGY_HPP_INCLUDED
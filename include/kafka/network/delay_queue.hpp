@@ -0,0 +1,90 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_DELAY_QUEUE_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_DELAY_QUEUE_HPP_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "kafka/network/task.hpp"
+
+namespace kafka {
+
+// Holds suspended coroutines until their deadline, then hands them to the executor they asked
+// for, like Kafka's purgatory holds delayed operations. One thread waits for all deadlines, so
+// a request that waits costs a heap entry instead of a handler thread.
+class DelayQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    DelayQueue();
+
+    ~DelayQueue() {
+        stop();
+    }
+
+    // Suspends the awaiting coroutine until `deadline`, then resumes it on `executor`. Once the
+    // queue is stopped, resumes it right away.
+    auto wait_until(Clock::time_point deadline, Executor &executor) {
+        struct Awaiter {
+            DelayQueue &queue;
+            Clock::time_point deadline;
+            Executor &executor;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> coroutine) {
+                return queue.push(deadline, executor, coroutine);
+            }
+
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, deadline, executor};
+    }
+
+    // Returns the number of coroutines waiting.
+    std::size_t size() const;
+
+    // Stops the thread and hands every waiting coroutine to its executor before its deadline.
+    void stop();
+
+    DelayQueue(const DelayQueue &other) = delete;
+    DelayQueue &operator=(const DelayQueue &other) = delete;
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        // Orders entries with the same deadline by arrival.
+        std::uint64_t sequence;
+        Executor *executor;
+        std::coroutine_handle<> coroutine;
+
+        bool operator>(const Entry &other) const {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> entries_;
+    std::uint64_t next_sequence_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    // Queues a coroutine, or returns false if the queue is stopped.
+    bool push(Clock::time_point deadline, Executor &executor, std::coroutine_handle<> coroutine);
+
+    void run();
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_DELAY_QUEUE_HPP_INCLUDED
@@ -0,0 +1,125 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_MEMORY_POOL_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_MEMORY_POOL_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace kafka {
+
+class MemoryPool;
+
+// Bytes reserved from a `MemoryPool`, given back when the lease is destroyed.
+class MemoryLease {
+public:
+    MemoryLease() : pool_(nullptr), size_(0) {}
+
+    MemoryLease(MemoryLease &&other) noexcept
+        : pool_(std::exchange(other.pool_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    ~MemoryLease() {
+        reset();
+    }
+
+    MemoryLease &operator=(MemoryLease &&other) noexcept {
+        std::swap(pool_, other.pool_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    // Returns the number of bytes reserved.
+    std::size_t size() const {
+        return size_;
+    }
+
+    // Gives the bytes back to the pool.
+    void reset();
+
+    MemoryLease(const MemoryLease &other) = delete;
+    MemoryLease &operator=(const MemoryLease &other) = delete;
+
+private:
+    friend class MemoryPool;
+
+    MemoryLease(MemoryPool *pool, std::size_t size) : pool_(pool), size_(size) {}
+
+    MemoryPool *pool_;
+    std::size_t size_;
+};
+
+// Bounds the memory of the requests that were received but not handled yet, like Kafka's
+// `queued.max.request.bytes`. A connection whose next request does not fit stops being read
+// until enough memory is released, which pushes back on the clients instead of the broker
+// running out of memory.
+class MemoryPool {
+public:
+    struct Stats {
+        std::size_t capacity;
+        // Bytes currently reserved and the most ever reserved at once.
+        std::size_t used;
+        std::size_t peak_used;
+        std::uint64_t allocations;
+        // Connections currently waiting for memory.
+        std::size_t waiting;
+        // Waits that ended with an allocation, and their total and maximum duration.
+        std::uint64_t waits;
+        std::uint64_t total_wait_ns;
+        std::uint64_t max_wait_ns;
+    };
+
+    explicit MemoryPool(std::size_t capacity) : capacity_(capacity) {}
+
+    // Reserves `size` bytes, or returns std::nullopt if they do not fit. A request larger
+    // than the whole pool is admitted once nothing else is reserved.
+    std::optional<MemoryLease> try_allocate(std::size_t size);
+
+    // Like `try_allocate`, but on failure counts the caller as waiting, so that it is told
+    // through the release listener when memory frees up. The caller then retries with
+    // `try_allocate` and reports the wait with `end_wait`.
+    std::optional<MemoryLease> allocate_or_wait(std::size_t size);
+
+    // Stops counting a caller of `allocate_or_wait` as waiting, after a wait of `wait`.
+    void end_wait(std::chrono::nanoseconds wait, bool allocated);
+
+    // Sets the function called, from any thread, when memory is released while callers wait.
+    void set_release_listener(std::function<void()> listener) {
+        release_listener_ = std::move(listener);
+    }
+
+    // Returns a snapshot of the occupancy and wait statistics.
+    Stats stats() const;
+
+    MemoryPool(const MemoryPool &other) = delete;
+    MemoryPool &operator=(const MemoryPool &other) = delete;
+
+private:
+    friend class MemoryLease;
+
+    const std::size_t capacity_;
+    std::atomic<std::size_t> used_{0};
+    std::atomic<std::size_t> peak_used_{0};
+    std::atomic<std::uint64_t> allocations_{0};
+    std::atomic<std::size_t> waiting_{0};
+    std::atomic<std::uint64_t> waits_{0};
+    std::atomic<std::uint64_t> total_wait_ns_{0};
+    std::atomic<std::uint64_t> max_wait_ns_{0};
+    std::function<void()> release_listener_;
+
+    void release(std::size_t size);
+};
+
+inline void MemoryLease::reset() {
+    if (pool_) {
+        pool_->release(size_);
+        pool_ = nullptr;
+        size_ = 0;
+    }
+}
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_MEMORY_POOL_HPP_INCLUDED
@@ -0,0 +1,96 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_MPMC_QUEUE_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_MPMC_QUEUE_HPP_INCLUDED
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace kafka {
+
+// Bounded lock-free multi-producer multi-consumer queue. Every cell carries a sequence number
+// that tells producers and consumers whose turn it is, so neither side ever takes a lock.
+template<typename T>
+class MpmcQueue {
+public:
+    // Creates a queue that holds at least `capacity` elements (rounded up to a power of two).
+    explicit MpmcQueue(std::size_t capacity)
+        : capacity_(std::bit_ceil(capacity < 2 ? std::size_t(2) : capacity)),
+          cells_(std::make_unique<Cell[]>(capacity_)), enqueue_pos_(0), dequeue_pos_(0) {
+        for (std::size_t i = 0; i < capacity_; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Pushes an element unless the queue is full.
+    bool try_push(T &&value) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for ( ; ; ) {
+            Cell &cell = cells_[pos & (capacity_ - 1)];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pops the oldest element unless the queue is empty.
+    bool try_pop(T &value) {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for ( ; ; ) {
+            Cell &cell = cells_[pos & (capacity_ - 1)];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns the approximate number of queued elements.
+    std::size_t size() const {
+        std::size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+        std::size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    MpmcQueue(const MpmcQueue &other) = delete;
+    MpmcQueue &operator=(const MpmcQueue &other) = delete;
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::size_t capacity_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_;
+    alignas(64) std::atomic<std::size_t> dequeue_pos_;
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_MPMC_QUEUE_HPP_INCLUDED
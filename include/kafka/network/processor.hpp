@@ -0,0 +1,119 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_PROCESSOR_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_PROCESSOR_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kafka/metrics/request_metrics.hpp"
+#include "kafka/metrics/request_tracer.hpp"
+#include "kafka/network/request_capture.hpp"
+#include "kafka/network/client.hpp"
+#include "kafka/network/cpu_topology.hpp"
+#include "kafka/network/memory_pool.hpp"
+#include "kafka/network/request_handler_pool.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
+
+namespace kafka {
+
+// Network thread. Owns a set of client connections, reads and frames their requests, hands
+// the frames to the request handler pool and queues the responses in request order, sending
+// them as the sockets become writable. A connection is muted while its next request does not
+// fit in the memory pool, once its queued responses reach the high-water mark until they
+// have been sent, and while its client is throttled for exceeding a quota.
+class Processor {
+public:
+    struct Stats {
+        std::size_t connections;
+        // Response bytes waiting for the sockets.
+        std::size_t output_bytes;
+        // Connections muted because of their queued responses or because of pool memory.
+        std::size_t output_full_connections;
+        std::size_t memory_muted_connections;
+        // Connections muted because their clients exceeded a quota.
+        std::size_t throttled_connections;
+        // Sends that left responses queued because the socket was full.
+        std::uint64_t blocked_sends;
+    };
+
+    // Starts a network thread that runs on the CPUs of `slot`, and hands its requests to the
+    // handler threads of the same node.
+    Processor(RequestHandlerPool &handler_pool, MemoryPool &memory_pool, RequestMetrics &metrics,
+              RequestTracer &tracer, RequestCapture &capture, std::size_t max_request_size,
+              std::size_t output_high_water, const CpuSlot &slot = CpuSlot());
+
+    ~Processor() {
+        stop();
+    }
+
+    // Stops the network thread. Client connections stay open until this processor is destroyed.
+    void stop();
+
+    // Takes ownership of a newly accepted client socket. Called by the acceptor thread.
+    void accept(int client_socket);
+
+    // Notifies this processor that a response for `client` is ready. Called by handler threads.
+    void wakeup(std::shared_ptr<Client> client);
+
+    // Notifies this processor that pool memory was released. Called by any thread.
+    void memory_released();
+
+    // Returns a snapshot of the connection and output queue statistics.
+    Stats stats() const;
+
+    Processor(const Processor &other) = delete;
+    Processor &operator=(const Processor &other) = delete;
+
+private:
+    RequestHandlerPool &handler_pool_;
+    MemoryPool &memory_pool_;
+    RequestMetrics &metrics_;
+    RequestTracer &tracer_;
+    RequestCapture &capture_;
+    std::size_t max_request_size_;
+    std::size_t output_high_water_;
+    // NUMA node of the network thread, or -1.
+    int node_;
+    FileDescriptor epoll_fd_;
+    FileDescriptor wakeup_fd_;
+    std::unordered_map<int, std::shared_ptr<Client>> clients_;
+    // Connections that are not read while their next request waits for pool memory.
+    std::vector<std::shared_ptr<Client>> muted_clients_;
+    // Connections that are not read until their throttle time has passed.
+    std::vector<std::shared_ptr<Client>> throttled_clients_;
+
+    std::atomic<std::size_t> connections_;
+    std::atomic<std::size_t> output_bytes_;
+    std::atomic<std::size_t> output_full_connections_;
+    std::atomic<std::size_t> memory_muted_connections_;
+    std::atomic<std::size_t> throttled_connections_;
+    std::atomic<std::uint64_t> blocked_sends_;
+
+    std::mutex mutex_;
+    std::vector<int> accepted_sockets_;
+    std::vector<std::shared_ptr<Client>> ready_clients_;
+
+    std::atomic<bool> stopping_;
+    std::thread thread_;
+
+    void run();
+    void signal();
+    void register_accepted_clients();
+    void write_ready_responses();
+    void read_requests(const std::shared_ptr<Client> &client);
+    void send_output(const std::shared_ptr<Client> &client);
+    void read_muted_clients();
+    int throttle_timeout() const;
+    void unthrottle_clients();
+    void update_events(const std::shared_ptr<Client> &client);
+    void close(const std::shared_ptr<Client> &client);
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_PROCESSOR_HPP_INCLUDED
@@ -0,0 +1,122 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_REQUEST_CAPTURE_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_REQUEST_CAPTURE_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Whether a captured frame was received from or sent to the client.
+enum class CaptureDirection : INT8 {
+    REQUEST = 0,
+    RESPONSE = 1,
+};
+
+// One frame of a capture file, without its size prefix.
+struct CapturedFrame {
+    CaptureDirection direction;
+    // Time since the capture started.
+    std::chrono::nanoseconds time;
+    // Connection the frame belongs to, numbered from 0 in the order connections were accepted.
+    std::uint32_t connection;
+    BYTES bytes;
+};
+
+// Captures the request frames of every connection as they are received, and the responses as
+// they are sent, into a compact binary file for `kafka_replay`.
+//
+// The file starts with the magic "KCAP" and an INT16 format version. Each frame follows as an
+// INT8 direction, an INT64 time in nanoseconds since the capture started, an INT32 connection
+// number, an INT32 size and the frame bytes, all in network byte order.
+//
+// Network threads append frames to a buffer, which a writer thread writes out, so recording
+// a frame is a copy under a lock and never waits for the disk. Frames that arrive while the
+// buffer is full, or once the file has reached its size limit, are dropped and counted.
+class RequestCapture {
+public:
+    static constexpr char magic[4] = {'K', 'C', 'A', 'P'};
+    static constexpr INT16 format_version = 1;
+
+    // Captures nothing.
+    RequestCapture() = default;
+
+    // Captures into a new file at `path`, up to `max_bytes` (no limit if 0).
+    RequestCapture(const std::string &path, std::size_t max_bytes);
+
+    // Writes the frames still buffered.
+    ~RequestCapture();
+
+    // Whether frames are captured.
+    bool enabled() const {
+        return writer_.joinable();
+    }
+
+    // Numbers a new connection.
+    std::uint32_t next_connection() {
+        return next_connection_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Captures a frame (excluding the size prefix) of a connection.
+    void record(CaptureDirection direction, std::uint32_t connection, std::chrono::steady_clock::time_point time,
+                std::span<const unsigned char> frame);
+
+    // Returns the number of frames dropped so far.
+    std::uint64_t dropped_frames() const {
+        return dropped_frames_.load(std::memory_order_relaxed);
+    }
+
+    RequestCapture(const RequestCapture &other) = delete;
+    RequestCapture &operator=(const RequestCapture &other) = delete;
+
+private:
+    // Frames buffered for the writer at most, beyond which frames are dropped.
+    static constexpr std::size_t max_buffered_bytes = 64 * 1024 * 1024;
+    // Buffered bytes at which the writer is woken before its next periodic write.
+    static constexpr std::size_t write_threshold = 1024 * 1024;
+
+    std::optional<FileDescriptor> file_;
+    std::size_t max_bytes_ = 0;
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<std::uint32_t> next_connection_{0};
+    std::atomic<std::uint64_t> dropped_frames_{0};
+
+    std::mutex mutex_;
+    std::condition_variable buffer_ready_;
+    BYTES buffer_;
+    // Bytes of the file, including those still buffered.
+    std::size_t file_bytes_ = 0;
+    bool stopping_ = false;
+    std::thread writer_;
+
+    void write_buffers();
+};
+
+// Reads the frames of a capture file in the order they were captured.
+class CaptureReader {
+public:
+    // Opens a capture file. Throws if it is not one.
+    explicit CaptureReader(const std::string &path);
+
+    // Reads the next frame, or returns std::nullopt at the end of the file. A frame cut off by
+    // the end of the file, as left by a server that did not shut down, ends the file.
+    std::optional<CapturedFrame> next();
+
+private:
+    std::ifstream file_;
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_REQUEST_CAPTURE_HPP_INCLUDED
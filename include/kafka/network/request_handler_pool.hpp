@@ -0,0 +1,118 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_REQUEST_HANDLER_POOL_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_REQUEST_HANDLER_POOL_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "kafka/network/client.hpp"
+#include "kafka/network/cpu_topology.hpp"
+#include "kafka/network/memory_pool.hpp"
+#include "kafka/network/mpmc_queue.hpp"
+#include "kafka/network/task.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+class Processor;
+
+// A request frame waiting for a handler thread.
+struct QueuedRequest {
+    std::shared_ptr<Client> client;
+    Processor *processor;
+    std::uint64_t sequence;
+    BYTES frame;
+    // Pool memory of the frame, held until the request has been handled.
+    MemoryLease memory;
+    MemoryCharge charge;
+    std::chrono::steady_clock::time_point enqueue_time;
+    std::chrono::steady_clock::time_point dequeue_time;
+};
+
+// Fixed pool of request handler threads. Every thread owns a lock-free queue; idle threads
+// steal from the queues of busy ones, so one slow request doesn't hold up the others. When the
+// threads are placed on NUMA nodes, requests go to the threads of the node that received them
+// and idle threads steal within their node first, so that frames are mostly handled where
+// their memory is. Handlers are coroutines: one that waits suspends without holding its thread,
+// and is queued again here when it can go on.
+class RequestHandlerPool : public Executor {
+public:
+    // Decodes the frame of a request, handles it and returns the encoded response.
+    using Handler = std::function<Task<ResponseFrame>(QueuedRequest &request)>;
+
+    struct QueueStats {
+        // Requests currently waiting in the queue.
+        std::size_t depth;
+        // Requests taken from the queue, by its owner or by other threads.
+        std::uint64_t dequeued;
+        // Requests taken from the queue by other threads.
+        std::uint64_t stolen;
+        // Total and maximum time requests waited in the queue.
+        std::uint64_t total_wait_ns;
+        std::uint64_t max_wait_ns;
+    };
+
+    // Creates `num_threads` handler threads, placed by `placement`, whose queues hold
+    // `queue_capacity` requests in total.
+    RequestHandlerPool(std::size_t num_threads, std::size_t queue_capacity, Handler handler,
+                       const ThreadPlacement &placement = ThreadPlacement());
+
+    ~RequestHandlerPool();
+
+    // Queues a request for handling, on a thread of NUMA node `node` if there is one with room.
+    // Blocks while every queue is full.
+    void submit(std::unique_ptr<QueuedRequest> request, int node = -1);
+
+    // Queues a suspended handler to be resumed. Blocks while every queue is full.
+    void post(std::coroutine_handle<> coroutine) override;
+
+    // Returns a snapshot of the statistics of every queue.
+    std::vector<QueueStats> queue_stats() const;
+
+    RequestHandlerPool(const RequestHandlerPool &other) = delete;
+    RequestHandlerPool &operator=(const RequestHandlerPool &other) = delete;
+
+private:
+    // A new request, or else a handler to resume.
+    struct Job {
+        std::unique_ptr<QueuedRequest> request;
+        std::coroutine_handle<> coroutine;
+    };
+
+    struct Worker {
+        Worker(std::size_t queue_capacity, CpuSlot slot) : queue(queue_capacity), slot(std::move(slot)) {}
+
+        MpmcQueue<Job> queue;
+        CpuSlot slot;
+        // The workers this one takes from: itself, then those of its node, then the others.
+        std::vector<std::size_t> take_order;
+        std::atomic<std::uint64_t> dequeued{0};
+        std::atomic<std::uint64_t> stolen{0};
+        std::atomic<std::uint64_t> total_wait_ns{0};
+        std::atomic<std::uint64_t> max_wait_ns{0};
+        std::thread thread;
+    };
+
+    Handler handler_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::size_t> next_worker_;
+    // Number of queued requests and handlers; idle threads wait on it.
+    std::atomic<std::size_t> pending_;
+    std::atomic<bool> stopping_;
+
+    void push(Job job, int node);
+    void run(std::size_t index);
+    bool take(std::size_t index, Job &job);
+    DetachedTask handle(std::unique_ptr<QueuedRequest> request);
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_REQUEST_HANDLER_POOL_HPP_INCLUDED
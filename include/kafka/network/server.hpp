@@ -1,36 +1,107 @@
 #ifndef CODECRAFTERS_KAFKA_NETWORK_SERVER_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_NETWORK_SERVER_HPP_INCLUDED
 
+#include <memory>
+#include <string>
 #include <unistd.h>
 #include <utility>
+#include <vector>
+
+#include "kafka/config/server_config.hpp"
+#include "kafka/network/client_quota_manager.hpp"
+#include "kafka/network/delay_queue.hpp"
+#include "kafka/metrics/metrics_server.hpp"
+#include "kafka/metrics/perf_profile.hpp"
+#include "kafka/metrics/request_metrics.hpp"
+#include "kafka/metrics/request_tracer.hpp"
+#include "kafka/network/memory_pool.hpp"
+#include "kafka/network/processor.hpp"
+#include "kafka/network/request_capture.hpp"
+#include "kafka/network/request_handler_pool.hpp"
 
 namespace kafka {
 
 // Kafka server that communicates with clients via TCP protocol.
 class Server {
 public:
-    Server();
-    Server(Server &&other) noexcept : server_socket_(std::exchange(other.server_socket_, -1)) {}
+    explicit Server(ServerConfig config = ServerConfig());
+    Server(Server &&other) noexcept
+        : config_(std::move(other.config_)), server_socket_(std::exchange(other.server_socket_, -1)),
+          memory_pool_(std::move(other.memory_pool_)), quota_manager_(std::move(other.quota_manager_)),
+          request_metrics_(std::move(other.request_metrics_)), request_tracer_(std::move(other.request_tracer_)),
+          request_capture_(std::move(other.request_capture_)), perf_profile_(std::move(other.perf_profile_)),
+          delay_queue_(std::move(other.delay_queue_)), handler_pool_(std::move(other.handler_pool_)),
+          processors_(std::move(other.processors_)), metrics_server_(std::move(other.metrics_server_)) {}
 
     ~Server() {
+        // The metrics endpoint reads everything else.
+        metrics_server_.reset();
+        // Processors submit to the handler pool and handler threads notify processors, so stop
+        // the processor threads first but keep the processors alive until the pool is gone.
+        for (auto &processor : processors_) {
+            processor->stop();
+        }
+        // Waiting requests are resumed early, so that the pool finishes them before it stops.
+        if (delay_queue_) {
+            delay_queue_->stop();
+        }
+        handler_pool_.reset();
+        if (memory_pool_) {
+            memory_pool_->set_release_listener(nullptr);
+        }
+        processors_.clear();
         if (server_socket_ >= 0) {
             close(server_socket_);
         }
     }
 
     Server &operator=(Server &&other) noexcept {
+        std::swap(config_, other.config_);
         std::swap(server_socket_, other.server_socket_);
+        std::swap(memory_pool_, other.memory_pool_);
+        std::swap(quota_manager_, other.quota_manager_);
+        std::swap(request_metrics_, other.request_metrics_);
+        std::swap(request_tracer_, other.request_tracer_);
+        std::swap(request_capture_, other.request_capture_);
+        std::swap(perf_profile_, other.perf_profile_);
+        std::swap(delay_queue_, other.delay_queue_);
+        std::swap(handler_pool_, other.handler_pool_);
+        std::swap(processors_, other.processors_);
+        std::swap(metrics_server_, other.metrics_server_);
         return *this;
     }
 
-    // Starts accepting client connections and serving their requests.
+    // Recovers the partition logs, then starts accepting client connections and serving their
+    // requests.
     void start();
 
     Server(const Server &other) = delete;
     Server &operator=(const Server &other) = delete;
 
 private:
+    ServerConfig config_;
     int server_socket_;
+    // Memory of the requests received but not handled yet. Outlives the connections.
+    std::unique_ptr<MemoryPool> memory_pool_;
+    // Rates of the clients, shared by the handler threads.
+    std::unique_ptr<ClientQuotaManager> quota_manager_;
+    // Latencies and counters, recorded by the network and handler threads.
+    std::unique_ptr<RequestMetrics> request_metrics_;
+    // Traces of the latest requests and the slow-request log.
+    std::unique_ptr<RequestTracer> request_tracer_;
+    // Capture of the traffic, if configured. Outlives the connections.
+    std::unique_ptr<RequestCapture> request_capture_;
+    // Hardware and scheduler events per API and stage, if enabled.
+    std::unique_ptr<PerfProfile> perf_profile_;
+    // Requests that wait, such as Fetches waiting for records, without holding a handler thread.
+    std::unique_ptr<DelayQueue> delay_queue_;
+    std::unique_ptr<RequestHandlerPool> handler_pool_;
+    std::vector<std::unique_ptr<Processor>> processors_;
+    std::unique_ptr<MetricsServer> metrics_server_;
+
+    // Appends the request metrics and the gauges of the network threads, handler queues and
+    // memory pool, in the Prometheus text format.
+    void write_metrics(std::string &out) const;
 };
 
 }
@@ -0,0 +1,168 @@
+#ifndef CODECRAFTERS_KAFKA_NETWORK_TASK_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_NETWORK_TASK_HPP_INCLUDED
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace kafka {
+
+// Allocates coroutine frames from free lists of the calling thread, so that a request whose
+// handlers never suspend costs no call to the global allocator once the lists are warm. Frames
+// are binned into power-of-two size classes; larger ones go to `operator new`. A frame freed on
+// another thread than it was allocated on joins the free lists of that thread.
+class CoroutineFrameAllocator {
+public:
+    static constexpr std::size_t min_frame_size = 256;
+    static constexpr std::size_t max_frame_size = 16 * 1024;
+    // Frames kept per size class and thread; the rest are freed.
+    static constexpr std::size_t max_free_frames = 64;
+
+    static void *allocate(std::size_t size);
+    static void deallocate(void *frame, std::size_t size) noexcept;
+};
+
+// Base of the promise types, which makes their frames come from `CoroutineFrameAllocator`.
+struct CoroutineFrame {
+    static void *operator new(std::size_t size) {
+        return CoroutineFrameAllocator::allocate(size);
+    }
+
+    static void operator delete(void *frame, std::size_t size) noexcept {
+        CoroutineFrameAllocator::deallocate(frame, size);
+    }
+};
+
+// Resumes suspended coroutines on threads of its own.
+class Executor {
+public:
+    // Resumes `coroutine` on one of the threads, later.
+    virtual void post(std::coroutine_handle<> coroutine) = 0;
+
+protected:
+    ~Executor() = default;
+};
+
+// A coroutine returning a `T`, which starts when it is awaited and resumes its awaiter when it
+// returns. A task can also hold a value right away, which costs no frame, for handlers that
+// never suspend.
+template<typename T>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : CoroutineFrame {
+        std::optional<T> value;
+        std::exception_ptr exception;
+        std::coroutine_handle<> awaiter = std::noop_coroutine();
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        auto final_suspend() noexcept {
+            struct ResumeAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> coroutine) noexcept {
+                    return coroutine.promise().awaiter;
+                }
+
+                void await_resume() noexcept {}
+            };
+            return ResumeAwaiter{};
+        }
+
+        template<std::convertible_to<T> U>
+        void return_value(U &&result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        void unhandled_exception() {
+            exception = std::current_exception();
+        }
+    };
+
+    // A task that has already returned `value`.
+    template<std::convertible_to<T> U>
+    Task(U &&value) : value_(std::in_place, std::forward<U>(value)) {}
+
+    Task(Task &&other) noexcept
+        : coroutine_(std::exchange(other.coroutine_, nullptr)), value_(std::move(other.value_)) {}
+
+    ~Task() {
+        if (coroutine_) {
+            coroutine_.destroy();
+        }
+    }
+
+    Task &operator=(Task other) noexcept {
+        std::swap(coroutine_, other.coroutine_);
+        std::swap(value_, other.value_);
+        return *this;
+    }
+
+    bool await_ready() const noexcept {
+        return !coroutine_;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        coroutine_.promise().awaiter = awaiter;
+        return coroutine_;
+    }
+
+    // Returns the value of the task, or throws what escaped its coroutine.
+    T await_resume() {
+        if (!coroutine_) {
+            return std::move(*value_);
+        }
+        auto &promise = coroutine_.promise();
+        if (promise.exception) {
+            std::rethrow_exception(promise.exception);
+        }
+        return std::move(*promise.value);
+    }
+
+    Task(const Task &other) = delete;
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> coroutine) : coroutine_(coroutine) {}
+
+    std::coroutine_handle<promise_type> coroutine_;
+    std::optional<T> value_;
+};
+
+// A coroutine that starts right away and frees itself when it returns. Nothing waits for it, so
+// it must not let exceptions escape.
+struct DetachedTask {
+    struct promise_type : CoroutineFrame {
+        DetachedTask get_return_object() noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_NETWORK_TASK_HPP_INCLUDED
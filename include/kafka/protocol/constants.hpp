@@ -1,6 +1,10 @@
 #ifndef CODECRAFTERS_KAFKA_PROTOCOL_CONSTANTS_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_PROTOCOL_CONSTANTS_HPP_INCLUDED
 
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
 #include "kafka/protocol/types.hpp"
 
 namespace kafka {
@@ -8,6 +12,7 @@ namespace kafka {
 // Numeric codes that represent different types of requests.
 enum class ApiKey : INT16 {
     FETCH = 1,
+    METADATA = 3,
     API_VERSIONS = 18,
     DESCRIBE_TOPIC_PARTITIONS = 75,
 };
@@ -19,10 +24,65 @@ enum class ErrorCode : INT16 {
     UNKNOWN_TOPIC_OR_PARTITION = 3,
     // The version of API is not supported.
     UNSUPPORTED_VERSION = 35,
+    // Disk error when trying to access log file on the disk.
+    KAFKA_STORAGE_ERROR = 56,
     // This server does not host this topic ID.
     UNKNOWN_TOPIC_ID = 100,
 };
 
+// Returns the name Kafka uses for an API, such as "Fetch".
+constexpr std::string_view api_name(ApiKey api_key) {
+    switch (api_key) {
+    case ApiKey::FETCH:
+        return "Fetch";
+    case ApiKey::METADATA:
+        return "Metadata";
+    case ApiKey::API_VERSIONS:
+        return "ApiVersions";
+    case ApiKey::DESCRIBE_TOPIC_PARTITIONS:
+        return "DescribeTopicPartitions";
+    }
+    return "Unknown";
+}
+
+// Every `ErrorCode`, so that statistics can be kept per error.
+inline constexpr ErrorCode error_codes[] = {
+    ErrorCode::NONE,
+    ErrorCode::UNKNOWN_TOPIC_OR_PARTITION,
+    ErrorCode::UNSUPPORTED_VERSION,
+    ErrorCode::KAFKA_STORAGE_ERROR,
+    ErrorCode::UNKNOWN_TOPIC_ID,
+};
+
+inline constexpr std::size_t error_code_count = std::size(error_codes);
+
+// Returns the position of an error code in `error_codes`.
+constexpr std::size_t error_code_index(ErrorCode error_code) {
+    for (std::size_t i = 0; i < error_code_count; i++) {
+        if (error_codes[i] == error_code) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// Returns the name Kafka uses for an error code, such as "UNKNOWN_TOPIC_ID".
+constexpr std::string_view error_code_name(ErrorCode error_code) {
+    switch (error_code) {
+    case ErrorCode::NONE:
+        return "NONE";
+    case ErrorCode::UNKNOWN_TOPIC_OR_PARTITION:
+        return "UNKNOWN_TOPIC_OR_PARTITION";
+    case ErrorCode::UNSUPPORTED_VERSION:
+        return "UNSUPPORTED_VERSION";
+    case ErrorCode::KAFKA_STORAGE_ERROR:
+        return "KAFKA_STORAGE_ERROR";
+    case ErrorCode::UNKNOWN_TOPIC_ID:
+        return "UNKNOWN_TOPIC_ID";
+    }
+    return "UNKNOWN_SERVER_ERROR";
+}
+
 }
 
 #endif  // CODECRAFTERS_KAFKA_PROTOCOL_CONSTANTS_HPP_INCLUDED
@@ -0,0 +1,18 @@
+#ifndef CODECRAFTERS_KAFKA_PROTOCOL_CRC32C_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_PROTOCOL_CRC32C_HPP_INCLUDED
+
+#include <cstddef>
+
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Computes the CRC-32C (Castagnoli) checksum that protects record batches.
+UINT32 crc32c(const void *data, std::size_t nbytes);
+
+// Extends `crc`, the checksum of the bytes before `data`, over `data`.
+UINT32 crc32c(UINT32 crc, const void *data, std::size_t nbytes);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_PROTOCOL_CRC32C_HPP_INCLUDED
@@ -0,0 +1,214 @@
+#ifndef CODECRAFTERS_KAFKA_PROTOCOL_FIELD_CODEC_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_PROTOCOL_FIELD_CODEC_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "kafka/protocol/ireadable.hpp"
+#include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/types.hpp"
+#include "kafka/utils.hpp"
+
+// Building blocks of the message classes generated from Kafka's JSON schemas. `Flexible`
+// selects the compact encodings that flexible versions use for lengths.
+
+namespace kafka {
+
+// Returns the number of bytes of an unsigned varint.
+constexpr std::size_t unsigned_varint_size(UNSIGNED_VARLONG n) {
+    return n == 0 ? 1 : (std::bit_width(n) + 6) / 7;
+}
+
+// Skips a specified number of bytes of a byte stream.
+inline void skip_bytes(IReadable &readable, std::size_t nbytes) {
+    char discard[256];
+    while (nbytes > 0) {
+        std::size_t chunk = std::min(nbytes, sizeof(discard));
+        readable.read(discard, chunk);
+        nbytes -= chunk;
+    }
+}
+
+inline std::uint16_t read_uint16(IReadable &readable) {
+    return static_cast<std::uint16_t>(read_int16(readable));
+}
+
+inline void write_uint16(IWritable &writable, std::uint16_t n) {
+    write_int16(writable, static_cast<INT16>(n));
+}
+
+inline double read_float64(IReadable &readable) {
+    return std::bit_cast<double>(read_int64(readable));
+}
+
+inline void write_float64(IWritable &writable, double n) {
+    write_int64(writable, std::bit_cast<INT64>(n));
+}
+
+// Reads the length of an array or of a byte string. Returns -1 for null.
+template<bool Flexible>
+INT32 read_length(IReadable &readable) {
+    if constexpr (Flexible) {
+        return static_cast<INT32>(read_unsigned_varint(readable)) - 1;
+    } else {
+        return read_int32(readable);
+    }
+}
+
+// Writes the length of an array or of a byte string. -1 stands for null.
+template<bool Flexible>
+void write_length(IWritable &writable, INT32 n) {
+    if constexpr (Flexible) {
+        write_unsigned_varint(writable, static_cast<UNSIGNED_VARINT>(n + 1));
+    } else {
+        write_int32(writable, n);
+    }
+}
+
+template<bool Flexible>
+constexpr std::size_t length_size(INT32 n) {
+    if constexpr (Flexible) {
+        return unsigned_varint_size(static_cast<UNSIGNED_VARINT>(n + 1));
+    } else {
+        return sizeof(INT32);
+    }
+}
+
+// Reads the length of a string, which has only two bytes in non-flexible versions.
+template<bool Flexible>
+INT32 read_string_length(IReadable &readable) {
+    if constexpr (Flexible) {
+        return read_length<true>(readable);
+    } else {
+        return read_int16(readable);
+    }
+}
+
+template<bool Flexible>
+void write_string_length(IWritable &writable, INT32 n) {
+    if constexpr (Flexible) {
+        write_length<true>(writable, n);
+    } else {
+        write_int16(writable, static_cast<INT16>(n));
+    }
+}
+
+template<bool Flexible>
+constexpr std::size_t string_length_size(INT32 n) {
+    if constexpr (Flexible) {
+        return length_size<true>(n);
+    } else {
+        return sizeof(INT16);
+    }
+}
+
+template<bool Flexible>
+std::optional<std::string> read_nullable_string_field(IReadable &readable) {
+    INT32 n = read_string_length<Flexible>(readable);
+    if (n < 0) {
+        return std::nullopt;
+    }
+    check_length(readable, n);
+    std::string str(n, 0);
+    readable.read(str.data(), str.size());
+    return str;
+}
+
+template<bool Flexible>
+std::string read_string_field(IReadable &readable) {
+    return read_nullable_string_field<Flexible>(readable).value_or(std::string());
+}
+
+template<bool Flexible>
+void write_string_field(IWritable &writable, std::string_view str) {
+    write_string_length<Flexible>(writable, static_cast<INT32>(str.size()));
+    writable.write(str.data(), str.size());
+}
+
+template<bool Flexible>
+void write_nullable_string_field(IWritable &writable, const std::optional<std::string> &str) {
+    if (str) {
+        write_string_field<Flexible>(writable, *str);
+    } else {
+        write_string_length<Flexible>(writable, -1);
+    }
+}
+
+template<bool Flexible>
+std::size_t string_field_size(std::string_view str) {
+    return string_length_size<Flexible>(static_cast<INT32>(str.size())) + str.size();
+}
+
+template<bool Flexible>
+std::size_t nullable_string_field_size(const std::optional<std::string> &str) {
+    return str ? string_field_size<Flexible>(*str) : string_length_size<Flexible>(-1);
+}
+
+template<bool Flexible>
+std::optional<BYTES> read_nullable_bytes_field(IReadable &readable) {
+    INT32 n = read_length<Flexible>(readable);
+    if (n < 0) {
+        return std::nullopt;
+    }
+    check_length(readable, n);
+    BYTES bytes(n);
+    readable.read(bytes.data(), bytes.size());
+    return bytes;
+}
+
+template<bool Flexible>
+BYTES read_bytes_field(IReadable &readable) {
+    return read_nullable_bytes_field<Flexible>(readable).value_or(BYTES());
+}
+
+template<bool Flexible>
+void write_bytes_field(IWritable &writable, const BYTES &bytes) {
+    write_length<Flexible>(writable, static_cast<INT32>(bytes.size()));
+    writable.write(bytes.data(), bytes.size());
+}
+
+template<bool Flexible>
+void write_nullable_bytes_field(IWritable &writable, const std::optional<BYTES> &bytes) {
+    if (bytes) {
+        write_bytes_field<Flexible>(writable, *bytes);
+    } else {
+        write_length<Flexible>(writable, -1);
+    }
+}
+
+template<bool Flexible>
+std::size_t bytes_field_size(const BYTES &bytes) {
+    return length_size<Flexible>(static_cast<INT32>(bytes.size())) + bytes.size();
+}
+
+template<bool Flexible>
+std::size_t nullable_bytes_field_size(const std::optional<BYTES> &bytes) {
+    return bytes ? bytes_field_size<Flexible>(*bytes) : length_size<Flexible>(-1);
+}
+
+// Calls `function.template operator()<Version>()` with the run-time `version`, through a
+// table of one instantiation per version from `MinVersion` to `MaxVersion`.
+template<INT16 MinVersion, INT16 MaxVersion, typename Function>
+decltype(auto) visit_version(INT16 version, Function &&function) {
+    if (version < MinVersion || version > MaxVersion) {
+        throw_runtime_error("unsupported message version");
+    }
+    return [&]<INT16... Offsets>(std::integer_sequence<INT16, Offsets...>) -> decltype(auto) {
+        using Result = decltype(function.template operator()<MinVersion>());
+        static constexpr std::array<Result (*)(Function &), sizeof...(Offsets)> table = {
+            [](Function &f) -> Result { return f.template operator()<static_cast<INT16>(MinVersion + Offsets)>(); }...};
+        return table[version - MinVersion](function);
+    }(std::make_integer_sequence<INT16, MaxVersion - MinVersion + 1>());
+}
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_PROTOCOL_FIELD_CODEC_HPP_INCLUDED
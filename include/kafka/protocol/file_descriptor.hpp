@@ -1,7 +1,10 @@
 #ifndef CODECRAFTERS_KAFKA_PROTOCOL_FILE_DESCRIPTOR_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_PROTOCOL_FILE_DESCRIPTOR_HPP_INCLUDED
 
+#include <cerrno>
+#include <expected>
 #include <fcntl.h>
+#include <system_error>
 #include <unistd.h>
 #include <utility>
 
@@ -23,6 +26,15 @@ public:
         }
     }
 
+    // Opens a file, or returns the error, for callers that expect the file to be missing.
+    static std::expected<FileDescriptor, std::error_code> try_open(const char *path, int mode) noexcept {
+        int fd = ::open(path, mode);
+        if (fd < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        return FileDescriptor(fd);
+    }
+
     FileDescriptor(FileDescriptor &&other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
 
     ~FileDescriptor() {
@@ -36,9 +48,18 @@ public:
         return *this;
     }
 
+    // Returns the underlying UNIX file descriptor.
+    int get() const {
+        return fd_;
+    }
+
     // Reads a specified number of bytes from this file descriptor.
     void read(void *dst, std::size_t nbytes) override;
 
+    // Reads at most a specified number of bytes from this file descriptor with a single
+    // system call. Returns the number of bytes read, or 0 at end of file.
+    std::size_t read_some(void *dst, std::size_t nbytes);
+
     // Writes a specified number of bytes to this file descriptor.
     void write(const void *src, std::size_t nbytes) override;
 
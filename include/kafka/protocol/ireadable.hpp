@@ -2,6 +2,7 @@
 #define CODECRAFTERS_KAFKA_PROTOCOL_IREADABLE_HPP_INCLUDED
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 
 #include "kafka/protocol/constants.hpp"
@@ -17,8 +18,18 @@ public:
 
     // Reads a specified number of bytes from this byte stream.
     virtual void read(void *dst, std::size_t nbytes) = 0;
+
+    // Returns the number of bytes left in this byte stream, or `SIZE_MAX` if it is not known.
+    virtual std::size_t remaining() const {
+        return SIZE_MAX;
+    }
 };
 
+// Throws if a length read from a byte stream claims more elements than there are bytes left in
+// it, so that nothing is allocated for them. Every element takes at least one byte. Negative
+// lengths, which stand for null, pass.
+void check_length(IReadable &readable, INT64 n);
+
 // Reads an INT8 from a byte stream.
 INT8 read_int8(IReadable &readable);
 
@@ -65,6 +76,7 @@ inline ARRAY<T> read_array(IReadable &readable) {
     if (n < 0) {
         return {};
     }
+    check_length(readable, n);
     ARRAY<T> arr(n);
     for (T &object : arr) {
         object.read(readable);
@@ -79,7 +91,8 @@ inline COMPACT_ARRAY<T> read_compact_array(IReadable &readable) {
     if (n == 0) {
         return {};
     }
-    COMPACT_ARRAY<T> arr(--n);
+    check_length(readable, --n);
+    COMPACT_ARRAY<T> arr(n);
     for (T &object : arr) {
         object.read(readable);
     }
@@ -96,15 +109,16 @@ inline COMPACT_ARRAY<T> read_compact_array(IReadable &readable, const ReadObject
     if (n == 0) {
         return {};
     }
+    check_length(readable, --n);
     COMPACT_ARRAY<T> arr;
-    arr.reserve(--n);
+    arr.reserve(n);
     while (n--) {
         arr.push_back(read_function(readable));
     }
     return arr;
 }
 
-// Reads tagged fields from a byte stream.
+// Reads tagged fields from a byte stream, skipping every field.
 void read_tagged_fields(IReadable &readable);
 
 // Reads an `ApiKey` from a byte stream.
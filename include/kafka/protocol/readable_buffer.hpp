@@ -26,6 +26,16 @@ public:
         index_ += nbytes;
     }
 
+    // Returns the number of bytes not read yet.
+    std::size_t remaining() const override {
+        return bytes_.size() - index_;
+    }
+
+    // Returns the number of bytes read so far.
+    std::size_t position() const {
+        return index_;
+    }
+
     // Returns the underlying byte buffer.
     const BYTES &buffer() const {
         return bytes_;
@@ -2,6 +2,7 @@
 #define CODECRAFTERS_KAFKA_PROTOCOL_UUID_HPP_INCLUDED
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <ostream>
 
@@ -38,6 +39,10 @@ private:
     unsigned char data_[16];
 };
 
+inline bool operator==(const UUID &uuid1, const UUID &uuid2) {
+    return std::memcmp(uuid1.data(), uuid2.data(), uuid1.size()) == 0;
+}
+
 // Utility class that allows UUID to be stored as key in std::map.
 struct UUIDCompare {
     bool operator()(const UUID &uuid1, const UUID &uuid2) const {
@@ -45,6 +50,21 @@ struct UUIDCompare {
     }
 };
 
+// Utility class that allows UUID to be used as key in hash tables. Topic IDs are random,
+// so folding both halves together and mixing the result is enough.
+struct UUIDHash {
+    std::size_t operator()(const UUID &uuid) const {
+        std::uint64_t high, low;
+        std::memcpy(&high, uuid.data(), sizeof(high));
+        std::memcpy(&low, uuid.data() + sizeof(high), sizeof(low));
+        std::uint64_t h = high ^ (low * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ULL;
+        h ^= h >> 32;
+        return h;
+    }
+};
+
 }
 
 #endif  // CODECRAFTERS_KAFKA_PROTOCOL_UUID_HPP_INCLUDED
@@ -1,6 +1,8 @@
 #ifndef CODECRAFTERS_KAFKA_PROTOCOL_WRITABLE_BUFFER_HPP_INCLUDED
 #define CODECRAFTERS_KAFKA_PROTOCOL_WRITABLE_BUFFER_HPP_INCLUDED
 
+#include <utility>
+
 #include "kafka/protocol/iwritable.hpp"
 #include "kafka/protocol/types.hpp"
 
@@ -20,6 +22,11 @@ public:
         return bytes_;
     }
 
+    // Moves the underlying byte buffer out of this byte buffer.
+    BYTES release() {
+        return std::move(bytes_);
+    }
+
 private:
     BYTES bytes_;
 };
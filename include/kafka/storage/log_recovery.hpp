@@ -0,0 +1,52 @@
+#ifndef CODECRAFTERS_KAFKA_STORAGE_LOG_RECOVERY_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_STORAGE_LOG_RECOVERY_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Offsets up to which every partition log is known to be intact, keyed by partition
+// directory name (`<topic>-<partition>`).
+using RecoveryPoints = std::map<std::string, INT64>;
+
+// Reads a `recovery-point-offset-checkpoint` file. A missing file yields no recovery points.
+RecoveryPoints read_recovery_point_checkpoint(const std::string &path);
+
+// Writes a `recovery-point-offset-checkpoint` file, replacing the previous one atomically.
+void write_recovery_point_checkpoint(const std::string &path, const RecoveryPoints &recovery_points);
+
+// Outcome of recovering the partition logs of a log directory.
+struct RecoveryStats {
+    std::size_t partitions = 0;
+    std::size_t segments_scanned = 0;
+    std::uint64_t bytes_scanned = 0;
+    std::uint64_t batches_validated = 0;
+    // Bytes cut from torn or corrupted segment tails, including segments deleted after them.
+    std::uint64_t bytes_truncated = 0;
+    // Bytes of torn or corrupted segment tails that were reported but left in place.
+    std::uint64_t bytes_damaged = 0;
+    // Partitions that could not be recovered, such as after an I/O error, and were skipped.
+    std::size_t partitions_failed = 0;
+    std::size_t indexes_rebuilt = 0;
+    std::chrono::milliseconds elapsed{0};
+};
+
+// Recovers every partition log in `log_dir` on `num_threads` threads. Batches after each
+// partition's recovery point are validated (length, magic and CRC); a partition without one in
+// the checkpoint, as on the first start, is validated from its log start. Damage is
+// reported, and if `truncate` is set, a segment is truncated at its first invalid batch and
+// the segments after it are deleted. Offset and time indexes are rebuilt for validated segments
+// and wherever they are missing, except for damaged segments left in place. A partition that
+// fails to recover is reported and skipped. Finally, the recovery points are advanced to the
+// log end offsets.
+RecoveryStats recover_logs(const std::string &log_dir, std::size_t num_threads, bool truncate);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_STORAGE_LOG_RECOVERY_HPP_INCLUDED
@@ -0,0 +1,43 @@
+#ifndef CODECRAFTERS_KAFKA_STORAGE_RECORD_BATCH_FORMAT_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_STORAGE_RECORD_BATCH_FORMAT_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "kafka/protocol/crc32c.hpp"
+#include "kafka/protocol/types.hpp"
+#include "kafka/utils.hpp"
+
+namespace kafka {
+
+// Layout of a record batch (magic 2) in a partition log.
+
+// Bytes before the batch length counts from: the base offset and the batch length.
+inline constexpr std::size_t batch_header_size = sizeof(INT64) + sizeof(INT32);
+inline constexpr std::size_t magic_position = 16;
+inline constexpr std::size_t crc_position = 17;
+// Where the data that the CRC covers starts.
+inline constexpr std::size_t attributes_position = 21;
+// The batch length of a batch without records.
+inline constexpr INT32 min_batch_length = 49;
+inline constexpr INT8 current_magic = 2;
+
+// Returns whether the `size` bytes at `batch`, one whole batch, have the current magic and a
+// matching CRC.
+inline bool record_batch_valid(const unsigned char *batch, std::size_t size) {
+    if (size < batch_header_size + min_batch_length || static_cast<INT8>(batch[magic_position]) != current_magic) {
+        return false;
+    }
+    UINT32 crc;
+    std::memcpy(&crc, batch + crc_position, sizeof(crc));
+    return to_host_byte_order(crc) == crc32c(batch + attributes_position, size - attributes_position);
+}
+
+// Encodes a record batch at `base_offset` holding a record with a null key per value, with
+// its CRC.
+BYTES encode_record_batch(INT64 base_offset, const std::vector<BYTES> &values);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_STORAGE_RECORD_BATCH_FORMAT_HPP_INCLUDED
@@ -0,0 +1,75 @@
+#ifndef CODECRAFTERS_KAFKA_STORAGE_SEGMENT_READER_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_STORAGE_SEGMENT_READER_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "kafka/protocol/types.hpp"
+
+namespace kafka {
+
+// Reads segment files for Fetches and tells the kernel how. A segment is read front to back,
+// so the kernel is told to read ahead further than usual. Every read first asks only for what
+// is in the page cache (`RWF_NOWAIT`); the first time part of a segment is not, the kernel is
+// told to read in the rest of it, and the read waits for the disk only for that part. This
+// also counts exactly how many bytes came from the page cache and how many from the disk.
+class SegmentReader {
+public:
+    // Bytes read per system call that waits for the disk.
+    static constexpr std::size_t disk_read_size = 256 * 1024;
+
+    struct Stats {
+        std::uint64_t reads;
+        // Reads that waited for the disk.
+        std::uint64_t cold_reads;
+        std::uint64_t page_cache_bytes;
+        std::uint64_t disk_bytes;
+        // Bytes dropped from the page cache after cold reads.
+        std::uint64_t dropped_bytes;
+    };
+
+    // Returns the only instance of `SegmentReader`.
+    static SegmentReader &get_instance();
+
+    // Drops segments of at least `bytes` that are no longer active from the page cache once they
+    // have been read, if the read had to wait for the disk, so that a consumer catching up on old
+    // segments does not evict the active ones that other consumers keep reading. 0 drops none.
+    void set_cold_read_drop_bytes(std::size_t bytes) {
+        cold_read_drop_bytes_.store(bytes, std::memory_order_relaxed);
+    }
+
+    // Reads up to `size` bytes from the start of the file `fd`, stopping early at its end.
+    // `inactive` tells whether the file is a segment that is no longer appended to; it is only
+    // called for a cold read that could be dropped.
+    BYTES read(int fd, std::size_t size, const std::function<bool()> &inactive);
+
+    // Returns the totals of every read so far.
+    Stats stats() const;
+
+    // Appends the bytes read from the page cache and the disk, and the hit ratio, in the
+    // Prometheus text exposition format.
+    void write_prometheus(std::string &out) const;
+
+    SegmentReader(const SegmentReader &other) = delete;
+    SegmentReader &operator=(const SegmentReader &other) = delete;
+
+private:
+    std::atomic<std::size_t> cold_read_drop_bytes_{0};
+    // Cleared when the file system does not support `RWF_NOWAIT`; reads then always wait and
+    // are not classified.
+    std::atomic<bool> nowait_supported_{true};
+    std::atomic<std::uint64_t> reads_{0};
+    std::atomic<std::uint64_t> cold_reads_{0};
+    std::atomic<std::uint64_t> page_cache_bytes_{0};
+    std::atomic<std::uint64_t> disk_bytes_{0};
+    std::atomic<std::uint64_t> dropped_bytes_{0};
+
+    SegmentReader() = default;
+};
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_STORAGE_SEGMENT_READER_HPP_INCLUDED
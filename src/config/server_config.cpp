@@ -0,0 +1,172 @@
+#include "kafka/config/server_config.hpp"
+#include "kafka/network/cpu_topology.hpp"
+#include "kafka/utils.hpp"
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace kafka {
+
+static std::string trim(const std::string &str) {
+    const char *whitespace = " \t\r\n";
+    auto first = str.find_first_not_of(whitespace);
+    if (first == std::string::npos) {
+        return "";
+    }
+    auto last = str.find_last_not_of(whitespace);
+    return str.substr(first, last - first + 1);
+}
+
+Properties read_properties(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw_system_error(path.c_str());
+    }
+
+    Properties properties;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == '!') {
+            continue;
+        }
+        auto separator = line.find_first_of("=:");
+        if (separator == std::string::npos) {
+            continue;
+        }
+        properties[trim(line.substr(0, separator))] = trim(line.substr(separator + 1));
+    }
+    return properties;
+}
+
+static void read_size(const Properties &properties, const char *key, std::size_t &value) {
+    auto iter = properties.find(key);
+    if (iter == properties.end()) {
+        return;
+    }
+    try {
+        value = std::stoull(iter->second);
+    } catch (...) {
+        throw_runtime_error(std::format("invalid value for {}: {}", key, iter->second).c_str());
+    }
+}
+
+static void read_bool(const Properties &properties, const char *key, bool &value) {
+    auto iter = properties.find(key);
+    if (iter == properties.end()) {
+        return;
+    }
+    if (iter->second != "true" && iter->second != "false") {
+        throw_runtime_error(std::format("invalid value for {}: {}", key, iter->second).c_str());
+    }
+    value = iter->second == "true";
+}
+
+static void read_cpu_list(const Properties &properties, const char *key, std::vector<int> &value) {
+    auto iter = properties.find(key);
+    if (iter == properties.end()) {
+        return;
+    }
+    try {
+        value = parse_cpu_list(iter->second);
+    } catch (...) {
+        throw_runtime_error(std::format("invalid value for {}: {}", key, iter->second).c_str());
+    }
+}
+
+// Reads the host and port of the first listener of an `advertised.listeners` list such as
+// `PLAINTEXT://localhost:9092,CONTROLLER://localhost:9093`.
+static void read_advertised_listener(const Properties &properties, std::string &host, INT32 &port) {
+    auto iter = properties.find("advertised.listeners");
+    if (iter == properties.end()) {
+        return;
+    }
+    std::string listener = trim(iter->second.substr(0, iter->second.find(',')));
+    auto scheme_end = listener.find("://");
+    auto port_separator = listener.rfind(':');
+    try {
+        if (scheme_end == std::string::npos || port_separator <= scheme_end + 2) {
+            throw std::invalid_argument("missing port");
+        }
+        port = static_cast<INT32>(std::stoul(listener.substr(port_separator + 1)));
+    } catch (...) {
+        throw_runtime_error(std::format("invalid value for advertised.listeners: {}", iter->second).c_str());
+    }
+    if (port_separator > scheme_end + 3) {
+        host = listener.substr(scheme_end + 3, port_separator - scheme_end - 3);
+    }
+}
+
+// Reads the default client quota and the per-user and per-client-ID quotas, such as
+// `client.quota.request.percentage.user.alice`.
+static void read_client_quotas(const Properties &properties, ClientQuota &default_quota,
+                               std::map<std::string, ClientQuota, std::less<>> &overrides) {
+    const std::pair<const char *, std::size_t ClientQuota::*> limits[] = {
+        {"client.quota.byte.rate", &ClientQuota::byte_rate},
+        {"client.quota.request.percentage", &ClientQuota::request_percentage},
+    };
+    for (auto [key, limit] : limits) {
+        read_size(properties, key, default_quota.*limit);
+    }
+    for (auto [key, limit] : limits) {
+        for (const char *entity_type : {"user", "client-id"}) {
+            std::string prefix = std::format("{}.{}.", key, entity_type);
+            for (auto iter = properties.lower_bound(prefix);
+                 iter != properties.end() && iter->first.starts_with(prefix); ++iter) {
+                std::string entity = std::format("{}:{}", entity_type, iter->first.substr(prefix.size()));
+                auto [quota, inserted] = overrides.try_emplace(entity, default_quota);
+                read_size(properties, iter->first.c_str(), quota->second.*limit);
+            }
+        }
+    }
+}
+
+ServerConfig ServerConfig::from_properties(const Properties &properties) {
+    ServerConfig config;
+    std::size_t node_id = config.node_id;
+    read_size(properties, "node.id", node_id);
+    config.node_id = static_cast<INT32>(node_id);
+    read_advertised_listener(properties, config.advertised_host, config.advertised_port);
+    read_size(properties, "num.network.threads", config.num_network_threads);
+    read_size(properties, "num.io.threads", config.num_io_threads);
+    read_size(properties, "queued.max.requests", config.queued_max_requests);
+    read_size(properties, "queued.max.request.bytes", config.queued_max_request_bytes);
+    read_size(properties, "socket.request.max.bytes", config.socket_request_max_bytes);
+    read_size(properties, "output.queue.high.water.bytes", config.output_queue_high_water_bytes);
+    read_client_quotas(properties, config.client_quota_default, config.client_quota_overrides);
+    read_size(properties, "quota.window.num", config.quota_window_num);
+    read_size(properties, "quota.window.size.seconds", config.quota_window_size_seconds);
+    std::size_t metrics_port = config.metrics_port;
+    read_size(properties, "metrics.port", metrics_port);
+    if (metrics_port > 65535) {
+        throw_runtime_error(std::format("invalid value for metrics.port: {}", metrics_port).c_str());
+    }
+    config.metrics_port = static_cast<INT32>(metrics_port);
+    read_size(properties, "request.trace.buffer.size", config.request_trace_buffer_size);
+    read_size(properties, "slow.request.threshold.ms", config.slow_request_threshold_ms);
+    if (auto iter = properties.find("request.capture.file"); iter != properties.end()) {
+        config.request_capture_file = iter->second;
+    }
+    read_size(properties, "request.capture.max.bytes", config.request_capture_max_bytes);
+    read_bool(properties, "perf.counters.enable", config.perf_counters_enable);
+    read_cpu_list(properties, "cpu.affinity.acceptor", config.cpu_affinity_acceptor);
+    read_cpu_list(properties, "cpu.affinity.network", config.cpu_affinity_network);
+    read_cpu_list(properties, "cpu.affinity.handler", config.cpu_affinity_handler);
+    read_size(properties, "num.recovery.threads.per.data.dir", config.num_recovery_threads);
+    read_bool(properties, "log.recovery.truncate.enable", config.log_recovery_truncate_enable);
+    read_size(properties, "max.request.partition.size.limit", config.max_request_partition_size_limit);
+    read_size(properties, "fetch.wait.recheck.ms", config.fetch_wait_recheck_ms);
+    read_size(properties, "log.cold.read.drop.bytes", config.log_cold_read_drop_bytes);
+    if (config.num_network_threads == 0 || config.num_io_threads == 0 || config.queued_max_requests == 0 ||
+        config.num_recovery_threads == 0 || config.max_request_partition_size_limit == 0 ||
+        config.queued_max_request_bytes == 0 || config.socket_request_max_bytes == 0 ||
+        config.output_queue_high_water_bytes == 0 || config.quota_window_num == 0 ||
+        config.quota_window_size_seconds == 0 || config.fetch_wait_recheck_ms == 0) {
+        throw_runtime_error("thread counts, queue sizes and limits must be positive");
+    }
+    return config;
+}
+
+}
@@ -1,5 +1,10 @@
+#include "kafka/config/server_config.hpp"
 #include "kafka/network/server.hpp"
 
 int main(int argc, char *argv[]) {
-    kafka::Server().start();
+    kafka::ServerConfig config;
+    if (argc > 1) {
+        config = kafka::ServerConfig::load(argv[1]);
+    }
+    kafka::Server(config).start();
 }
@@ -1,78 +1,439 @@
 #include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/config/server_config.hpp"
+#include "kafka/metadata/log_tailer.hpp"
+#include "kafka/metadata/snapshot_file.hpp"
 #include "kafka/protocol/file_descriptor.hpp"
 #include "kafka/protocol/ireadable.hpp"
 #include "kafka/protocol/readable_buffer.hpp"
 #include "kafka/protocol/types.hpp"
+#include "kafka/storage/record_batch_format.hpp"
+#include "kafka/storage/segment_reader.hpp"
 #include "kafka/utils.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <numeric>
+#include <poll.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <tuple>
+#include <unistd.h>
+#include <utility>
 
 namespace kafka {
 
-std::vector<RecordBatch> read_record_batches(const std::string &topic_name, INT32 partition_index) {
-    auto log_file_path = std::format(
-        "/tmp/kraft-combined-logs/{}-{}/00000000000000000000.log", topic_name, partition_index);
-    FileDescriptor log_fd(log_file_path.c_str(), O_RDONLY);
+std::string partition_log_dir(std::string_view topic_name, INT32 partition_index) {
+    return std::format("{}/{}-{}", default_log_dir, topic_name, partition_index);
+}
+
+std::expected<std::vector<RecordBatch>, ErrorCode> read_record_batches(std::string_view topic_name,
+                                                                       INT32 partition_index) {
+    return read_record_batches(partition_log_dir(topic_name, partition_index));
+}
 
+std::expected<std::vector<RecordBatch>, ErrorCode> read_record_batches(const std::string &partition_dir) {
+    auto log_file_path = partition_dir + "/00000000000000000000.log";
+    auto log_fd = FileDescriptor::try_open(log_file_path.c_str(), O_RDONLY);
+    if (!log_fd) {
+        return std::unexpected(log_fd.error() == std::errc::no_such_file_or_directory
+                                   ? ErrorCode::UNKNOWN_TOPIC_OR_PARTITION : ErrorCode::KAFKA_STORAGE_ERROR);
+    }
+
+    // The log is read whole and split at the batch lengths, so that the end of the log and a
+    // batch cut short by a concurrent append are found without a failed read.
+    struct stat st;
+    if (fstat(log_fd->get(), &st) < 0) {
+        return std::unexpected(ErrorCode::KAFKA_STORAGE_ERROR);
+    }
+    // The segment is no longer active once a later one exists.
+    auto inactive = [&] {
+        auto segments = list_segments(partition_dir);
+        return !segments.empty() && segments.back() > 0;
+    };
+    BYTES log;
+    try {
+        log = SegmentReader::get_instance().read(log_fd->get(), static_cast<std::size_t>(st.st_size), inactive);
+    } catch (const std::system_error &) {
+        return std::unexpected(ErrorCode::KAFKA_STORAGE_ERROR);
+    }
+    std::size_t size = log.size();
+
+    // Batches are checked before they are decoded. The log is corrupt from the first batch that
+    // fails, so the batches before it are returned.
+    ReadableBuffer rb(std::move(log));
     std::vector<RecordBatch> record_batches;
-    for ( ; ; ) {
-        RecordBatch record_batch;
+    for (std::size_t offset = 0; size - offset >= batch_header_size; ) {
+        const unsigned char *batch = rb.buffer().data() + offset;
+        INT32 batch_length;
+        std::memcpy(&batch_length, batch + sizeof(INT64), sizeof(batch_length));
+        batch_length = to_host_byte_order(batch_length);
+        if (batch_length < 0 || static_cast<std::size_t>(batch_length) > size - offset - batch_header_size ||
+            !record_batch_valid(batch, batch_header_size + batch_length)) {
+            break;
+        }
+        offset += batch_header_size + batch_length;
         try {
-            record_batch.read(log_fd);
-        } catch (...) {
-            return record_batches;
+            record_batches.emplace_back().read(rb);
+        } catch (const std::exception &) {
+            // Records that this decoder does not support, such as ones with keys.
+            record_batches.pop_back();
+            break;
+        }
+        if (rb.position() != offset) {
+            // The records do not add up to the batch length.
+            record_batches.pop_back();
+            break;
         }
-        record_batches.push_back(std::move(record_batch));
     }
+    return record_batches;
 }
 
-UUID ClusterMetadata::get_topic_id(const std::string &topic_name) const {
-    std::lock_guard<std::mutex> guard(mutex_);
-    auto iter = topic_ids_.find(topic_name);
-    if (iter == topic_ids_.end()) {
-        throw_runtime_error("unknown topic name");
+const MetadataSnapshot::Topic *MetadataSnapshot::find_topic(std::string_view topic_name) const {
+    auto position = topics_by_name_.find(std::hash<std::string_view>()(topic_name), [&](std::uint32_t i) {
+        return this->topic_name(topics_[i]) == topic_name;
+    });
+    return position ? &topics_[*position] : nullptr;
+}
+
+const MetadataSnapshot::Topic *MetadataSnapshot::find_topic(const UUID &topic_id) const {
+    auto position = topics_by_id_.find(UUIDHash()(topic_id), [&](std::uint32_t i) {
+        return topics_[i].topic_id == topic_id;
+    });
+    return position ? &topics_[*position] : nullptr;
+}
+
+void MetadataSnapshot::add_topic(std::string_view topic_name, const UUID &topic_id) {
+    if (find_topic(topic_name) || find_topic(topic_id)) {
+        return;
+    }
+    auto position = static_cast<std::uint32_t>(topics_.size());
+    topics_.push_back(Topic{topic_id, static_cast<std::uint32_t>(names_.size()),
+                            static_cast<std::uint32_t>(topic_name.size()), 0, 0});
+    names_.append(topic_name);
+    topics_by_name_.insert(std::hash<std::string_view>()(topic_name), position);
+    topics_by_id_.insert(UUIDHash()(topic_id), position);
+    sealed_ = false;
+}
+
+void MetadataSnapshot::rebuild_indexes() {
+    topics_by_name_ = FlatHashIndex();
+    topics_by_id_ = FlatHashIndex();
+    topics_by_name_.reserve(topics_.size());
+    topics_by_id_.reserve(topics_.size());
+    for (std::size_t i = 0; i < topics_.size(); i++) {
+        auto position = static_cast<std::uint32_t>(i);
+        topics_by_name_.insert(std::hash<std::string_view>()(topic_name(topics_[i])), position);
+        topics_by_id_.insert(UUIDHash()(topics_[i].topic_id), position);
     }
-    return iter->second;
+    topic_name_order_.clear();
+    sort_new_topic_names();
 }
 
-std::string ClusterMetadata::get_topic_name(const UUID &topic_id) const {
-    std::lock_guard<std::mutex> guard(mutex_);
-    auto iter = topic_names_.find(topic_id);
-    if (iter == topic_names_.end()) {
-        throw_runtime_error("unknown topic id");
+void MetadataSnapshot::sort_new_topic_names() {
+    auto by_name = [&](std::uint32_t i, std::uint32_t j) {
+        return topic_name(topics_[i]) < topic_name(topics_[j]);
+    };
+    std::size_t sorted_count = topic_name_order_.size();
+    for (std::size_t i = sorted_count; i < topics_.size(); i++) {
+        topic_name_order_.push_back(static_cast<std::uint32_t>(i));
     }
-    return iter->second;
+    auto middle = topic_name_order_.begin() + sorted_count;
+    std::sort(middle, topic_name_order_.end(), by_name);
+    std::inplace_merge(topic_name_order_.begin(), middle, topic_name_order_.end(), by_name);
 }
 
-std::vector<INT32> ClusterMetadata::get_partition_ids(const UUID &topic_id) const {
-    std::lock_guard<std::mutex> guard(mutex_);
-    auto iter = partition_ids_.find(topic_id);
-    if (iter == partition_ids_.end()) {
-        throw_runtime_error("unknown topic id");
+void MetadataSnapshot::add_partition(const UUID &topic_id, INT32 partition_id) {
+    const Topic *topic = find_topic(topic_id);
+    if (!topic) {
+        return;
     }
-    return iter->second;
+    partition_topics_.push_back(static_cast<std::uint32_t>(topic - topics_.data()));
+    partition_ids_.push_back(partition_id);
+    sealed_ = false;
 }
 
-ClusterMetadata::ClusterMetadata() {
-    for (const auto &record_batch : read_record_batches("__cluster_metadata", 0)) {
-        for (const auto &record : record_batch.records()) {
-            ReadableBuffer rb(record.value());
-            INT8 frame_version = read_int8(rb);
-            INT8 type = read_int8(rb);
-            INT8 version = read_int8(rb);
+void MetadataSnapshot::seal() {
+    if (sealed_) {
+        return;
+    }
+
+    auto less = [&](std::size_t i, std::size_t j) {
+        return std::tie(partition_topics_[i], partition_ids_[i]) < std::tie(partition_topics_[j], partition_ids_[j]);
+    };
+    std::vector<std::size_t> order(partition_ids_.size());
+    std::iota(order.begin(), order.end(), 0);
+    // Partitions usually arrive right after their topic, so this is often already sorted.
+    if (!std::is_sorted(order.begin(), order.end(), less)) {
+        std::sort(order.begin(), order.end(), less);
+    }
 
-            if (type == 2) {
-                COMPACT_STRING topic_name = read_compact_string(rb);
-                UUID topic_id = read_uuid(rb);
-                topic_ids_[topic_name] = topic_id;
-                topic_names_[topic_id] = topic_name;
-            } else if (type == 3) {
-                INT32 partition_id = read_int32(rb);
-                UUID topic_id = read_uuid(rb);
-                partition_ids_[topic_id].push_back(partition_id);
+    std::vector<std::uint32_t> partition_topics;
+    std::vector<INT32> partition_ids;
+    partition_topics.reserve(order.size());
+    partition_ids.reserve(order.size());
+    for (std::size_t i : order) {
+        if (!partition_ids.empty() && partition_topics.back() == partition_topics_[i] &&
+            partition_ids.back() == partition_ids_[i]) {
+            continue;
+        }
+        partition_topics.push_back(partition_topics_[i]);
+        partition_ids.push_back(partition_ids_[i]);
+    }
+    partition_topics_ = std::move(partition_topics);
+    partition_ids_ = std::move(partition_ids);
+
+    // New topics are sorted on their own and merged in, so a small update stays linear.
+    sort_new_topic_names();
+
+    for (Topic &topic : topics_) {
+        topic.first_partition = 0;
+        topic.partition_count = 0;
+    }
+    for (std::size_t i = partition_topics_.size(); i-- > 0; ) {
+        Topic &topic = topics_[partition_topics_[i]];
+        topic.first_partition = static_cast<std::uint32_t>(i);
+        topic.partition_count++;
+    }
+    sealed_ = true;
+    account_memory();
+}
+
+void MetadataSnapshot::account_memory() {
+    memory_.resize(topics_.capacity() * sizeof(Topic) + names_.capacity() + topics_by_name_.memory_bytes() +
+                   topics_by_id_.memory_bytes() + topic_name_order_.capacity() * sizeof(std::uint32_t) +
+                   partition_topics_.capacity() * sizeof(std::uint32_t) + partition_ids_.capacity() * sizeof(INT32));
+}
+
+// Frame version of the metadata records read, and the newest TopicRecord and PartitionRecord
+// versions. Every version up to these starts with the fields read below.
+static constexpr INT8 metadata_record_frame_version = 1;
+static constexpr INT8 topic_record_max_version = 0;
+static constexpr INT8 partition_record_max_version = 2;
+
+void MetadataSnapshot::apply(const Record &record) {
+    ReadableBuffer rb(record.value());
+    INT8 frame_version = read_int8(rb);
+    INT8 type = read_int8(rb);
+    INT8 version = read_int8(rb);
+    if (frame_version != metadata_record_frame_version || version < 0) {
+        return;
+    }
+
+    if (type == 2 && version <= topic_record_max_version) {
+        COMPACT_STRING topic_name = read_compact_string(rb);
+        UUID topic_id = read_uuid(rb);
+        add_topic(topic_name, topic_id);
+    } else if (type == 3 && version <= partition_record_max_version) {
+        INT32 partition_id = read_int32(rb);
+        UUID topic_id = read_uuid(rb);
+        add_partition(topic_id, partition_id);
+    }
+}
+
+static FileDescriptor make_event_fd() {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        throw_system_error("eventfd");
+    }
+    return FileDescriptor(fd);
+}
+
+static INT64 now_ms() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+// Reads the cluster ID that `kafka-storage format` stored in a log directory.
+static std::string read_cluster_id(const std::string &log_dir) {
+    std::string path = log_dir + "/meta.properties";
+    if (access(path.c_str(), R_OK) != 0) {
+        return "";
+    }
+    Properties properties = read_properties(path);
+    auto iter = properties.find("cluster.id");
+    return iter == properties.end() ? "" : iter->second;
+}
+
+ClusterMetadata::ClusterMetadata()
+    : cluster_id_(read_cluster_id(default_log_dir)), snapshot_(std::make_shared<const MetadataSnapshot>()), version_(0),
+      tailer_(std::make_unique<LogTailer>(partition_log_dir("__cluster_metadata", 0))),
+      rate_window_start_(std::chrono::steady_clock::now()), rate_window_records_(0),
+      snapshot_path_(metadata_snapshot_path(tailer_->log_dir())), last_snapshot_time_(rate_window_start_),
+      records_since_snapshot_(0), next_offset_(0), records_applied_(0), records_skipped_(0), records_per_second_(0),
+      last_record_timestamp_ms_(-1), stop_fd_(make_event_fd()) {
+    // Start from the snapshot file if it matches the log, and replay only the records after it.
+    // Otherwise the log was rewritten or truncated since, and is replayed from the start.
+    auto initial = std::make_shared<MetadataSnapshot>();
+    MetadataLogPosition position;
+    if (MetadataSnapshotFile::read(snapshot_path_, *initial, position) &&
+        tailer_->resume(position.segment_base_offset, position.segment_position, position.next_offset,
+                        position.last_batch)) {
+        next_offset_.store(position.next_offset);
+    } else {
+        *initial = MetadataSnapshot();
+    }
+    initial->version_ = 1;
+    initial->account_memory();
+    snapshot_.store(std::move(initial));
+    version_.store(1, std::memory_order_release);
+
+    // Catch up before serving anything, then follow the log in the background.
+    catch_up();
+    tail_thread_ = std::thread(&ClusterMetadata::tail, this);
+}
+
+ClusterMetadata::~ClusterMetadata() {
+    std::uint64_t one = 1;
+    stop_fd_.write(&one, sizeof(one));
+    tail_thread_.join();
+}
+
+std::shared_ptr<const MetadataSnapshot> ClusterMetadata::snapshot() const {
+    struct Cache {
+        const ClusterMetadata *owner = nullptr;
+        std::uint64_t version = 0;
+        std::shared_ptr<const MetadataSnapshot> snapshot;
+    };
+    thread_local Cache cache;
+    if (cache.owner != this || cache.version != version_.load(std::memory_order_acquire)) {
+        // The cached pointer shares ownership through a control block of this thread, which
+        // holds the only reference from this thread to the snapshot's own.
+        auto holder = std::make_shared<std::shared_ptr<const MetadataSnapshot>>(snapshot_.load());
+        cache.owner = this;
+        cache.version = (*holder)->version();
+        cache.snapshot = std::shared_ptr<const MetadataSnapshot>(holder, holder->get());
+    }
+    return cache.snapshot;
+}
+
+MetadataApplyStats ClusterMetadata::apply_stats() const {
+    INT64 last_record_timestamp_ms = last_record_timestamp_ms_.load(std::memory_order_relaxed);
+    return MetadataApplyStats{
+        next_offset_.load(std::memory_order_relaxed),
+        records_applied_.load(std::memory_order_relaxed),
+        records_skipped_.load(std::memory_order_relaxed),
+        records_per_second_.load(std::memory_order_relaxed),
+        last_record_timestamp_ms < 0 ? 0 : std::max<INT64>(0, now_ms() - last_record_timestamp_ms),
+    };
+}
+
+void ClusterMetadata::catch_up() {
+    // The tailer moves past each batch as it reads it, so the batches read before an error are
+    // still applied, and a record that can't be decoded is skipped and counted rather than
+    // failing, and losing, the whole read.
+    std::vector<RecordBatch> record_batches;
+    std::exception_ptr read_error;
+    try {
+        tailer_->read_new_batches(record_batches);
+    } catch (const std::exception &) {
+        read_error = std::current_exception();
+    }
+
+    std::uint64_t records = 0;
+    std::uint64_t skipped = 0;
+    if (!record_batches.empty()) {
+        update([&](MetadataSnapshot &snapshot) {
+            for (const auto &record_batch : record_batches) {
+                for (const auto &record : record_batch.records()) {
+                    try {
+                        snapshot.apply(record);
+                        records++;
+                    } catch (const std::exception &) {
+                        skipped++;
+                    }
+                }
+            }
+        });
+        next_offset_.store(tailer_->next_offset(), std::memory_order_relaxed);
+        records_applied_.fetch_add(records, std::memory_order_relaxed);
+        records_skipped_.fetch_add(skipped, std::memory_order_relaxed);
+        last_record_timestamp_ms_.store(record_batches.back().max_timestamp(), std::memory_order_relaxed);
+    }
+
+    records_since_snapshot_ += records;
+    rate_window_records_ += records;
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = now - rate_window_start_;
+    if (elapsed >= std::chrono::seconds(1)) {
+        records_per_second_.store(rate_window_records_ / elapsed.count(), std::memory_order_relaxed);
+        rate_window_start_ = now;
+        rate_window_records_ = 0;
+    }
+    if (read_error) {
+        std::rethrow_exception(read_error);
+    }
+}
+
+void ClusterMetadata::tail() {
+    // Wake up on inotify events for the log directory, and every poll interval regardless, in
+    // case the directory doesn't exist yet or the events were missed.
+    static constexpr int poll_interval_ms = 500;
+    FileDescriptor inotify_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC));
+    bool watching = false;
+
+    for ( ; ; ) {
+        if (!watching && inotify_fd.get() >= 0) {
+            watching = inotify_add_watch(inotify_fd.get(), tailer_->log_dir().c_str(),
+                                         IN_MODIFY | IN_CREATE | IN_MOVED_TO) >= 0;
+        }
+
+        pollfd fds[2] = {{stop_fd_.get(), POLLIN, 0}, {inotify_fd.get(), POLLIN, 0}};
+        if (poll(fds, watching ? 2 : 1, poll_interval_ms) < 0 && errno != EINTR) {
+            throw_system_error("poll");
+        }
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+        if (watching && (fds[1].revents & POLLIN)) {
+            alignas(inotify_event) char events[4096];
+            while (::read(inotify_fd.get(), events, sizeof(events)) > 0) {
             }
         }
+
+        try {
+            catch_up();
+            maybe_write_snapshot();
+        } catch (const std::exception &) {
+            // The log may be mid-rotation; the next wakeup reads on from the tailer's position.
+        }
+    }
+}
+
+void ClusterMetadata::maybe_write_snapshot() {
+    static constexpr std::uint64_t snapshot_min_records = 10000;
+    static constexpr auto snapshot_interval = std::chrono::minutes(1);
+
+    auto now = std::chrono::steady_clock::now();
+    if (records_since_snapshot_ == 0 ||
+        (records_since_snapshot_ < snapshot_min_records && now - last_snapshot_time_ < snapshot_interval)) {
+        return;
     }
+    MetadataLogPosition position{tailer_->segment_base_offset(), tailer_->position(), tailer_->next_offset(),
+                                 tailer_->last_batch()};
+    MetadataSnapshotFile::write(snapshot_path_, *snapshot(), position);
+    last_snapshot_time_ = now;
+    records_since_snapshot_ = 0;
+}
+
+void ClusterMetadata::update(const std::function<void(MetadataSnapshot &)> &update) {
+    std::lock_guard<std::mutex> guard(update_mutex_);
+    auto current = snapshot_.load(std::memory_order_acquire);
+    auto next = std::make_shared<MetadataSnapshot>(*current);
+    update(*next);
+    next->seal();
+    next->version_ = current->version_ + 1;
+    std::uint64_t version = next->version_;
+    snapshot_.store(std::move(next), std::memory_order_release);
+    version_.store(version, std::memory_order_release);
 }
 
 }
@@ -0,0 +1,186 @@
+#include "kafka/metadata/log_tailer.hpp"
+#include "kafka/protocol/readable_buffer.hpp"
+#include "kafka/storage/record_batch_format.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <exception>
+#include <format>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace kafka {
+
+// Size of the batch fields that precede the rest of the batch: base offset and batch length.
+static constexpr off_t batch_overhead = batch_header_size;
+
+template<typename IntType>
+static IntType load_big_endian(const unsigned char *p) {
+    IntType n;
+    std::memcpy(&n, p, sizeof(n));
+    return to_host_byte_order(n);
+}
+
+static bool pread_fully(int fd, void *dst, std::size_t nbytes, off_t offset) {
+    char *p = static_cast<char *>(dst);
+    while (nbytes > 0) {
+        ssize_t nr = pread(fd, p, nbytes, offset);
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_system_error("pread");
+        } else if (nr == 0) {
+            return false;
+        }
+        p += nr;
+        nbytes -= nr;
+        offset += nr;
+    }
+    return true;
+}
+
+std::vector<INT64> list_segments(const std::string &log_dir) {
+    std::vector<INT64> base_offsets;
+    DIR *dir = opendir(log_dir.c_str());
+    if (!dir) {
+        return base_offsets;
+    }
+    while (dirent *entry = readdir(dir)) {
+        std::string_view name(entry->d_name);
+        if (name.size() != 24 || !name.ends_with(".log")) {
+            continue;
+        }
+        auto digits = name.substr(0, 20);
+        if (std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            base_offsets.push_back(std::stoll(std::string(digits)));
+        }
+    }
+    closedir(dir);
+    std::sort(base_offsets.begin(), base_offsets.end());
+    return base_offsets;
+}
+
+std::string segment_path(const std::string &log_dir, INT64 base_offset) {
+    return std::format("{}/{:020}.log", log_dir, base_offset);
+}
+
+void LogTailer::read_new_batches(std::vector<RecordBatch> &batches) {
+    if (!segment_fd_ && !open_next_segment()) {
+        return;
+    }
+
+    for ( ; ; ) {
+        // Check for a newer segment first: once one exists, nothing more is appended to this one.
+        auto segments = list_segments(log_dir_);
+        bool rolled = !segments.empty() && segments.back() > segment_base_offset_;
+
+        struct stat st;
+        if (fstat(segment_fd_->get(), &st) < 0) {
+            throw_system_error("fstat");
+        }
+        while (position_ + batch_overhead <= st.st_size) {
+            unsigned char header[batch_overhead];
+            if (!pread_fully(segment_fd_->get(), header, sizeof(header), position_)) {
+                break;
+            }
+            INT32 batch_length;
+            std::memcpy(&batch_length, header + sizeof(INT64), sizeof(batch_length));
+            batch_length = to_host_byte_order(batch_length);
+            off_t batch_size = batch_overhead + batch_length;
+            if (batch_length <= 0 || position_ + batch_size > st.st_size) {
+                break;
+            }
+
+            BYTES bytes(batch_size);
+            if (!pread_fully(segment_fd_->get(), bytes.data(), bytes.size(), position_)) {
+                break;
+            }
+            last_batch_ = LogBatchMark{segment_base_offset_, position_, load_big_endian<INT64>(bytes.data()),
+                                       batch_size > static_cast<off_t>(attributes_position)
+                                           ? load_big_endian<UINT32>(bytes.data() + crc_position) : 0};
+            position_ += batch_size;
+
+            ReadableBuffer rb(std::move(bytes));
+            RecordBatch record_batch;
+            try {
+                record_batch.read(rb);
+            } catch (const std::exception &) {
+                // The batch is complete but can't be decoded; skip it rather than stall the tail.
+                continue;
+            }
+            next_offset_ = record_batch.base_offset() + record_batch.last_offset_delta() + 1;
+            batches.push_back(std::move(record_batch));
+        }
+
+        if (!rolled || !open_next_segment()) {
+            return;
+        }
+    }
+}
+
+bool LogTailer::resume(INT64 segment_base_offset, off_t position, INT64 next_offset, const LogBatchMark &last_batch) {
+    auto segments = list_segments(log_dir_);
+    if (!std::binary_search(segments.begin(), segments.end(), segment_base_offset)) {
+        return false;
+    }
+    FileDescriptor segment_fd(segment_path(log_dir_, segment_base_offset).c_str(), O_RDONLY);
+    struct stat st;
+    if (fstat(segment_fd.get(), &st) < 0) {
+        throw_system_error("fstat");
+    }
+    if (position < 0 || position > st.st_size) {
+        return false;
+    }
+
+    // A log rewritten in place may still be long enough; check that the last batch read is
+    // still where it was, and that it still ends at the position.
+    if (last_batch.segment_base_offset >= 0) {
+        if (!std::binary_search(segments.begin(), segments.end(), last_batch.segment_base_offset)) {
+            return false;
+        }
+        std::optional<FileDescriptor> other_fd;
+        if (last_batch.segment_base_offset != segment_base_offset) {
+            other_fd.emplace(segment_path(log_dir_, last_batch.segment_base_offset).c_str(), O_RDONLY);
+        }
+        int fd = other_fd ? other_fd->get() : segment_fd.get();
+        unsigned char header[attributes_position];
+        if (last_batch.position < 0 || !pread_fully(fd, header, sizeof(header), last_batch.position)) {
+            return false;
+        }
+        off_t batch_end = last_batch.position + batch_overhead + load_big_endian<INT32>(header + sizeof(INT64));
+        if (load_big_endian<INT64>(header) != last_batch.base_offset ||
+            load_big_endian<UINT32>(header + crc_position) != last_batch.crc ||
+            (last_batch.segment_base_offset == segment_base_offset && batch_end != position)) {
+            return false;
+        }
+    } else if (position != 0) {
+        return false;
+    }
+
+    segment_fd_.emplace(std::move(segment_fd));
+    segment_base_offset_ = segment_base_offset;
+    position_ = position;
+    next_offset_ = next_offset;
+    last_batch_ = last_batch;
+    return true;
+}
+
+bool LogTailer::open_next_segment() {
+    for (INT64 base_offset : list_segments(log_dir_)) {
+        if (base_offset > segment_base_offset_) {
+            segment_fd_.emplace(segment_path(log_dir_, base_offset).c_str(), O_RDONLY);
+            segment_base_offset_ = base_offset;
+            position_ = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
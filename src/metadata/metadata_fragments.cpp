@@ -0,0 +1,58 @@
+#include "kafka/metadata/metadata_fragments.hpp"
+#include "kafka/message/metadata.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+
+#include <atomic>
+
+namespace kafka {
+
+std::shared_ptr<const MetadataTopicFragments> MetadataTopicFragments::get(
+        std::shared_ptr<const MetadataSnapshot> snapshot, INT32 leader_id) {
+    static std::atomic<std::shared_ptr<const MetadataTopicFragments>> current;
+    static std::mutex mutex;
+
+    auto fragments = current.load(std::memory_order_acquire);
+    if (fragments && fragments->snapshot_->version() == snapshot->version() && fragments->leader_id_ == leader_id) {
+        return fragments;
+    }
+    // Only one thread replaces the cache, so a new version is not prepared twice.
+    std::lock_guard<std::mutex> lock(mutex);
+    fragments = current.load(std::memory_order_acquire);
+    if (!fragments || fragments->snapshot_->version() != snapshot->version() || fragments->leader_id_ != leader_id) {
+        fragments = std::make_shared<const MetadataTopicFragments>(std::move(snapshot), leader_id);
+        current.store(fragments, std::memory_order_release);
+    }
+    return fragments;
+}
+
+const MetadataTopicFragments::Encoding &MetadataTopicFragments::encoding(INT16 version) const {
+    Encoding &encoding = encodings_[version >= 10];
+    std::call_once(encoding.once, [&] {
+        WritableBuffer wb;
+        auto topics = snapshot_->topics();
+        encoding.offsets.reserve(topics.size() + 1);
+        for (const auto &topic : topics) {
+            encoding.offsets.push_back(wb.buffer().size());
+            MetadataResponse::write_topic(wb, version, ErrorCode::NONE, snapshot_->topic_name(topic), topic.topic_id,
+                                          snapshot_->partition_ids(topic), leader_id_);
+        }
+        encoding.offsets.push_back(wb.buffer().size());
+        encoding.bytes = wb.release();
+        encoding.bytes.shrink_to_fit();
+    });
+    return encoding;
+}
+
+std::span<const unsigned char> MetadataTopicFragments::topic(const MetadataSnapshot::Topic &topic,
+                                                             INT16 version) const {
+    const Encoding &encoding = this->encoding(version);
+    std::size_t index = &topic - snapshot_->topics().data();
+    return std::span<const unsigned char>(encoding.bytes)
+        .subspan(encoding.offsets[index], encoding.offsets[index + 1] - encoding.offsets[index]);
+}
+
+std::span<const unsigned char> MetadataTopicFragments::all_topics(INT16 version) const {
+    return this->encoding(version).bytes;
+}
+
+}
@@ -0,0 +1,198 @@
+#include "kafka/metadata/snapshot_file.hpp"
+#include "kafka/protocol/crc32c.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/utils.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace kafka {
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'K', 'M', 'D', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t snapshot_format_version = 3;
+
+// Fixed-size header of a snapshot file. The arrays follow it in this order: topics, partition
+// topics, partition IDs and names. All values use host byte order; the file is a local cache.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t format_version;
+    // CRC-32C of everything after the header.
+    std::uint32_t body_crc;
+    INT64 segment_base_offset;
+    INT64 segment_position;
+    INT64 next_offset;
+    INT64 last_batch_segment_base_offset;
+    INT64 last_batch_position;
+    INT64 last_batch_base_offset;
+    std::uint32_t last_batch_crc;
+    std::uint32_t reserved2;
+    std::uint64_t topic_count;
+    std::uint64_t partition_count;
+    std::uint64_t names_size;
+};
+
+using Topic = MetadataSnapshot::Topic;
+
+static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+static_assert(std::is_trivially_copyable_v<Topic>);
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    explicit MappedFile(int fd, std::size_t size) : size_(size) {
+        data_ = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data_ == MAP_FAILED) {
+            throw_system_error("mmap");
+        }
+    }
+
+    ~MappedFile() {
+        munmap(data_, size_);
+    }
+
+    const unsigned char *data() const {
+        return static_cast<const unsigned char *>(data_);
+    }
+
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+private:
+    void *data_;
+    std::size_t size_;
+};
+
+}
+
+std::string metadata_snapshot_path(const std::string &log_dir) {
+    return log_dir + "/metadata.snapshot";
+}
+
+void MetadataSnapshotFile::write(const std::string &path, const MetadataSnapshot &snapshot,
+                                 const MetadataLogPosition &position) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.format_version = snapshot_format_version;
+    header.segment_base_offset = position.segment_base_offset;
+    header.segment_position = position.segment_position;
+    header.next_offset = position.next_offset;
+    header.last_batch_segment_base_offset = position.last_batch.segment_base_offset;
+    header.last_batch_position = position.last_batch.position;
+    header.last_batch_base_offset = position.last_batch.base_offset;
+    header.last_batch_crc = position.last_batch.crc;
+    header.topic_count = snapshot.topics_.size();
+    header.partition_count = snapshot.partition_ids_.size();
+    header.names_size = snapshot.names_.size();
+    header.body_crc = crc32c(header.body_crc, snapshot.topics_.data(), snapshot.topics_.size() * sizeof(Topic));
+    header.body_crc = crc32c(header.body_crc, snapshot.partition_topics_.data(),
+                             snapshot.partition_topics_.size() * sizeof(std::uint32_t));
+    header.body_crc =
+        crc32c(header.body_crc, snapshot.partition_ids_.data(), snapshot.partition_ids_.size() * sizeof(INT32));
+    header.body_crc = crc32c(header.body_crc, snapshot.names_.data(), snapshot.names_.size());
+
+    // Write a temporary file and rename it over the old one, so readers never see a torn file.
+    std::string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw_system_error(temporary_path.c_str());
+    }
+    {
+        FileDescriptor file(fd);
+        file.write(&header, sizeof(header));
+        file.write(snapshot.topics_.data(), snapshot.topics_.size() * sizeof(Topic));
+        file.write(snapshot.partition_topics_.data(), snapshot.partition_topics_.size() * sizeof(std::uint32_t));
+        file.write(snapshot.partition_ids_.data(), snapshot.partition_ids_.size() * sizeof(INT32));
+        file.write(snapshot.names_.data(), snapshot.names_.size());
+        if (fsync(file.get()) < 0) {
+            throw_system_error("fsync");
+        }
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) < 0) {
+        throw_system_error("rename");
+    }
+    // The rename itself is only durable once the directory is.
+    std::string directory = path.substr(0, path.rfind('/') + 1);
+    FileDescriptor directory_fd(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fsync(directory_fd.get()) < 0) {
+        throw_system_error("fsync");
+    }
+}
+
+bool MetadataSnapshotFile::read(const std::string &path, MetadataSnapshot &snapshot, MetadataLogPosition &position) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    FileDescriptor file(fd);
+    struct stat st;
+    if (fstat(file.get(), &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    MappedFile mapped(file.get(), st.st_size);
+    SnapshotHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0 ||
+        header.format_version != snapshot_format_version) {
+        return false;
+    }
+    // Bound each count by the body size first, so that the sizes below cannot overflow.
+    std::uint64_t body_size = static_cast<std::uint64_t>(st.st_size) - sizeof(SnapshotHeader);
+    if (header.topic_count > body_size / sizeof(Topic) ||
+        header.partition_count > body_size / (sizeof(std::uint32_t) + sizeof(INT32)) ||
+        header.names_size > body_size) {
+        return false;
+    }
+    std::uint64_t expected_size = header.topic_count * sizeof(Topic) +
+                                  header.partition_count * (sizeof(std::uint32_t) + sizeof(INT32)) +
+                                  header.names_size;
+    if (expected_size != body_size ||
+        crc32c(mapped.data() + sizeof(SnapshotHeader), body_size) != header.body_crc) {
+        return false;
+    }
+
+    MetadataSnapshot loaded;
+    const unsigned char *p = mapped.data() + sizeof(SnapshotHeader);
+    loaded.topics_.resize(header.topic_count);
+    std::memcpy(loaded.topics_.data(), p, header.topic_count * sizeof(Topic));
+    p += header.topic_count * sizeof(Topic);
+    loaded.partition_topics_.resize(header.partition_count);
+    std::memcpy(loaded.partition_topics_.data(), p, header.partition_count * sizeof(std::uint32_t));
+    p += header.partition_count * sizeof(std::uint32_t);
+    loaded.partition_ids_.resize(header.partition_count);
+    std::memcpy(loaded.partition_ids_.data(), p, header.partition_count * sizeof(INT32));
+    p += header.partition_count * sizeof(INT32);
+    loaded.names_.assign(reinterpret_cast<const char *>(p), header.names_size);
+
+    // Reject files whose ranges point outside the arrays they index.
+    for (const Topic &topic : loaded.topics_) {
+        if (std::uint64_t(topic.name_offset) + topic.name_size > header.names_size ||
+            std::uint64_t(topic.first_partition) + topic.partition_count > header.partition_count) {
+            return false;
+        }
+    }
+    for (std::uint32_t topic_index : loaded.partition_topics_) {
+        if (topic_index >= header.topic_count) {
+            return false;
+        }
+    }
+
+    loaded.rebuild_indexes();
+    snapshot = std::move(loaded);
+    position = MetadataLogPosition{
+        header.segment_base_offset, header.segment_position, header.next_offset,
+        LogBatchMark{header.last_batch_segment_base_offset, header.last_batch_position, header.last_batch_base_offset,
+                     header.last_batch_crc},
+    };
+    return true;
+}
+
+}
@@ -0,0 +1,37 @@
+#include "kafka/metrics/latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace kafka {
+
+void LatencyHistogram::add_to(Snapshot &snapshot) const {
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        snapshot.counts[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count += count_.load(std::memory_order_relaxed);
+    snapshot.sum_ns += sum_ns_.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds LatencyHistogram::Snapshot::value_at_quantile(double quantile) const {
+    // The bucket counts and the total are read separately, so go by the counts.
+    std::uint64_t total = 0;
+    for (std::uint64_t bucket : counts) {
+        total += bucket;
+    }
+    if (total == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    auto rank = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * total)),
+                                        1);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds(bucket_lower_bound(i) + bucket_width(i) / 2);
+        }
+    }
+    return std::chrono::nanoseconds(bucket_lower_bound(bucket_count - 1));
+}
+
+}
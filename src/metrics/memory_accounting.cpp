@@ -0,0 +1,149 @@
+#include "kafka/metrics/memory_accounting.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+namespace kafka {
+
+// The shard of a thread, whose pending bytes are folded into the totals when the thread exits.
+struct LocalMemoryShard {
+    MemoryAccounting::Shard *shard = nullptr;
+
+    ~LocalMemoryShard() {
+        if (shard) {
+            for (std::size_t category = 0; category < memory_category_count; category++) {
+                MemoryAccounting::get_instance().flush(*shard, category);
+            }
+        }
+    }
+};
+
+MemoryAccounting &MemoryAccounting::get_instance() {
+    static MemoryAccounting instance;
+    return instance;
+}
+
+MemoryAccounting::Shard &MemoryAccounting::local_shard() {
+    thread_local LocalMemoryShard local;
+    if (!local.shard) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        shards_.push_back(std::make_unique<Shard>());
+        local.shard = shards_.back().get();
+    }
+    return *local.shard;
+}
+
+void MemoryAccounting::add(MemoryCategory category, std::int64_t delta) {
+    Shard &shard = local_shard();
+    auto index = static_cast<std::size_t>(category);
+    std::int64_t pending = shard.pending[index].load(std::memory_order_relaxed) + delta;
+    shard.pending[index].store(pending, std::memory_order_relaxed);
+    if (pending >= flush_bytes || pending <= -flush_bytes) {
+        flush(shard, index);
+    }
+}
+
+void MemoryAccounting::flush(Shard &shard, std::size_t category) {
+    std::int64_t pending = shard.pending[category].exchange(0, std::memory_order_relaxed);
+    std::int64_t total = totals_[category].fetch_add(pending, std::memory_order_relaxed) + pending;
+    std::int64_t peak = peaks_[category].load(std::memory_order_relaxed);
+    while (total > peak && !peaks_[category].compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+}
+
+std::shared_ptr<ConnectionMemory> MemoryAccounting::open_connection(std::string peer) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto connection = std::make_shared<ConnectionMemory>(next_connection_id_++, std::move(peer));
+    // Closed connections are dropped whenever the list has doubled, which keeps it within twice
+    // the open connections.
+    if (connections_.size() >= 64 && std::has_single_bit(connections_.size())) {
+        std::erase_if(connections_, [](const auto &connection) { return connection.expired(); });
+    }
+    connections_.push_back(connection);
+    return connection;
+}
+
+std::array<MemoryAccounting::CategoryStats, memory_category_count> MemoryAccounting::stats() const {
+    std::array<CategoryStats, memory_category_count> stats;
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (std::size_t category = 0; category < memory_category_count; category++) {
+        std::int64_t current = totals_[category].load(std::memory_order_relaxed);
+        for (const auto &shard : shards_) {
+            current += shard->pending[category].load(std::memory_order_relaxed);
+        }
+        stats[category] = {current, std::max(current, peaks_[category].load(std::memory_order_relaxed))};
+    }
+    return stats;
+}
+
+std::vector<std::shared_ptr<const ConnectionMemory>> MemoryAccounting::top_connections(std::size_t count) const {
+    std::vector<std::shared_ptr<const ConnectionMemory>> connections;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto &weak : connections_) {
+            if (auto connection = weak.lock()) {
+                connections.push_back(std::move(connection));
+            }
+        }
+    }
+    auto middle = connections.begin() + static_cast<std::ptrdiff_t>(std::min(count, connections.size()));
+    std::partial_sort(connections.begin(), middle, connections.end(),
+                      [](const auto &a, const auto &b) { return a->current() > b->current(); });
+    connections.erase(middle, connections.end());
+    return connections;
+}
+
+// Returns the resident memory of this process, or 0 if it cannot be read.
+static std::int64_t resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    std::int64_t size = 0;
+    std::int64_t resident = 0;
+    if (!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void MemoryAccounting::write_prometheus(std::string &out) const {
+    auto append = std::back_inserter(out);
+    auto category_stats = stats();
+    std::format_to(append, "# HELP kafka_memory_bytes Memory held per category.\n"
+                           "# TYPE kafka_memory_bytes gauge\n");
+    for (std::size_t category = 0; category < memory_category_count; category++) {
+        std::format_to(append, "kafka_memory_bytes{{category=\"{}\"}} {}\n",
+                       memory_category_name(static_cast<MemoryCategory>(category)), category_stats[category].current);
+    }
+    std::format_to(append, "# HELP kafka_memory_peak_bytes Most memory held at once per category.\n"
+                           "# TYPE kafka_memory_peak_bytes gauge\n");
+    for (std::size_t category = 0; category < memory_category_count; category++) {
+        std::format_to(append, "kafka_memory_peak_bytes{{category=\"{}\"}} {}\n",
+                       memory_category_name(static_cast<MemoryCategory>(category)), category_stats[category].peak);
+    }
+
+    auto connections = top_connections(reported_connections);
+    std::format_to(append, "# HELP kafka_memory_connection_bytes Memory held by the connections holding the most.\n"
+                           "# TYPE kafka_memory_connection_bytes gauge\n");
+    for (const auto &connection : connections) {
+        std::format_to(append, "kafka_memory_connection_bytes{{connection=\"{}\",peer=\"{}\"}} {}\n", connection->id(),
+                       connection->peer(), connection->current());
+    }
+    std::format_to(append, "# HELP kafka_memory_connection_peak_bytes Most memory those connections held at once.\n"
+                           "# TYPE kafka_memory_connection_peak_bytes gauge\n");
+    for (const auto &connection : connections) {
+        std::format_to(append, "kafka_memory_connection_peak_bytes{{connection=\"{}\",peer=\"{}\"}} {}\n",
+                       connection->id(), connection->peer(), connection->peak());
+    }
+
+    // What the categories do not cover, such as thread stacks and allocator overhead, is the
+    // difference to the resident memory.
+    std::format_to(append, "# HELP kafka_process_resident_memory_bytes Resident memory of the process.\n"
+                           "# TYPE kafka_process_resident_memory_bytes gauge\n"
+                           "kafka_process_resident_memory_bytes {}\n",
+                   resident_bytes());
+}
+
+}
@@ -0,0 +1,118 @@
+#include "kafka/metrics/metrics_server.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <netinet/in.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <utility>
+
+namespace kafka {
+
+static FileDescriptor listen_on_loopback(INT32 port) {
+    FileDescriptor fd(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (fd.get() < 0) {
+        throw_system_error("socket");
+    }
+    const int reuse = 1;
+    if (setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+        throw_system_error("setsockopt");
+    }
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = to_network_byte_order(static_cast<in_addr_t>(INADDR_LOOPBACK));
+    addr.sin_port = to_network_byte_order(static_cast<unsigned short>(port));
+    if (bind(fd.get(), reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        throw_system_error("bind metrics port");
+    }
+    if (listen(fd.get(), 16) < 0) {
+        throw_system_error("listen");
+    }
+    return fd;
+}
+
+MetricsServer::MetricsServer(INT32 port, std::vector<Page> pages)
+    : pages_(std::move(pages)), listen_fd_(listen_on_loopback(port)), stopping_(false) {
+    thread_ = std::thread(&MetricsServer::run, this);
+}
+
+MetricsServer::~MetricsServer() {
+    stopping_.store(true);
+    // Wakes up the blocked accept.
+    shutdown(listen_fd_.get(), SHUT_RDWR);
+    thread_.join();
+}
+
+void MetricsServer::run() {
+    while (!stopping_.load()) {
+        int client_socket = accept4(listen_fd_.get(), nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        FileDescriptor client_fd(client_socket);
+        serve(client_fd.get());
+    }
+}
+
+void MetricsServer::serve(int client_socket) {
+    // A client that stalls must not hold up the next scrape for long.
+    timeval timeout{1, 0};
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t nr = recv(client_socket, buffer, sizeof(buffer), 0);
+        if (nr <= 0) {
+            return;
+        }
+        request.append(buffer, nr);
+    }
+
+    // The path of a request line such as "GET /metrics?name=x HTTP/1.1".
+    std::string_view request_line(request);
+    request_line = request_line.substr(0, request_line.find("\r\n"));
+    std::string_view path;
+    if (request_line.starts_with("GET ")) {
+        path = request_line.substr(4);
+        path = path.substr(0, std::min(path.find(' '), path.find('?')));
+    }
+    auto page = std::find_if(pages_.begin(), pages_.end(), [&](const Page &page) { return page.path == path; });
+
+    std::string body;
+    std::string_view status = "200 OK";
+    std::string_view content_type = "text/plain; charset=utf-8";
+    if (page != pages_.end()) {
+        body = page->renderer();
+        content_type = page->content_type;
+    } else {
+        status = "404 Not Found";
+        body = "Not found\n";
+    }
+    std::string response = std::format("HTTP/1.1 {}\r\n"
+                                       "Content-Type: {}\r\n"
+                                       "Content-Length: {}\r\n"
+                                       "Connection: close\r\n"
+                                       "\r\n",
+                                       status, content_type, body.size());
+    response += body;
+    for (std::size_t sent = 0; sent < response.size(); ) {
+        ssize_t nw = send(client_socket, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (nw <= 0) {
+            return;
+        }
+        sent += nw;
+    }
+}
+
+}
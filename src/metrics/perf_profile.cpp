@@ -0,0 +1,248 @@
+#include "kafka/metrics/perf_profile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+namespace kafka {
+
+namespace {
+
+struct EventType {
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+// Hardware events first, so that one of them leads the group when the machine has a PMU.
+constexpr EventType event_types[perf_event_count] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+int perf_event_open(perf_event_attr &attr, int group_fd) {
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+// The counters of one thread, opened as a group so that one system call reads them all.
+class ThreadCounters {
+public:
+    ThreadCounters() {
+        for (std::size_t event = 0; event < perf_event_count; event++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = event_types[event].type;
+            attr.config = event_types[event].config;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_hv = 1;
+            int group_fd = fds_.empty() ? -1 : fds_.front();
+            int fd = perf_event_open(attr, group_fd);
+            if (fd < 0 && errno == EACCES) {
+                // Without the privilege to count in the kernel, count in user space only.
+                attr.exclude_kernel = 1;
+                fd = perf_event_open(attr, group_fd);
+            }
+            if (fd < 0) {
+                errors_[event] = errno;
+                continue;
+            }
+            fds_.push_back(fd);
+            events_.push_back(event);
+        }
+    }
+
+    ~ThreadCounters() {
+        for (int fd : fds_) {
+            close(fd);
+        }
+    }
+
+    // Returns the error of an event that could not be opened, or 0.
+    int error(std::size_t event) const {
+        return errors_[event];
+    }
+
+    PerfCounts read() const {
+        PerfCounts counts{};
+        if (fds_.empty()) {
+            return counts;
+        }
+        // The number of events, the times the group was enabled and running, and the values.
+        std::uint64_t values[3 + perf_event_count];
+        if (::read(fds_.front(), values, sizeof(values)) < 0) {
+            return counts;
+        }
+        std::uint64_t enabled = values[1];
+        std::uint64_t running = values[2];
+        for (std::size_t i = 0; i < events_.size() && i < values[0]; i++) {
+            std::uint64_t value = values[3 + i];
+            // Scaled up for the time the group was multiplexed off the PMU.
+            if (running > 0 && running < enabled) {
+                value = static_cast<std::uint64_t>(static_cast<double>(value) * enabled / running);
+            }
+            counts[events_[i]] = value;
+        }
+        return counts;
+    }
+
+    ThreadCounters(const ThreadCounters &other) = delete;
+    ThreadCounters &operator=(const ThreadCounters &other) = delete;
+
+private:
+    std::vector<int> fds_;
+    // Events of the descriptors, in the order of the group.
+    std::vector<std::size_t> events_;
+    std::array<int, perf_event_count> errors_{};
+};
+
+ThreadCounters &local_counters() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+// Stages that run on the handler thread, where the counters of the request are read.
+constexpr RequestStage counted_stages[] = {RequestStage::DECODE, RequestStage::HANDLE, RequestStage::ENCODE};
+
+}
+
+static std::atomic<std::uint64_t> next_profile_id{0};
+
+PerfProfile::PerfProfile(bool enable) : id_(next_profile_id.fetch_add(1)) {
+    if (!enable) {
+        return;
+    }
+    ThreadCounters probe;
+    for (std::size_t event = 0; event < perf_event_count; event++) {
+        available_[event] = probe.error(event) == 0;
+        if (!available_[event]) {
+            std::clog << std::format("Cannot count {}: {}\n", perf_event_name(static_cast<PerfEvent>(event)),
+                                     std::strerror(probe.error(event)));
+        }
+        enabled_ = enabled_ || available_[event];
+    }
+}
+
+PerfProfile::Shard &PerfProfile::local_shard() {
+    // Shards of the instances this thread recorded into, usually just one.
+    thread_local std::vector<std::pair<std::uint64_t, Shard *>> local_shards;
+    for (auto [id, shard] : local_shards) {
+        if (id == id_) {
+            return *shard;
+        }
+    }
+    std::lock_guard<std::mutex> guard(shards_mutex_);
+    shards_.push_back(std::make_unique<Shard>());
+    local_shards.emplace_back(id_, shards_.back().get());
+    return *shards_.back();
+}
+
+PerfCounts PerfProfile::read() const {
+    return local_counters().read();
+}
+
+void PerfProfile::record(ApiKey api_key, RequestStage stage, const PerfCounts &begin, const PerfCounts &end) {
+    auto api = find_api(api_key);
+    if (!api) {
+        return;
+    }
+    StageCounts &counts = local_shard().stages[*api][std::to_underlying(stage)];
+    counts.samples.add(1);
+    for (std::size_t event = 0; event < perf_event_count; event++) {
+        // Scaling for multiplexing can make a later reading smaller.
+        if (end[event] > begin[event]) {
+            counts.events[event].add(end[event] - begin[event]);
+        }
+    }
+}
+
+void PerfProfile::write_prometheus(std::string &out) const {
+    std::lock_guard<std::mutex> guard(shards_mutex_);
+    auto sum = [&](std::size_t api, RequestStage stage, auto counter) {
+        std::uint64_t total = 0;
+        for (const auto &shard : shards_) {
+            total += counter(shard->stages[api][std::to_underlying(stage)]).get();
+        }
+        return total;
+    };
+    auto samples = [&](std::size_t api, RequestStage stage) {
+        return sum(api, stage, [](const StageCounts &counts) -> const Counter & { return counts.samples; });
+    };
+    auto events = [&](std::size_t api, RequestStage stage, std::size_t event) {
+        return sum(api, stage, [&](const StageCounts &counts) -> const Counter & { return counts.events[event]; });
+    };
+    auto labels = [](std::size_t api, RequestStage stage) {
+        return std::format("api=\"{}\",stage=\"{}\"", api_name(SupportedApis::versions[api].api_key),
+                           request_stage_name(stage));
+    };
+    auto append = std::back_inserter(out);
+
+    std::format_to(append, "# HELP kafka_request_perf_samples_total Requests whose stages were counted.\n"
+                           "# TYPE kafka_request_perf_samples_total counter\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        for (RequestStage stage : counted_stages) {
+            std::format_to(append, "kafka_request_perf_samples_total{{{}}} {}\n", labels(api, stage),
+                           samples(api, stage));
+        }
+    }
+
+    std::format_to(append, "# HELP kafka_request_perf_events_total Events counted on handler threads in each "
+                           "stage.\n"
+                           "# TYPE kafka_request_perf_events_total counter\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        for (RequestStage stage : counted_stages) {
+            for (std::size_t event = 0; event < perf_event_count; event++) {
+                if (available_[event]) {
+                    std::format_to(append, "kafka_request_perf_events_total{{{},event=\"{}\"}} {}\n",
+                                   labels(api, stage), perf_event_name(static_cast<PerfEvent>(event)),
+                                   events(api, stage, event));
+                }
+            }
+        }
+    }
+
+    std::format_to(append, "# HELP kafka_request_perf_events_per_request Average events per request in each "
+                           "stage.\n"
+                           "# TYPE kafka_request_perf_events_per_request gauge\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        for (RequestStage stage : counted_stages) {
+            std::uint64_t count = samples(api, stage);
+            for (std::size_t event = 0; event < perf_event_count && count > 0; event++) {
+                if (available_[event]) {
+                    std::format_to(append, "kafka_request_perf_events_per_request{{{},event=\"{}\"}} {:.3f}\n",
+                                   labels(api, stage), perf_event_name(static_cast<PerfEvent>(event)),
+                                   static_cast<double>(events(api, stage, event)) / static_cast<double>(count));
+                }
+            }
+        }
+    }
+
+    auto cycles = std::to_underlying(PerfEvent::CYCLES);
+    auto instructions = std::to_underlying(PerfEvent::INSTRUCTIONS);
+    if (!available_[cycles] || !available_[instructions]) {
+        return;
+    }
+    std::format_to(append, "# HELP kafka_request_perf_instructions_per_cycle Instructions retired per cycle in "
+                           "each stage.\n"
+                           "# TYPE kafka_request_perf_instructions_per_cycle gauge\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        for (RequestStage stage : counted_stages) {
+            std::uint64_t cycle_count = events(api, stage, cycles);
+            if (cycle_count > 0) {
+                std::format_to(append, "kafka_request_perf_instructions_per_cycle{{{}}} {:.3f}\n",
+                               labels(api, stage),
+                               static_cast<double>(events(api, stage, instructions)) /
+                                   static_cast<double>(cycle_count));
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,130 @@
+#include "kafka/metrics/request_metrics.hpp"
+
+#include <format>
+#include <iterator>
+#include <utility>
+
+namespace kafka {
+
+static std::atomic<std::uint64_t> next_metrics_id{0};
+
+RequestMetrics::RequestMetrics() : id_(next_metrics_id.fetch_add(1)) {}
+
+RequestMetrics::Shard &RequestMetrics::local_shard() {
+    // Shards of the instances this thread recorded into, usually just one.
+    thread_local std::vector<std::pair<std::uint64_t, Shard *>> local_shards;
+    for (auto [id, shard] : local_shards) {
+        if (id == id_) {
+            return *shard;
+        }
+    }
+    std::lock_guard<std::mutex> guard(shards_mutex_);
+    shards_.push_back(std::make_unique<Shard>());
+    local_shards.emplace_back(id_, shards_.back().get());
+    return *shards_.back();
+}
+
+void RequestMetrics::record_stage(ApiKey api_key, RequestStage stage, std::chrono::nanoseconds duration) {
+    if (auto api = find_api(api_key)) {
+        local_shard().latencies[*api][std::to_underlying(stage)].record(duration);
+    }
+}
+
+void RequestMetrics::record_request(ApiKey api_key, const RequestTimes &times, const ErrorCounts &error_counts) {
+    auto api = find_api(api_key);
+    if (!api) {
+        return;
+    }
+    Shard &shard = local_shard();
+    auto &latencies = shard.latencies[*api];
+    latencies[std::to_underlying(RequestStage::QUEUE_WAIT)].record(times.dequeued - times.enqueued);
+    latencies[std::to_underlying(RequestStage::DECODE)].record(times.decoded - times.dequeued);
+    latencies[std::to_underlying(RequestStage::HANDLE)].record(times.handled - times.decoded);
+    latencies[std::to_underlying(RequestStage::ENCODE)].record(times.encoded - times.handled);
+    shard.requests[*api].add(1);
+    for (std::size_t i = 0; i < error_code_count; i++) {
+        if (error_counts[i] != 0) {
+            shard.errors[*api][i].add(error_counts[i]);
+        }
+    }
+}
+
+void RequestMetrics::record_failed_request() {
+    local_shard().failed_requests.add(1);
+}
+
+void RequestMetrics::record_bytes_received(std::size_t bytes) {
+    local_shard().bytes_received.add(bytes);
+}
+
+void RequestMetrics::record_bytes_sent(std::size_t bytes) {
+    local_shard().bytes_sent.add(bytes);
+}
+
+void RequestMetrics::write_prometheus(std::string &out) const {
+    std::lock_guard<std::mutex> guard(shards_mutex_);
+    auto sum = [&](auto counter) {
+        std::uint64_t total = 0;
+        for (const auto &shard : shards_) {
+            total += counter(*shard).get();
+        }
+        return total;
+    };
+    auto append = std::back_inserter(out);
+
+    std::format_to(append, "# HELP kafka_request_stage_seconds Time requests spent in each stage.\n"
+                           "# TYPE kafka_request_stage_seconds summary\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        std::string_view name = api_name(SupportedApis::versions[api].api_key);
+        for (std::size_t stage = 0; stage < request_stage_count; stage++) {
+            LatencyHistogram::Snapshot snapshot;
+            for (const auto &shard : shards_) {
+                shard->latencies[api][stage].add_to(snapshot);
+            }
+            auto labels = std::format("api=\"{}\",stage=\"{}\"", name,
+                                      request_stage_name(static_cast<RequestStage>(stage)));
+            for (double quantile : {0.5, 0.99, 0.999, 1.0}) {
+                std::format_to(append, "kafka_request_stage_seconds{{{},quantile=\"{}\"}} {:.9f}\n", labels, quantile,
+                               snapshot.value_at_quantile(quantile).count() / 1e9);
+            }
+            std::format_to(append, "kafka_request_stage_seconds_sum{{{}}} {:.9f}\n", labels, snapshot.sum_ns / 1e9);
+            std::format_to(append, "kafka_request_stage_seconds_count{{{}}} {}\n", labels, snapshot.count);
+        }
+    }
+
+    std::format_to(append, "# HELP kafka_requests_total Requests handled.\n"
+                           "# TYPE kafka_requests_total counter\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        std::format_to(append, "kafka_requests_total{{api=\"{}\"}} {}\n",
+                       api_name(SupportedApis::versions[api].api_key),
+                       sum([&](const Shard &shard) -> const Counter & { return shard.requests[api]; }));
+    }
+
+    std::format_to(append, "# HELP kafka_request_errors_total Error codes in responses.\n"
+                           "# TYPE kafka_request_errors_total counter\n");
+    for (std::size_t api = 0; api < SupportedApis::size; api++) {
+        for (std::size_t error = 0; error < error_code_count; error++) {
+            if (error_codes[error] == ErrorCode::NONE) {
+                continue;
+            }
+            std::format_to(append, "kafka_request_errors_total{{api=\"{}\",error=\"{}\"}} {}\n",
+                           api_name(SupportedApis::versions[api].api_key), error_code_name(error_codes[error]),
+                           sum([&](const Shard &shard) -> const Counter & { return shard.errors[api][error]; }));
+        }
+    }
+
+    std::format_to(append, "# HELP kafka_failed_requests_total Requests that closed their connection.\n"
+                           "# TYPE kafka_failed_requests_total counter\n"
+                           "kafka_failed_requests_total {}\n",
+                   sum([](const Shard &shard) -> const Counter & { return shard.failed_requests; }));
+    std::format_to(append, "# HELP kafka_network_received_bytes_total Bytes of request frames received.\n"
+                           "# TYPE kafka_network_received_bytes_total counter\n"
+                           "kafka_network_received_bytes_total {}\n",
+                   sum([](const Shard &shard) -> const Counter & { return shard.bytes_received; }));
+    std::format_to(append, "# HELP kafka_network_sent_bytes_total Bytes of responses sent.\n"
+                           "# TYPE kafka_network_sent_bytes_total counter\n"
+                           "kafka_network_sent_bytes_total {}\n",
+                   sum([](const Shard &shard) -> const Counter & { return shard.bytes_sent; }));
+}
+
+}
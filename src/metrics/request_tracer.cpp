@@ -0,0 +1,166 @@
+#include "kafka/metrics/request_tracer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace kafka {
+
+void RequestTrace::set_client_id(std::string_view id) {
+    std::size_t size = std::min(id.size(), max_client_id_size);
+    std::copy_n(id.data(), size, client_id.data());
+    client_id[size] = '\0';
+}
+
+std::chrono::nanoseconds RequestTrace::stage_duration(RequestStage stage) const {
+    switch (stage) {
+    case RequestStage::QUEUE_WAIT:
+        return times.dequeued - times.enqueued;
+    case RequestStage::DECODE:
+        return times.decoded - times.dequeued;
+    case RequestStage::HANDLE:
+        return times.handled - times.decoded;
+    case RequestStage::ENCODE:
+        return times.encoded - times.handled;
+    case RequestStage::SEND:
+        return sent - times.encoded;
+    }
+    return std::chrono::nanoseconds(0);
+}
+
+static std::atomic<std::uint64_t> next_tracer_id{0};
+
+RequestTracer::RequestTracer(std::size_t ring_capacity, std::chrono::milliseconds slow_request_threshold)
+    : id_(next_tracer_id.fetch_add(1)), ring_capacity_(ring_capacity), slow_request_threshold_(slow_request_threshold) {}
+
+RequestTracer::Ring &RequestTracer::local_ring() {
+    // Rings of the tracers this thread recorded into, usually just one.
+    thread_local std::vector<std::pair<std::uint64_t, Ring *>> local_rings;
+    for (auto [id, ring] : local_rings) {
+        if (id == id_) {
+            return *ring;
+        }
+    }
+    std::lock_guard<std::mutex> guard(rings_mutex_);
+    rings_.push_back(std::make_unique<Ring>(ring_capacity_));
+    local_rings.emplace_back(id_, rings_.back().get());
+    return *rings_.back();
+}
+
+void RequestTracer::record(const RequestTrace &trace) {
+    if (ring_capacity_ > 0) {
+        Ring &ring = local_ring();
+        std::uint64_t written = ring.written.load(std::memory_order_relaxed);
+        Slot &slot = ring.slots[written % ring_capacity_];
+        std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.trace = trace;
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        ring.written.store(written + 1, std::memory_order_release);
+    }
+    if (slow_request_threshold_.count() > 0 && trace.sent - trace.times.enqueued >= slow_request_threshold_) {
+        std::clog << format_slow_request(trace);
+    }
+}
+
+std::vector<RequestTrace> RequestTracer::traces() const {
+    std::vector<RequestTrace> traces;
+    std::lock_guard<std::mutex> guard(rings_mutex_);
+    for (const auto &ring : rings_) {
+        std::uint64_t written = ring->written.load(std::memory_order_acquire);
+        std::uint64_t first = written > ring_capacity_ ? written - ring_capacity_ : 0;
+        for (std::uint64_t i = first; i < written; i++) {
+            const Slot &slot = ring->slots[i % ring_capacity_];
+            std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            RequestTrace trace = slot.trace;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Skip a slot that was being overwritten while it was copied.
+            if (sequence % 2 == 0 && slot.sequence.load(std::memory_order_relaxed) == sequence) {
+                traces.push_back(trace);
+            }
+        }
+    }
+    std::sort(traces.begin(), traces.end(), [](const RequestTrace &lhs, const RequestTrace &rhs) {
+        return lhs.times.enqueued < rhs.times.enqueued;
+    });
+    return traces;
+}
+
+static void append_json_string(std::string &out, std::string_view str) {
+    out += '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+static double to_microseconds(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration<double, std::micro>(time.time_since_epoch()).count();
+}
+
+void RequestTracer::write_chrome_trace(std::string &out) const {
+    // Requests overlap, so each is a nestable async event with its stages nested inside.
+    auto append = std::back_inserter(out);
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    std::uint64_t id = 0;
+    for (const auto &trace : traces()) {
+        id++;
+        std::string_view name = api_name(trace.api_key);
+        std::format_to(append, "{}{{\"name\":\"{}\",\"cat\":\"request\",\"ph\":\"b\",\"id\":{},\"pid\":1,\"tid\":1,"
+                               "\"ts\":{:.3f},\"args\":{{\"api_version\":{},\"correlation_id\":{},\"client_id\":",
+                       id == 1 ? "" : ",", name, id, to_microseconds(trace.times.enqueued), trace.api_version,
+                       trace.correlation_id);
+        append_json_string(out, trace.client_id_view());
+        std::format_to(append, ",\"topics\":{},\"partitions\":{}}}}}", trace.topic_count, trace.partition_count);
+
+        auto stage_start = trace.times.enqueued;
+        for (std::size_t stage = 0; stage < request_stage_count; stage++) {
+            auto stage_end = stage_start + trace.stage_duration(static_cast<RequestStage>(stage));
+            std::string_view stage_name = request_stage_name(static_cast<RequestStage>(stage));
+            std::format_to(append, ",{{\"name\":\"{}\",\"cat\":\"request\",\"ph\":\"b\",\"id\":{},\"pid\":1,"
+                                   "\"tid\":1,\"ts\":{:.3f}}}",
+                           stage_name, id, to_microseconds(stage_start));
+            std::format_to(append, ",{{\"name\":\"{}\",\"cat\":\"request\",\"ph\":\"e\",\"id\":{},\"pid\":1,"
+                                   "\"tid\":1,\"ts\":{:.3f}}}",
+                           stage_name, id, to_microseconds(stage_end));
+            stage_start = stage_end;
+        }
+        std::format_to(append, ",{{\"name\":\"{}\",\"cat\":\"request\",\"ph\":\"e\",\"id\":{},\"pid\":1,\"tid\":1,"
+                               "\"ts\":{:.3f}}}",
+                       name, id, to_microseconds(trace.sent));
+    }
+    out += "]}\n";
+}
+
+std::string RequestTracer::format_slow_request(const RequestTrace &trace) {
+    auto milliseconds = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+    std::string line = std::format("Slow request: {} v{} correlation_id={} client_id={} topics={} partitions={} "
+                                   "total={:.3f} ms (",
+                                   api_name(trace.api_key), trace.api_version, trace.correlation_id,
+                                   trace.client_id_view(), trace.topic_count, trace.partition_count,
+                                   milliseconds(trace.sent - trace.times.enqueued));
+    for (std::size_t stage = 0; stage < request_stage_count; stage++) {
+        std::format_to(std::back_inserter(line), "{}{}={:.3f}", stage == 0 ? "" : " ",
+                       request_stage_name(static_cast<RequestStage>(stage)),
+                       milliseconds(trace.stage_duration(static_cast<RequestStage>(stage))));
+    }
+    line += " ms)\n";
+    return line;
+}
+
+}
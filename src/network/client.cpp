@@ -0,0 +1,224 @@
+#include "kafka/network/client.hpp"
+#include "kafka/protocol/types.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <utility>
+
+namespace kafka {
+
+bool Client::receive_frames(std::vector<RequestFrame> &frames) {
+    RequestFrame frame;
+    while (take_frame(frame)) {
+        frames.push_back(std::move(frame));
+    }
+    if (waiting_for_memory_) {
+        return true;
+    }
+
+    if (!large_frame_.bytes.empty()) {
+        ssize_t nr = recv(socket(), large_frame_.bytes.data() + large_frame_received_,
+                          large_frame_.bytes.size() - large_frame_received_, MSG_DONTWAIT);
+        if (nr < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        } else if (nr == 0) {
+            return false;
+        }
+        large_frame_received_ += nr;
+        if (large_frame_received_ == large_frame_.bytes.size()) {
+            capture_request(large_frame_.bytes);
+            frames.push_back(std::move(large_frame_));
+            large_frame_ = RequestFrame();
+        }
+        return true;
+    }
+
+    // Move a partial frame to the front so the receive has as much room as possible.
+    if (receive_begin_ > 0) {
+        std::copy(receive_buffer_.begin() + receive_begin_, receive_buffer_.begin() + receive_end_,
+                  receive_buffer_.begin());
+        receive_end_ -= receive_begin_;
+        receive_begin_ = 0;
+    }
+
+    ssize_t nr = recv(socket(), receive_buffer_.data() + receive_end_, receive_buffer_.size() - receive_end_,
+                      MSG_DONTWAIT);
+    if (nr < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    } else if (nr == 0) {
+        return false;
+    }
+    receive_end_ += nr;
+
+    while (take_frame(frame)) {
+        frames.push_back(std::move(frame));
+    }
+    return true;
+}
+
+void Client::complete(std::uint64_t sequence, ResponseFrame response, bool succeeded) {
+    auto throttled_until = std::chrono::steady_clock::now() + response.throttle_time;
+    std::lock_guard<std::mutex> guard(response_mutex_);
+    completed_throttled_until_ = std::max(completed_throttled_until_, throttled_until);
+    if (!succeeded) {
+        if (!failed_ || sequence < failed_sequence_) {
+            failed_sequence_ = sequence;
+        }
+        failed_ = true;
+        return;
+    }
+    response.charge = MemoryCharge(MemoryCategory::RESPONSES, response.bytes.size(), memory_);
+    completed_responses_.emplace(sequence, std::move(response));
+}
+
+void Client::queue_completed_responses() {
+    std::lock_guard<std::mutex> guard(response_mutex_);
+    for (auto iter = completed_responses_.begin();
+         iter != completed_responses_.end() && iter->first == next_response_;
+         iter = completed_responses_.erase(iter), next_response_++) {
+        output_bytes_ += iter->second.bytes.size();
+        output_queue_.push_back(std::move(iter->second));
+    }
+    throttled_until_ = completed_throttled_until_;
+    if (failed_ && failed_sequence_ == next_response_) {
+        closing_ = true;
+    }
+    if (output_bytes_ >= output_high_water_) {
+        output_full_ = true;
+    }
+}
+
+bool Client::send_output() {
+    static constexpr std::size_t max_iovecs = 64;
+    while (!output_queue_.empty()) {
+        iovec iov[max_iovecs];
+        std::size_t count = 0;
+        for (auto iter = output_queue_.begin(); iter != output_queue_.end() && count < max_iovecs; ++iter, count++) {
+            std::size_t offset = count == 0 ? output_offset_ : 0;
+            iov[count].iov_base = iter->bytes.data() + offset;
+            iov[count].iov_len = iter->bytes.size() - offset;
+        }
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t nw = sendmsg(socket(), &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (nw < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        output_bytes_ -= nw;
+        metrics_.record_bytes_sent(nw);
+        auto remaining = static_cast<std::size_t>(nw);
+        std::optional<std::chrono::steady_clock::time_point> sent_time;
+        while (remaining > 0 && remaining >= output_queue_.front().bytes.size() - output_offset_) {
+            remaining -= output_queue_.front().bytes.size() - output_offset_;
+            if (!sent_time) {
+                sent_time = std::chrono::steady_clock::now();
+            }
+            RequestTrace &trace = output_queue_.front().trace;
+            trace.sent = *sent_time;
+            metrics_.record_stage(trace.api_key, RequestStage::SEND, trace.sent - trace.times.encoded);
+            if (tracer_.enabled()) {
+                tracer_.record(trace);
+            }
+            if (capture_.enabled()) {
+                capture_.record(CaptureDirection::RESPONSE, capture_connection_, trace.sent,
+                                std::span<const unsigned char>(output_queue_.front().bytes).subspan(sizeof(INT32)));
+            }
+            output_queue_.pop_front();
+            output_offset_ = 0;
+        }
+        output_offset_ += remaining;
+    }
+    output_full_ = false;
+    return true;
+}
+
+bool Client::take_frame(RequestFrame &frame) {
+    std::size_t available = receive_end_ - receive_begin_;
+    INT32 frame_size;
+    if (available < sizeof(frame_size)) {
+        return false;
+    }
+    std::memcpy(&frame_size, receive_buffer_.data() + receive_begin_, sizeof(frame_size));
+    frame_size = to_host_byte_order(frame_size);
+    if (frame_size < 0) {
+        throw_runtime_error("negative request size");
+    }
+    if (static_cast<std::size_t>(frame_size) > max_request_size_) {
+        throw_runtime_error("request size exceeds socket.request.max.bytes");
+    }
+    // Nothing is buffered for a frame beyond the receive buffer before its memory is reserved.
+    if (!frame_memory_ && !reserve_frame_memory(frame_size)) {
+        return false;
+    }
+
+    std::size_t total_size = sizeof(frame_size) + frame_size;
+    auto first = receive_buffer_.begin() + receive_begin_ + sizeof(frame_size);
+    if (available < total_size) {
+        if (total_size > receive_buffer_.size()) {
+            // The rest of a frame larger than the receive buffer is received straight into the
+            // frame's own buffer, which its reservation covers, so it is never held twice.
+            large_frame_.bytes.resize(frame_size);
+            std::copy(first, receive_buffer_.begin() + receive_end_, large_frame_.bytes.begin());
+            large_frame_received_ = available - sizeof(frame_size);
+            large_frame_.charge = MemoryCharge(MemoryCategory::REQUEST_FRAMES, frame_size, memory_);
+            large_frame_.memory = std::move(*frame_memory_);
+            frame_memory_.reset();
+            receive_begin_ = 0;
+            receive_end_ = 0;
+        }
+        return false;
+    }
+
+    frame.bytes.assign(first, first + frame_size);
+    frame.charge = MemoryCharge(MemoryCategory::REQUEST_FRAMES, frame.bytes.size(), memory_);
+    capture_request(frame.bytes);
+    frame.memory = std::move(*frame_memory_);
+    frame_memory_.reset();
+    receive_begin_ += total_size;
+    return true;
+}
+
+void Client::capture_request(const BYTES &frame) {
+    if (capture_.enabled()) {
+        capture_.record(CaptureDirection::REQUEST, capture_connection_, std::chrono::steady_clock::now(), frame);
+    }
+}
+
+bool Client::reserve_frame_memory(std::size_t frame_size) {
+    if (!waiting_for_memory_) {
+        frame_memory_ = memory_pool_.allocate_or_wait(frame_size);
+        if (!frame_memory_) {
+            waiting_for_memory_ = true;
+            wait_start_ = std::chrono::steady_clock::now();
+        }
+    } else if ((frame_memory_ = memory_pool_.try_allocate(frame_size))) {
+        waiting_for_memory_ = false;
+        memory_pool_.end_wait(std::chrono::steady_clock::now() - wait_start_, true);
+    }
+    return frame_memory_.has_value();
+}
+
+std::string Client::peer_address(int socket) {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    char host[INET_ADDRSTRLEN];
+    if (getpeername(socket, reinterpret_cast<sockaddr *>(&address), &length) != 0 || address.sin_family != AF_INET ||
+        !inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host))) {
+        return "unknown";
+    }
+    return std::format("{}:{}", host, ntohs(address.sin_port));
+}
+
+}
@@ -0,0 +1,173 @@
+#include "kafka/network/client_quota_manager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+namespace kafka {
+
+static std::int64_t to_ns(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+RateSensor::RateSensor(std::size_t samples, std::chrono::nanoseconds window, std::chrono::steady_clock::time_point now)
+    : window_ns_(window.count()), samples_(samples), current_(0), current_start_ns_(to_ns(now)) {}
+
+void RateSensor::record(std::uint64_t value, std::chrono::steady_clock::time_point now) {
+    std::int64_t now_ns = to_ns(now);
+    if (now_ns - current_start_ns_.load(std::memory_order_acquire) >= window_ns_) {
+        roll(now_ns);
+    }
+    static thread_local const std::size_t stripe = std::hash<std::thread::id>()(std::this_thread::get_id()) % stripes;
+    stripes_[stripe].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+void RateSensor::roll(std::int64_t now_ns) {
+    // One thread closes the window; the others keep recording into the stripes.
+    std::unique_lock<std::mutex> lock(roll_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    std::int64_t start_ns = current_start_ns_.load(std::memory_order_relaxed);
+    std::size_t current = current_.load(std::memory_order_relaxed);
+    std::uint64_t merged = 0;
+    for (auto &stripe : stripes_) {
+        merged += stripe.value.exchange(0, std::memory_order_relaxed);
+    }
+    samples_[current].store(merged, std::memory_order_relaxed);
+
+    auto elapsed_windows = static_cast<std::size_t>((now_ns - start_ns) / window_ns_);
+    for (std::size_t i = 0; i < std::min(elapsed_windows, samples_.size()); i++) {
+        current = (current + 1) % samples_.size();
+        samples_[current].store(0, std::memory_order_relaxed);
+    }
+    current_.store(current, std::memory_order_relaxed);
+    current_start_ns_.store(start_ns + static_cast<std::int64_t>(elapsed_windows) * window_ns_,
+                            std::memory_order_release);
+}
+
+double RateSensor::rate(std::chrono::steady_clock::time_point now) const {
+    std::uint64_t total = 0;
+    for (const auto &sample : samples_) {
+        total += sample.load(std::memory_order_relaxed);
+    }
+    for (const auto &stripe : stripes_) {
+        total += stripe.value.load(std::memory_order_relaxed);
+    }
+    return total / std::chrono::duration<double>(measured_span(now)).count();
+}
+
+std::chrono::nanoseconds RateSensor::measured_span(std::chrono::steady_clock::time_point now) const {
+    // The completed windows, and as much of the current one as has passed.
+    std::int64_t current_ns = std::clamp<std::int64_t>(to_ns(now) - current_start_ns_.load(std::memory_order_relaxed),
+                                                       1, window_ns_);
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(samples_.size() - 1) * window_ns_ + current_ns);
+}
+
+static bool limited(const ClientQuota &quota) {
+    return quota.byte_rate > 0 || quota.request_percentage > 0;
+}
+
+ClientQuotaManager::Entity::Entity(const ClientQuotaManager &manager, const ClientQuota &quota,
+                                   std::chrono::steady_clock::time_point now)
+    : quota(quota), bytes(manager.samples_, manager.window_, now), request_time(manager.samples_, manager.window_, now),
+      last_record_ns(to_ns(now)) {}
+
+ClientQuotaManager::ClientQuotaManager(const ServerConfig &config)
+    : samples_(config.quota_window_num), window_(std::chrono::seconds(config.quota_window_size_seconds)),
+      default_quota_(config.client_quota_default), enabled_(limited(default_quota_)),
+      last_expiry_ns_(to_ns(std::chrono::steady_clock::now())) {
+    // Overrides are keyed `user:<name>` or `client-id:<id>`.
+    for (const auto &[entity, quota] : config.client_quota_overrides) {
+        std::string_view key = entity;
+        if (key.starts_with("user:")) {
+            user_quotas_.emplace(key.substr(5), quota);
+        } else if (key.starts_with("client-id:")) {
+            client_id_quotas_.emplace(key.substr(10), quota);
+        }
+        enabled_ = enabled_ || limited(quota);
+    }
+}
+
+std::chrono::milliseconds ClientQuotaManager::record(std::string_view user, std::string_view client_id,
+                                                     std::size_t response_bytes, std::chrono::nanoseconds request_time) {
+    // A user quota covers every client of the user; otherwise each client ID has its own.
+    Entities *entities = &user_entities_;
+    std::string_view name = user;
+    const ClientQuota *quota = nullptr;
+    if (auto iter = user_quotas_.find(user); iter != user_quotas_.end()) {
+        quota = &iter->second;
+    } else {
+        entities = &client_id_entities_;
+        name = client_id;
+        auto client_id_iter = client_id_quotas_.find(client_id);
+        quota = client_id_iter != client_id_quotas_.end() ? &client_id_iter->second : &default_quota_;
+    }
+    if (!limited(*quota)) {
+        return std::chrono::milliseconds(0);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (auto iter = entities->find(name); iter != entities->end()) {
+            return record(*iter->second, response_bytes, request_time, now);
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    expire_idle_entities(now);
+    auto [iter, inserted] = entities->try_emplace(std::string(name));
+    if (inserted) {
+        iter->second = std::make_unique<Entity>(*this, *quota, now);
+    }
+    return record(*iter->second, response_bytes, request_time, now);
+}
+
+std::chrono::milliseconds ClientQuotaManager::record(Entity &quota_entity, std::size_t response_bytes,
+                                                     std::chrono::nanoseconds request_time,
+                                                     std::chrono::steady_clock::time_point now) const {
+    quota_entity.last_record_ns.store(to_ns(now), std::memory_order_relaxed);
+    std::chrono::milliseconds throttle(0);
+    if (quota_entity.quota.byte_rate > 0) {
+        quota_entity.bytes.record(response_bytes, now);
+        throttle = std::max(throttle, throttle_time(quota_entity.bytes, quota_entity.quota.byte_rate, now));
+    }
+    if (quota_entity.quota.request_percentage > 0) {
+        // A percentage of one thread is that many hundredths of a second per second.
+        quota_entity.request_time.record(request_time.count(), now);
+        double quota_ns = quota_entity.quota.request_percentage / 100.0 * 1e9;
+        throttle = std::max(throttle, throttle_time(quota_entity.request_time, quota_ns, now));
+    }
+    return throttle;
+}
+
+void ClientQuotaManager::expire_idle_entities(std::chrono::steady_clock::time_point now) {
+    // Called with the mutex held exclusively, at most once per window.
+    std::int64_t now_ns = to_ns(now);
+    if (now_ns - last_expiry_ns_ < window_.count()) {
+        return;
+    }
+    last_expiry_ns_ = now_ns;
+    std::int64_t idle_ns = (window_ * samples_).count();
+    auto idle = [&](const auto &entry) {
+        return now_ns - entry.second->last_record_ns.load(std::memory_order_relaxed) > idle_ns;
+    };
+    std::erase_if(user_entities_, idle);
+    std::erase_if(client_id_entities_, idle);
+}
+
+std::chrono::milliseconds ClientQuotaManager::throttle_time(const RateSensor &sensor, double quota,
+                                                            std::chrono::steady_clock::time_point now) const {
+    // Like Kafka: long enough that the rate over the measured span falls back to the quota,
+    // and at most the length of all windows.
+    double rate = sensor.rate(now);
+    if (rate <= quota) {
+        return std::chrono::milliseconds(0);
+    }
+    auto span = std::chrono::duration_cast<std::chrono::milliseconds>(sensor.measured_span(now));
+    auto throttle = std::chrono::milliseconds(static_cast<std::int64_t>(std::ceil((rate - quota) / quota * span.count())));
+    return std::min(throttle, std::chrono::duration_cast<std::chrono::milliseconds>(window_ * samples_));
+}
+
+}
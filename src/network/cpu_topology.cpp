@@ -0,0 +1,161 @@
+#include "kafka/network/cpu_topology.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <sched.h>
+
+namespace kafka {
+
+// Parses a CPU number, throwing on anything else.
+static int parse_cpu(std::string_view text, std::string_view list) {
+    int cpu = -1;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), cpu);
+    if (error != std::errc() || end != text.data() + text.size() || cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw_runtime_error(std::format("invalid CPU list: {}", list).c_str());
+    }
+    return cpu;
+}
+
+std::vector<int> parse_cpu_list(std::string_view text) {
+    std::vector<int> cpus;
+    std::string_view rest = text;
+    while (!rest.empty()) {
+        auto comma = rest.find(',');
+        std::string_view range = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+        auto dash = range.find('-');
+        int first = parse_cpu(range.substr(0, dash), text);
+        int last = dash == std::string_view::npos ? first : parse_cpu(range.substr(dash + 1), text);
+        if (last < first) {
+            throw_runtime_error(std::format("invalid CPU list: {}", text).c_str());
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string format_cpu_list(const std::vector<int> &cpus) {
+    std::string out;
+    for (std::size_t i = 0; i < cpus.size(); ) {
+        std::size_t end = i + 1;
+        while (end < cpus.size() && cpus[end] == cpus[end - 1] + 1) {
+            end++;
+        }
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += end - i == 1 ? std::format("{}", cpus[i]) : std::format("{}-{}", cpus[i], cpus[end - 1]);
+        i = end;
+    }
+    return out;
+}
+
+CpuTopology CpuTopology::detect() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        throw_system_error("sched_getaffinity");
+    }
+    auto allowed_cpus = [&](const std::vector<int> &cpus) {
+        std::vector<int> result;
+        std::copy_if(cpus.begin(), cpus.end(), std::back_inserter(result),
+                     [&](int cpu) { return CPU_ISSET(cpu, &allowed); });
+        return result;
+    };
+
+    CpuTopology topology;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        std::string name = entry.path().filename();
+        int id = -1;
+        if (!name.starts_with("node") ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), id).ec != std::errc()) {
+            continue;
+        }
+        std::string cpu_list;
+        std::getline(std::ifstream(entry.path() / "cpulist"), cpu_list);
+        auto cpus = allowed_cpus(parse_cpu_list(cpu_list));
+        if (!cpus.empty()) {
+            topology.nodes_.push_back(NumaNode{id, std::move(cpus)});
+        }
+    }
+    if (topology.nodes_.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            cpus.push_back(cpu);
+        }
+        topology.nodes_.push_back(NumaNode{0, allowed_cpus(cpus)});
+    }
+    std::sort(topology.nodes_.begin(), topology.nodes_.end(),
+              [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+    return topology;
+}
+
+std::vector<NumaNode> CpuTopology::split(const std::vector<int> &cpus) const {
+    std::vector<NumaNode> nodes;
+    for (const NumaNode &node : nodes_) {
+        std::vector<int> node_cpus;
+        std::set_intersection(node.cpus.begin(), node.cpus.end(), cpus.begin(), cpus.end(),
+                              std::back_inserter(node_cpus));
+        if (!node_cpus.empty()) {
+            nodes.push_back(NumaNode{node.id, std::move(node_cpus)});
+        }
+    }
+    std::size_t placed = 0;
+    for (const NumaNode &node : nodes) {
+        placed += node.cpus.size();
+    }
+    if (placed != cpus.size()) {
+        throw_runtime_error(std::format("cannot place threads on CPUs {}: this process may only run on {}",
+                                        format_cpu_list(cpus), describe()).c_str());
+    }
+    return nodes;
+}
+
+std::string CpuTopology::describe() const {
+    std::string out;
+    for (const NumaNode &node : nodes_) {
+        out += std::format("{}node {} (CPUs {})", out.empty() ? "" : ", ", node.id, format_cpu_list(node.cpus));
+    }
+    return out;
+}
+
+void pin_thread(pthread_t thread, const CpuSlot &slot) {
+    if (slot.cpus.empty()) {
+        return;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : slot.cpus) {
+        CPU_SET(cpu, &cpus);
+    }
+    if (int error = pthread_setaffinity_np(thread, sizeof(cpus), &cpus); error != 0) {
+        errno = error;
+        throw_system_error("pthread_setaffinity_np");
+    }
+}
+
+std::string ThreadPlacement::describe(std::size_t count) const {
+    if (nodes_.empty()) {
+        return std::format("{} unpinned", count);
+    }
+    std::string out;
+    for (std::size_t i = 0; i < nodes_.size() && i < count; i++) {
+        std::size_t threads = count / nodes_.size() + (i < count % nodes_.size() ? 1 : 0);
+        out += std::format("{}node {} (CPUs {}): {}", out.empty() ? "" : ", ", nodes_[i].id,
+                           format_cpu_list(nodes_[i].cpus), threads);
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,77 @@
+#include "kafka/network/delay_queue.hpp"
+
+namespace kafka {
+
+DelayQueue::DelayQueue() : thread_(&DelayQueue::run, this) {}
+
+std::size_t DelayQueue::size() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return entries_.size();
+}
+
+void DelayQueue::stop() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    changed_.notify_one();
+    thread_.join();
+
+    // Resumed coroutines that wait again are resumed right away, so this ends.
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!entries_.empty()) {
+        Entry entry = entries_.top();
+        entries_.pop();
+        lock.unlock();
+        entry.executor->post(entry.coroutine);
+        lock.lock();
+    }
+}
+
+bool DelayQueue::push(Clock::time_point deadline, Executor &executor, std::coroutine_handle<> coroutine) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        earliest = entries_.empty() || deadline < entries_.top().deadline;
+        entries_.push(Entry{deadline, next_sequence_++, &executor, coroutine});
+    }
+    if (earliest) {
+        changed_.notify_one();
+    }
+    return true;
+}
+
+void DelayQueue::run() {
+    std::vector<Entry> expired;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (entries_.empty()) {
+            changed_.wait(lock);
+            continue;
+        }
+        auto now = Clock::now();
+        while (!entries_.empty() && entries_.top().deadline <= now) {
+            expired.push_back(entries_.top());
+            entries_.pop();
+        }
+        if (expired.empty()) {
+            changed_.wait_until(lock, entries_.top().deadline);
+            continue;
+        }
+        // Executors may block while their queues are full, so post without the lock.
+        lock.unlock();
+        for (const Entry &entry : expired) {
+            entry.executor->post(entry.coroutine);
+        }
+        expired.clear();
+        lock.lock();
+    }
+}
+
+}
@@ -0,0 +1,70 @@
+#include "kafka/network/memory_pool.hpp"
+
+#include <algorithm>
+
+namespace kafka {
+
+std::optional<MemoryLease> MemoryPool::try_allocate(std::size_t size) {
+    std::size_t used = used_.load();
+    do {
+        if (used != 0 && size > capacity_ - std::min(used, capacity_)) {
+            return std::nullopt;
+        }
+    } while (!used_.compare_exchange_weak(used, used + size));
+
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t peak_used = peak_used_.load(std::memory_order_relaxed);
+    while (used + size > peak_used &&
+           !peak_used_.compare_exchange_weak(peak_used, used + size, std::memory_order_relaxed)) {
+    }
+    return MemoryLease(this, size);
+}
+
+std::optional<MemoryLease> MemoryPool::allocate_or_wait(std::size_t size) {
+    if (auto lease = try_allocate(size)) {
+        return lease;
+    }
+    // Count the caller as waiting before trying again, so that a release in between either
+    // makes this attempt succeed or sees the waiter and calls the listener.
+    waiting_.fetch_add(1);
+    if (auto lease = try_allocate(size)) {
+        end_wait(std::chrono::nanoseconds(0), true);
+        return lease;
+    }
+    return std::nullopt;
+}
+
+void MemoryPool::end_wait(std::chrono::nanoseconds wait, bool allocated) {
+    waiting_.fetch_sub(1);
+    if (!allocated) {
+        return;
+    }
+    auto wait_ns = static_cast<std::uint64_t>(wait.count());
+    waits_.fetch_add(1, std::memory_order_relaxed);
+    total_wait_ns_.fetch_add(wait_ns, std::memory_order_relaxed);
+    std::uint64_t max_wait_ns = max_wait_ns_.load(std::memory_order_relaxed);
+    while (wait_ns > max_wait_ns && !max_wait_ns_.compare_exchange_weak(max_wait_ns, wait_ns, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryPool::release(std::size_t size) {
+    used_.fetch_sub(size);
+    if (waiting_.load() > 0 && release_listener_) {
+        release_listener_();
+    }
+}
+
+MemoryPool::Stats MemoryPool::stats() const {
+    return Stats{
+        capacity_,
+        used_.load(std::memory_order_relaxed),
+        peak_used_.load(std::memory_order_relaxed),
+        allocations_.load(std::memory_order_relaxed),
+        waiting_.load(std::memory_order_relaxed),
+        waits_.load(std::memory_order_relaxed),
+        total_wait_ns_.load(std::memory_order_relaxed),
+        max_wait_ns_.load(std::memory_order_relaxed),
+    };
+}
+
+}
@@ -0,0 +1,349 @@
+#include "kafka/network/processor.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+namespace kafka {
+
+static FileDescriptor make_epoll_fd() {
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0) {
+        throw_system_error("epoll_create1");
+    }
+    return FileDescriptor(fd);
+}
+
+static FileDescriptor make_event_fd() {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        throw_system_error("eventfd");
+    }
+    return FileDescriptor(fd);
+}
+
+static void add_to_epoll(int epoll_fd, int fd, std::uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        throw_system_error("epoll_ctl");
+    }
+}
+
+Processor::Processor(RequestHandlerPool &handler_pool, MemoryPool &memory_pool, RequestMetrics &metrics,
+                     RequestTracer &tracer, RequestCapture &capture, std::size_t max_request_size,
+                     std::size_t output_high_water, const CpuSlot &slot)
+    : handler_pool_(handler_pool), memory_pool_(memory_pool), metrics_(metrics), tracer_(tracer), capture_(capture),
+      max_request_size_(max_request_size), output_high_water_(output_high_water), node_(slot.node),
+      epoll_fd_(make_epoll_fd()),
+      wakeup_fd_(make_event_fd()), connections_(0), output_bytes_(0), output_full_connections_(0),
+      memory_muted_connections_(0), throttled_connections_(0), blocked_sends_(0), stopping_(false) {
+    add_to_epoll(epoll_fd_.get(), wakeup_fd_.get(), EPOLLIN);
+    thread_ = std::thread(&Processor::run, this);
+    pin_thread(thread_.native_handle(), slot);
+}
+
+void Processor::stop() {
+    stopping_.store(true);
+    signal();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Processor::accept(int client_socket) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        accepted_sockets_.push_back(client_socket);
+    }
+    signal();
+}
+
+void Processor::wakeup(std::shared_ptr<Client> client) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ready_clients_.push_back(std::move(client));
+    }
+    signal();
+}
+
+void Processor::memory_released() {
+    // Signalled even before a connection waiting for memory is muted, so that the wakeup of
+    // a release that happens in between is not lost.
+    signal();
+}
+
+void Processor::signal() {
+    std::uint64_t one = 1;
+    wakeup_fd_.write(&one, sizeof(one));
+}
+
+void Processor::run() {
+    static constexpr int max_events = 64;
+    epoll_event events[max_events];
+    while (!stopping_.load()) {
+        int n = epoll_wait(epoll_fd_.get(), events, max_events, throttle_timeout());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_system_error("epoll_wait");
+        }
+        unthrottle_clients();
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wakeup_fd_.get()) {
+                std::uint64_t count;
+                while (::read(fd, &count, sizeof(count)) > 0) {
+                }
+                register_accepted_clients();
+                write_ready_responses();
+                read_muted_clients();
+                continue;
+            }
+
+            auto iter = clients_.find(fd);
+            if (iter == clients_.end()) {
+                continue;
+            }
+            std::shared_ptr<Client> client(iter->second);
+            std::uint32_t ready = events[i].events;
+            if (ready & EPOLLOUT) {
+                send_output(client);
+                if (!clients_.contains(fd)) {
+                    continue;
+                }
+            }
+            if (ready & (EPOLLIN | EPOLLRDHUP)) {
+                read_requests(client);
+            } else if (ready & (EPOLLHUP | EPOLLERR)) {
+                // A muted connection only reports hang-ups and errors.
+                close(client);
+            }
+        }
+    }
+}
+
+Processor::Stats Processor::stats() const {
+    return Stats{
+        connections_.load(std::memory_order_relaxed),
+        output_bytes_.load(std::memory_order_relaxed),
+        output_full_connections_.load(std::memory_order_relaxed),
+        memory_muted_connections_.load(std::memory_order_relaxed),
+        throttled_connections_.load(std::memory_order_relaxed),
+        blocked_sends_.load(std::memory_order_relaxed),
+    };
+}
+
+void Processor::register_accepted_clients() {
+    std::vector<int> accepted_sockets;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        accepted_sockets.swap(accepted_sockets_);
+    }
+    for (int client_socket : accepted_sockets) {
+        auto client = std::make_shared<Client>(client_socket, memory_pool_, metrics_, tracer_, capture_,
+                                               max_request_size_, output_high_water_);
+        add_to_epoll(epoll_fd_.get(), client_socket, EPOLLIN | EPOLLRDHUP);
+        client->set_epoll_events(EPOLLIN | EPOLLRDHUP);
+        clients_.emplace(client_socket, std::move(client));
+        connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Processor::write_ready_responses() {
+    std::vector<std::shared_ptr<Client>> ready_clients;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ready_clients.swap(ready_clients_);
+    }
+    for (const auto &client : ready_clients) {
+        // Skip clients that were closed while their requests were being handled.
+        auto iter = clients_.find(client->socket());
+        if (iter == clients_.end() || iter->second != client) {
+            continue;
+        }
+
+        std::size_t output_bytes = client->output_bytes();
+        bool output_full = client->output_full();
+        client->queue_completed_responses();
+        output_bytes_.fetch_add(client->output_bytes() - output_bytes, std::memory_order_relaxed);
+        if (!output_full && client->output_full()) {
+            output_full_connections_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!client->throttled() && client->throttled_until() > std::chrono::steady_clock::now()) {
+            client->set_throttled(true);
+            throttled_clients_.push_back(client);
+            throttled_connections_.fetch_add(1, std::memory_order_relaxed);
+        }
+        send_output(client);
+    }
+}
+
+void Processor::send_output(const std::shared_ptr<Client> &client) {
+    std::size_t output_bytes = client->output_bytes();
+    bool output_full = client->output_full();
+    bool open = client->send_output();
+    output_bytes_.fetch_sub(output_bytes - client->output_bytes(), std::memory_order_relaxed);
+    if (!open || client->finished()) {
+        close(client);
+        return;
+    }
+    if (client->output_pending()) {
+        blocked_sends_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (output_full && !client->output_full()) {
+        output_full_connections_.fetch_sub(1, std::memory_order_relaxed);
+        if (!client->waiting_for_memory() && !client->throttled()) {
+            // Frames that arrived while the connection was muted may already be buffered.
+            read_requests(client);
+            return;
+        }
+    }
+    update_events(client);
+}
+
+void Processor::read_requests(const std::shared_ptr<Client> &client) {
+    // Reads that were already reported when the client became throttled wait for it to end.
+    if (client->throttled()) {
+        update_events(client);
+        return;
+    }
+    std::vector<RequestFrame> frames;
+    bool open;
+    try {
+        open = client->receive_frames(frames);
+    } catch (const std::exception &) {
+        open = false;
+    }
+
+    for (auto &frame : frames) {
+        metrics_.record_bytes_received(sizeof(INT32) + frame.bytes.size());
+        handler_pool_.submit(std::make_unique<QueuedRequest>(QueuedRequest{
+            client, this, client->next_sequence(), std::move(frame.bytes), std::move(frame.memory),
+            std::move(frame.charge), {}, {}}), node_);
+    }
+    if (!open) {
+        close(client);
+        return;
+    }
+    if (client->waiting_for_memory()) {
+        muted_clients_.push_back(client);
+        memory_muted_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+    update_events(client);
+}
+
+void Processor::read_muted_clients() {
+    if (muted_clients_.empty()) {
+        return;
+    }
+    // Throttled connections stay muted and are retried once their throttle time has passed.
+    std::vector<std::shared_ptr<Client>> muted_clients;
+    std::erase_if(muted_clients_, [&](const std::shared_ptr<Client> &client) {
+        if (client->throttled()) {
+            return false;
+        }
+        muted_clients.push_back(client);
+        return true;
+    });
+    memory_muted_connections_.fetch_sub(muted_clients.size(), std::memory_order_relaxed);
+    for (const auto &client : muted_clients) {
+        read_requests(client);
+    }
+}
+
+int Processor::throttle_timeout() const {
+    if (throttled_clients_.empty()) {
+        return -1;
+    }
+    auto throttled_until = std::chrono::steady_clock::time_point::max();
+    for (const auto &client : throttled_clients_) {
+        throttled_until = std::min(throttled_until, client->throttled_until());
+    }
+    // Rounded up, so that the throttle time has passed when epoll_wait returns.
+    auto timeout = std::chrono::ceil<std::chrono::milliseconds>(throttled_until - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<std::chrono::milliseconds::rep>(timeout.count(), 0));
+}
+
+void Processor::unthrottle_clients() {
+    if (throttled_clients_.empty()) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<Client>> unthrottled_clients;
+    std::erase_if(throttled_clients_, [&](const std::shared_ptr<Client> &client) {
+        if (client->throttled_until() > now) {
+            return false;
+        }
+        unthrottled_clients.push_back(client);
+        return true;
+    });
+    throttled_connections_.fetch_sub(unthrottled_clients.size(), std::memory_order_relaxed);
+    bool memory_muted = false;
+    for (const auto &client : unthrottled_clients) {
+        client->set_throttled(false);
+        if (client->waiting_for_memory()) {
+            memory_muted = true;
+        } else if (!client->output_full()) {
+            // Frames that arrived before the connection was muted may already be buffered.
+            read_requests(client);
+            continue;
+        }
+        update_events(client);
+    }
+    // Memory may have been released while those connections were throttled.
+    if (memory_muted) {
+        read_muted_clients();
+    }
+}
+
+void Processor::update_events(const std::shared_ptr<Client> &client) {
+    // A connection is read unless its next request waits for memory, its responses pile up
+    // or its client is throttled, and is watched for writability while responses wait for the socket.
+    std::uint32_t events = 0;
+    if (!client->waiting_for_memory() && !client->output_full() && !client->throttled()) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (client->output_pending()) {
+        events |= EPOLLOUT;
+    }
+    if (events == client->epoll_events()) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = client->socket();
+    epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, client->socket(), &event);
+    client->set_epoll_events(events);
+}
+
+void Processor::close(const std::shared_ptr<Client> &client) {
+    // Requests still being handled keep the `Client` alive, so its socket can't be reused yet.
+    epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, client->socket(), nullptr);
+    shutdown(client->socket(), SHUT_RDWR);
+    clients_.erase(client->socket());
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+    output_bytes_.fetch_sub(client->output_bytes(), std::memory_order_relaxed);
+    if (client->output_full()) {
+        output_full_connections_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (std::erase(muted_clients_, client) > 0) {
+        memory_muted_connections_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (std::erase(throttled_clients_, client) > 0) {
+        throttled_connections_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+}
@@ -0,0 +1,141 @@
+#include "kafka/network/request_capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <utility>
+
+#include "kafka/utils.hpp"
+
+namespace kafka {
+
+// Bytes of a frame entry before the frame: direction, time, connection and size.
+static constexpr std::size_t entry_header_size = 1 + 8 + 4 + 4;
+
+template<typename IntType>
+static void append(BYTES &buffer, IntType n) {
+    n = to_network_byte_order(n);
+    auto bytes = reinterpret_cast<const unsigned char *>(&n);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(n));
+}
+
+template<typename IntType>
+static IntType load(const unsigned char *bytes) {
+    IntType n;
+    std::memcpy(&n, bytes, sizeof(n));
+    return to_host_byte_order(n);
+}
+
+RequestCapture::RequestCapture(const std::string &path, std::size_t max_bytes)
+    : max_bytes_(max_bytes), start_(std::chrono::steady_clock::now()) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw_system_error(path.c_str());
+    }
+    file_.emplace(fd);
+    buffer_.insert(buffer_.end(), std::begin(magic), std::end(magic));
+    append(buffer_, format_version);
+    file_bytes_ = buffer_.size();
+    writer_ = std::thread([this] { write_buffers(); });
+}
+
+RequestCapture::~RequestCapture() {
+    if (!writer_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+    }
+    buffer_ready_.notify_one();
+    writer_.join();
+    if (dropped_frames() > 0) {
+        std::cerr << std::format("Request capture dropped {} frames\n", dropped_frames());
+    }
+}
+
+void RequestCapture::record(CaptureDirection direction, std::uint32_t connection,
+                            std::chrono::steady_clock::time_point time, std::span<const unsigned char> frame) {
+    std::size_t entry_size = entry_header_size + frame.size();
+    bool wake_writer;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (buffer_.size() + entry_size > max_buffered_bytes ||
+            (max_bytes_ > 0 && file_bytes_ + entry_size > max_bytes_)) {
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        append(buffer_, static_cast<INT8>(direction));
+        append(buffer_, static_cast<INT64>(std::chrono::nanoseconds(time - start_).count()));
+        append(buffer_, connection);
+        append(buffer_, static_cast<UINT32>(frame.size()));
+        buffer_.insert(buffer_.end(), frame.begin(), frame.end());
+        file_bytes_ += entry_size;
+        wake_writer = buffer_.size() >= write_threshold && buffer_.size() - entry_size < write_threshold;
+    }
+    if (wake_writer) {
+        buffer_ready_.notify_one();
+    }
+}
+
+void RequestCapture::write_buffers() {
+    BYTES writing;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Frames are written at least every 100 ms, so that a capture is useful while it runs.
+        buffer_ready_.wait_for(lock, std::chrono::milliseconds(100),
+                               [this] { return stopping_ || buffer_.size() >= write_threshold; });
+        bool stopping = stopping_;
+        std::swap(writing, buffer_);
+        lock.unlock();
+        try {
+            if (!writing.empty()) {
+                file_->write(writing.data(), writing.size());
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Request capture failed: " << e.what() << '\n';
+        }
+        writing.clear();
+        lock.lock();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+CaptureReader::CaptureReader(const std::string &path) : file_(path, std::ios::binary) {
+    if (!file_) {
+        throw_runtime_error(std::format("cannot open {}", path).c_str());
+    }
+    char header[sizeof(RequestCapture::magic)];
+    INT16 version;
+    file_.read(header, sizeof(header));
+    file_.read(reinterpret_cast<char *>(&version), sizeof(version));
+    if (!file_ || !std::equal(std::begin(header), std::end(header), std::begin(RequestCapture::magic))) {
+        throw_runtime_error(std::format("{} is not a request capture", path).c_str());
+    }
+    if (to_host_byte_order(version) != RequestCapture::format_version) {
+        throw_runtime_error(std::format("{} has unsupported capture format version {}", path,
+                                        to_host_byte_order(version)).c_str());
+    }
+}
+
+std::optional<CapturedFrame> CaptureReader::next() {
+    unsigned char header[entry_header_size];
+    if (!file_.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        return std::nullopt;
+    }
+    CapturedFrame frame;
+    frame.direction = static_cast<CaptureDirection>(header[0]);
+    frame.time = std::chrono::nanoseconds(load<INT64>(header + 1));
+    frame.connection = load<UINT32>(header + 9);
+    frame.bytes.resize(load<UINT32>(header + 13));
+    if (!file_.read(reinterpret_cast<char *>(frame.bytes.data()), static_cast<std::streamsize>(frame.bytes.size()))) {
+        return std::nullopt;
+    }
+    return frame;
+}
+
+}
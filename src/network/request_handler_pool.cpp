@@ -0,0 +1,150 @@
+#include "kafka/network/request_handler_pool.hpp"
+#include "kafka/network/processor.hpp"
+
+#include <exception>
+#include <utility>
+
+namespace kafka {
+
+RequestHandlerPool::RequestHandlerPool(std::size_t num_threads, std::size_t queue_capacity, Handler handler,
+                                       const ThreadPlacement &placement)
+    : handler_(std::move(handler)), next_worker_(0), pending_(0), stopping_(false) {
+    std::size_t per_worker_capacity = (queue_capacity + num_threads - 1) / num_threads;
+    for (std::size_t i = 0; i < num_threads; i++) {
+        workers_.push_back(std::make_unique<Worker>(per_worker_capacity, placement.slot(i)));
+    }
+    for (std::size_t i = 0; i < num_threads; i++) {
+        Worker &worker = *workers_[i];
+        for (bool same_node : {true, false}) {
+            for (std::size_t j = 0; j < num_threads; j++) {
+                std::size_t other = (i + j) % num_threads;
+                if ((workers_[other]->slot.node == worker.slot.node) == same_node) {
+                    worker.take_order.push_back(other);
+                }
+            }
+        }
+    }
+    for (std::size_t i = 0; i < num_threads; i++) {
+        workers_[i]->thread = std::thread(&RequestHandlerPool::run, this, i);
+        pin_thread(workers_[i]->thread.native_handle(), workers_[i]->slot);
+    }
+}
+
+RequestHandlerPool::~RequestHandlerPool() {
+    stopping_.store(true);
+    pending_.fetch_add(1);
+    pending_.notify_all();
+    for (auto &worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void RequestHandlerPool::submit(std::unique_ptr<QueuedRequest> request, int node) {
+    request->enqueue_time = std::chrono::steady_clock::now();
+    push(Job{std::move(request), nullptr}, node);
+}
+
+void RequestHandlerPool::post(std::coroutine_handle<> coroutine) {
+    push(Job{nullptr, coroutine}, -1);
+}
+
+void RequestHandlerPool::push(Job job, int node) {
+    pending_.fetch_add(1);
+
+    // Spread jobs round-robin over the queues of the node, falling back to any queue with room.
+    std::size_t first = next_worker_.fetch_add(1, std::memory_order_relaxed);
+    for ( ; ; ) {
+        for (bool same_node : {true, false}) {
+            for (std::size_t i = 0; i < workers_.size(); i++) {
+                Worker &worker = *workers_[(first + i) % workers_.size()];
+                if ((node < 0 || worker.slot.node == node) == same_node && worker.queue.try_push(std::move(job))) {
+                    pending_.notify_one();
+                    return;
+                }
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+std::vector<RequestHandlerPool::QueueStats> RequestHandlerPool::queue_stats() const {
+    std::vector<QueueStats> stats;
+    for (const auto &worker : workers_) {
+        stats.push_back(QueueStats{
+            worker->queue.size(),
+            worker->dequeued.load(std::memory_order_relaxed),
+            worker->stolen.load(std::memory_order_relaxed),
+            worker->total_wait_ns.load(std::memory_order_relaxed),
+            worker->max_wait_ns.load(std::memory_order_relaxed),
+        });
+    }
+    return stats;
+}
+
+void RequestHandlerPool::run(std::size_t index) {
+    Job job;
+    for ( ; ; ) {
+        if (take(index, job)) {
+            pending_.fetch_sub(1);
+            if (job.request) {
+                handle(std::move(job.request));
+            } else {
+                job.coroutine.resume();
+            }
+            continue;
+        }
+        if (stopping_.load()) {
+            return;
+        }
+        if (pending_.load() == 0) {
+            pending_.wait(0);
+        } else {
+            // A request is being pushed or was just taken by another thread.
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool RequestHandlerPool::take(std::size_t index, Job &job) {
+    const auto &take_order = workers_[index]->take_order;
+    for (std::size_t i = 0; i < take_order.size(); i++) {
+        Worker &worker = *workers_[take_order[i]];
+        if (!worker.queue.try_pop(job)) {
+            continue;
+        }
+        if (!job.request) {
+            return true;
+        }
+
+        QueuedRequest *request = job.request.get();
+
+        request->dequeue_time = std::chrono::steady_clock::now();
+        auto wait = request->dequeue_time - request->enqueue_time;
+        auto wait_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count());
+        worker.dequeued.fetch_add(1, std::memory_order_relaxed);
+        if (i != 0) {
+            worker.stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+        worker.total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+        std::uint64_t max_wait_ns = worker.max_wait_ns.load(std::memory_order_relaxed);
+        while (wait_ns > max_wait_ns &&
+               !worker.max_wait_ns.compare_exchange_weak(max_wait_ns, wait_ns, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+    return false;
+}
+
+DetachedTask RequestHandlerPool::handle(std::unique_ptr<QueuedRequest> request) {
+    ResponseFrame response;
+    bool succeeded = true;
+    try {
+        response = co_await handler_(*request);
+    } catch (const std::exception &) {
+        succeeded = false;
+    }
+    request->client->complete(request->sequence, std::move(response), succeeded);
+    request->processor->wakeup(std::move(request->client));
+}
+
+}
@@ -5,22 +5,54 @@
 #include "kafka/message/fetch.hpp"
 #include "kafka/message/headers.hpp"
 #include "kafka/message/messages.hpp"
+#include "kafka/message/metadata.hpp"
 #include "kafka/metadata/cluster_metadata.hpp"
+#include "kafka/metadata/metadata_fragments.hpp"
+#include "kafka/metrics/memory_accounting.hpp"
+#include "kafka/metrics/metrics_server.hpp"
+#include "kafka/metrics/perf_profile.hpp"
+#include "kafka/metrics/request_metrics.hpp"
+#include "kafka/metrics/request_tracer.hpp"
 #include "kafka/network/client.hpp"
+#include "kafka/network/client_quota_manager.hpp"
+#include "kafka/network/cpu_topology.hpp"
+#include "kafka/network/delay_queue.hpp"
+#include "kafka/network/processor.hpp"
+#include "kafka/network/request_handler_pool.hpp"
+#include "kafka/network/task.hpp"
 #include "kafka/protocol/constants.hpp"
 #include "kafka/protocol/types.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+#include "kafka/storage/log_recovery.hpp"
+#include "kafka/storage/segment_reader.hpp"
 #include "kafka/utils.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <cstring>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <iterator>
 #include <memory>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <sys/socket.h>
-#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace kafka {
 
-Server::Server() {
+Server::Server(ServerConfig config) : config_(std::move(config)) {
     server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket_ < 0) {
         throw_system_error("socket");
@@ -41,138 +73,538 @@ Server::Server() {
     if (bind(server_socket_, reinterpret_cast<sockaddr *>(&server_addr), sizeof(server_addr)) < 0) {
         throw_system_error("bind");
     }
-
-    const int backlog = 5;
-    if (listen(server_socket_, backlog) < 0) {
-        throw_system_error("listen");
-    }
 }
 
+// What handlers need in order to wait without holding a handler thread, and the time the request
+// spent waiting.
+struct HandlerContext {
+    const ServerConfig &config;
+    DelayQueue &delay_queue;
+    // Resumes handlers once they are done waiting.
+    Executor &handlers;
+    std::chrono::steady_clock::duration delayed{};
+};
+
 using FetchTopic = FetchRequest::FetchTopic;
 using FetchableTopicResponse = FetchResponse::FetchableTopicResponse;
 using PartitionData = FetchResponse::PartitionData;
 
-static PartitionData make_partition_data(const std::string &topic_name, INT32 partition_index) {
+// Returns the bytes of record batches as they are sent, with their offset and length.
+static std::size_t record_batches_size(const std::vector<RecordBatch> &record_batches) {
+    std::size_t size = 0;
+    for (const auto &record_batch : record_batches) {
+        size += sizeof(INT64) + sizeof(INT32) + static_cast<std::size_t>(record_batch.batch_length());
+    }
+    return size;
+}
+
+static PartitionData make_partition_data(std::string_view topic_name, INT32 partition_index) {
     PartitionData partition_data;
     partition_data.partition_index() = partition_index;
+    auto record_batches = read_record_batches(topic_name, partition_index);
+    if (!record_batches) {
+        partition_data.error_code() = record_batches.error();
+        return partition_data;
+    }
     partition_data.error_code() = ErrorCode::NONE;
-    partition_data.records() = read_record_batches(topic_name, partition_index);
+    partition_data.records_memory() =
+        MemoryCharge(MemoryCategory::RECORD_BATCHES, record_batches_size(*record_batches));
+    partition_data.records() = std::move(*record_batches);
     return partition_data;
 }
 
-static FetchableTopicResponse make_fetchable_topic_response(const FetchTopic &fetch_topic) {
+static FetchableTopicResponse make_fetchable_topic_response(const MetadataSnapshot &metadata,
+                                                            const FetchTopic &fetch_topic) {
     FetchableTopicResponse res;
-    UUID topic_id = fetch_topic.topic_id();
+    UUID topic_id = fetch_topic.topic_id;
     res.topic_id() = topic_id;
 
-    const auto &cluster_metadata = ClusterMetadata::get_instance();
-    try {
-        auto topic_name = cluster_metadata.get_topic_name(topic_id);
-        for (const auto &fetch_partition : fetch_topic.partitions()) {
-            INT32 partition_index = fetch_partition.partition();
-            res.partitions().push_back(make_partition_data(topic_name, partition_index));
-        }
-    } catch (...) {
+    const auto *topic = metadata.find_topic(topic_id);
+    if (!topic) {
         PartitionData partition_data;
         partition_data.partition_index() = 0;
         partition_data.error_code() = ErrorCode::UNKNOWN_TOPIC_ID;
         res.partitions().push_back(std::move(partition_data));
+        return res;
+    }
+
+    auto topic_name = metadata.topic_name(*topic);
+    for (const auto &fetch_partition : fetch_topic.partitions) {
+        INT32 partition_index = fetch_partition.partition;
+        res.partitions().push_back(make_partition_data(topic_name, partition_index));
     }
 
     return res;
 }
 
-static std::unique_ptr<FetchResponse> handle_fetch(const RequestMessage &request_message) {
-    const FetchRequest *request = request_message.request<FetchRequest>();
+// Returns whether a Fetch response may be sent before `max_wait_ms` has passed: when it carries
+// `min_bytes` of records or an error.
+static bool fetch_satisfied(FetchResponse &response, INT32 min_bytes) {
+    std::size_t bytes = 0;
+    for (auto &topic_response : response.responses()) {
+        for (auto &partition_data : topic_response.partitions()) {
+            if (partition_data.error_code() != ErrorCode::NONE) {
+                return true;
+            }
+            bytes += record_batches_size(partition_data.records());
+        }
+    }
+    return bytes >= static_cast<std::size_t>(std::max(min_bytes, 0));
+}
+
+// Reads the partitions until the response is satisfied or `max_wait_ms` has passed. Nothing
+// signals new records, so a waiting Fetch is suspended in the delay queue and reads its
+// partitions again every `fetch.wait.recheck.ms`.
+static Task<std::unique_ptr<AbstractResponse>> handle_fetch(HandlerContext &context, const FetchRequest &request) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(request.max_wait_ms, 0));
+    for ( ; ; ) {
+        FetchResponse response;
+        response.error_code() = ErrorCode::NONE;
+        response.throttle_time_ms() = 0;
+        response.session_id() = 0;
+        auto metadata = ClusterMetadata::get_instance().snapshot();
+        for (const auto &fetch_topic : request.topics) {
+            response.responses().push_back(make_fetchable_topic_response(*metadata, fetch_topic));
+        }
 
-    FetchResponse response;
-    response.error_code() = ErrorCode::NONE;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline || fetch_satisfied(response, request.min_bytes)) {
+            co_return std::make_unique<FetchResponse>(std::move(response));
+        }
+        auto recheck = now + std::chrono::milliseconds(context.config.fetch_wait_recheck_ms);
+        co_await context.delay_queue.wait_until(std::min(deadline, recheck), context.handlers);
+        context.delayed += std::chrono::steady_clock::now() - now;
+    }
+}
+
+static std::unique_ptr<MetadataResponse> handle_metadata(const ServerConfig &config, INT16 version,
+                                                        const MetadataRequest &request) {
+    MetadataResponse response(version);
     response.throttle_time_ms() = 0;
-    response.session_id() = 0;
-    for (const auto &fetch_topic : request->topics()) {
-        response.responses().push_back(make_fetchable_topic_response(fetch_topic));
+    response.brokers().emplace_back(config.node_id, config.advertised_host, config.advertised_port);
+    response.cluster_id() = ClusterMetadata::get_instance().cluster_id();
+    response.controller_id() = config.node_id;
+
+    // Known topics are copied from entries encoded once per snapshot version.
+    auto fragments = MetadataTopicFragments::get(ClusterMetadata::get_instance().snapshot(), config.node_id);
+    const MetadataSnapshot &metadata = fragments->snapshot();
+    // A null array asks for every topic.
+    if (!request.topics) {
+        response.add_encoded_topics(fragments->all_topics(version), metadata.topics().size(), fragments);
+        return std::make_unique<MetadataResponse>(std::move(response));
+    }
+    for (const auto &request_topic : *request.topics) {
+        const auto &name = request_topic.name;
+        const auto *topic = name ? metadata.find_topic(*name) : metadata.find_topic(request_topic.topic_id);
+        if (topic) {
+            response.add_encoded_topics(fragments->topic(*topic, version), 1, fragments);
+        } else if (name) {
+            response.add_topic(ErrorCode::UNKNOWN_TOPIC_OR_PARTITION, std::string_view(*name), UUID{},
+                               std::span<const INT32>(), config.node_id);
+        } else {
+            response.add_topic(ErrorCode::UNKNOWN_TOPIC_ID, std::nullopt, request_topic.topic_id,
+                               std::span<const INT32>(), config.node_id);
+        }
     }
 
-    return std::make_unique<FetchResponse>(std::move(response));
+    return std::make_unique<MetadataResponse>(std::move(response));
 }
 
-static std::unique_ptr<ApiVersionsResponse> handle_api_versions(const RequestMessage &request_message) {
-    const ApiVersionsRequest *request = request_message.request<ApiVersionsRequest>();
-
-    ApiVersionsResponse response;
-    if (request_message.header().request_api_version() != 4) {
-        response.error_code() = ErrorCode::UNSUPPORTED_VERSION;
-    } else {
-        response.error_code() = ErrorCode::NONE;
-        response.api_keys().emplace_back(ApiKey::FETCH, 0, 16);
-        response.api_keys().emplace_back(ApiKey::API_VERSIONS, 0, 4);
-        response.api_keys().emplace_back(ApiKey::DESCRIBE_TOPIC_PARTITIONS, 0, 0);
+static std::unique_ptr<AbstractResponse> handle_api_versions(const RequestHeader &header, const ApiVersionsRequest &) {
+    // The flexible versions share one successful response, which never changes.
+    constexpr ApiVersionRange api_versions = SupportedApis::versions[*find_api(ApiKey::API_VERSIONS)];
+    INT16 version = header.request_api_version();
+    if (version >= 3 && version <= api_versions.max_version) {
+        return std::make_unique<EncodedResponse>(ApiKey::API_VERSIONS, api_versions_response_body);
     }
-    response.throttle_time_ms() = 0;
 
-    return std::make_unique<ApiVersionsResponse>(std::move(response));
+    // Like Kafka, an unsupported version is answered in version 0, which every client can read.
+    bool supported = version >= api_versions.min_version && version <= api_versions.max_version;
+    auto response = std::make_unique<ApiVersionsResponse>(supported ? version : 0);
+    auto &data = response->data();
+    if (!supported) {
+        data.error_code = std::to_underlying(ErrorCode::UNSUPPORTED_VERSION);
+        return response;
+    }
+    for (const auto &range : SupportedApis::versions) {
+        auto &api = data.api_keys.emplace_back();
+        api.api_key = std::to_underlying(range.api_key);
+        api.min_version = range.min_version;
+        api.max_version = range.max_version;
+    }
+    return response;
 }
 
-using TopicRequest = DescribeTopicPartitionsRequest::TopicRequest;
 using ResponseTopic = DescribeTopicPartitionsResponse::ResponseTopic;
 
-static ResponseTopic make_response_topic(const TopicRequest &topic_request) {
-    ResponseTopic response_topic;
-    response_topic.name() = topic_request.name();
+static std::unique_ptr<DescribeTopicPartitionsResponse> handle_describe_topic_partitions(
+        const ServerConfig &config, const DescribeTopicPartitionsRequest &request) {
+    auto response = std::make_unique<DescribeTopicPartitionsResponse>();
+    auto &data = response->data();
+    auto metadata = ClusterMetadata::get_instance().snapshot();
 
-    const ClusterMetadata &cluster_metadata = ClusterMetadata::get_instance();
-    UUID topic_id;
-    try {
-        topic_id = cluster_metadata.get_topic_id(topic_request.name());
-    } catch (...) {
-        response_topic.error_code() = ErrorCode::UNKNOWN_TOPIC_OR_PARTITION;
-        return response_topic;
-    }
-    response_topic.error_code() = ErrorCode::NONE;
-    response_topic.topic_id() = topic_id;
-    for (INT32 partition_id : cluster_metadata.get_partition_ids(topic_id)) {
-        response_topic.partitions().emplace_back(ErrorCode::NONE, partition_id);
+    // Topics are described in name order, starting from the cursor, until the partition limit
+    // is reached. The response then carries a cursor to the first partition left out.
+    const auto &cursor = request.cursor;
+    std::string_view first_name = cursor ? std::string_view(cursor->topic_name) : std::string_view();
+    auto limit = static_cast<std::size_t>(std::max(request.response_partition_limit, 1));
+    std::size_t remaining = std::min(limit, config.max_request_partition_size_limit);
+    auto describe_topic = [&](std::string_view name, const MetadataSnapshot::Topic *topic) {
+        if (remaining == 0) {
+            data.next_cursor.emplace().topic_name = name;
+            return false;
+        }
+        ResponseTopic &response_topic = data.topics.emplace_back();
+        response_topic.name.emplace(name);
+        if (!topic) {
+            response_topic.error_code = std::to_underlying(ErrorCode::UNKNOWN_TOPIC_OR_PARTITION);
+            return true;
+        }
+        response_topic.topic_id = topic->topic_id;
+        response_topic.is_internal = name.starts_with("__");
+
+        // Partition IDs are sorted, so resuming inside a topic is a binary search.
+        auto partition_ids = metadata->partition_ids(*topic);
+        auto first = partition_ids.begin();
+        if (cursor && name == cursor->topic_name) {
+            first = std::lower_bound(partition_ids.begin(), partition_ids.end(), cursor->partition_index);
+        }
+        auto last = first + std::min<std::size_t>(remaining, partition_ids.end() - first);
+        response_topic.partitions.reserve(last - first);
+        for (auto iter = first; iter != last; ++iter) {
+            response_topic.partitions.push_back(
+                DescribeTopicPartitionsResponse::leader_only_partition(*iter, config.node_id));
+        }
+        remaining -= last - first;
+        if (last != partition_ids.end()) {
+            auto &next_cursor = data.next_cursor.emplace();
+            next_cursor.topic_name = name;
+            next_cursor.partition_index = *last;
+        }
+        return last == partition_ids.end();
+    };
+
+    if (request.topics.empty()) {
+        // No topics means every topic.
+        auto topic_order = metadata->topics_by_name();
+        auto topic_at = [&](std::uint32_t position) -> const MetadataSnapshot::Topic & {
+            return metadata->topics()[position];
+        };
+        auto iter = std::partition_point(topic_order.begin(), topic_order.end(), [&](std::uint32_t position) {
+            return metadata->topic_name(topic_at(position)) < first_name;
+        });
+        for ( ; iter != topic_order.end(); ++iter) {
+            const auto &topic = topic_at(*iter);
+            if (!describe_topic(metadata->topic_name(topic), &topic)) {
+                break;
+            }
+        }
+    } else {
+        std::vector<std::string_view> names;
+        names.reserve(request.topics.size());
+        for (const auto &topic_request : request.topics) {
+            names.push_back(topic_request.name);
+        }
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        for (auto iter = std::lower_bound(names.begin(), names.end(), first_name); iter != names.end(); ++iter) {
+            if (!describe_topic(*iter, metadata->find_topic(*iter))) {
+                break;
+            }
+        }
     }
 
-    return response_topic;
+    return response;
 }
 
-static std::unique_ptr<DescribeTopicPartitionsResponse> handle_describe_topic_partitions(const RequestMessage &request_message) {
-    const DescribeTopicPartitionsRequest *request = request_message.request<DescribeTopicPartitionsRequest>();
+// Calls the handler of a request type. `std::visit` turns this into a jump table over the
+// types of `SupportedApis`, and an API without a handler does not compile.
+template<typename... Handlers>
+struct RequestHandlers : Handlers... {
+    using Handlers::operator()...;
+};
 
-    DescribeTopicPartitionsResponse response;
-    response.throttle_time_ms() = 0;
-    for (const auto &topic_request : request->topics()) {
-        response.topics().push_back(make_response_topic(topic_request));
-    }
+// Counts the topics and partitions a request names, for its trace.
+static void count_topics(const RequestVariant &request, RequestTrace &trace) {
+    std::visit(RequestHandlers{
+        [&](const FetchRequest &request) {
+            trace.topic_count = static_cast<std::uint32_t>(request.topics.size());
+            for (const auto &topic : request.topics) {
+                trace.partition_count += static_cast<std::uint32_t>(topic.partitions.size());
+            }
+        },
+        [&](const MetadataRequest &request) {
+            trace.topic_count = request.topics ? static_cast<std::uint32_t>(request.topics->size()) : 0;
+        },
+        [&](const ApiVersionsRequest &) {},
+        [&](const DescribeTopicPartitionsRequest &request) {
+            trace.topic_count = static_cast<std::uint32_t>(request.topics.size());
+        },
+    }, request);
+}
 
-    return std::make_unique<DescribeTopicPartitionsResponse>(std::move(response));
+// Only Fetch may wait; the other handlers return a task that is already done, which costs no
+// coroutine frame.
+static Task<ResponseMessage> handle_request(HandlerContext &context, const RequestMessage &request_message) {
+    const ServerConfig &config = context.config;
+    const RequestHeader &header = request_message.header();
+    ResponseHeader response_header(header.correlation_id());
+    std::unique_ptr<AbstractResponse> response = co_await std::visit(RequestHandlers{
+        [&](const FetchRequest &request) -> Task<std::unique_ptr<AbstractResponse>> {
+            return handle_fetch(context, request);
+        },
+        [&](const MetadataRequest &request) -> Task<std::unique_ptr<AbstractResponse>> {
+            return handle_metadata(config, header.request_api_version(), request);
+        },
+        [&](const ApiVersionsRequest &request) -> Task<std::unique_ptr<AbstractResponse>> {
+            return handle_api_versions(header, request);
+        },
+        [&](const DescribeTopicPartitionsRequest &request) -> Task<std::unique_ptr<AbstractResponse>> {
+            return handle_describe_topic_partitions(config, request);
+        },
+    }, request_message.request());
+    co_return ResponseMessage(std::move(response_header), std::move(response));
 }
 
-static void serve_client(Client client) {
-    for ( ; ; ) {
-        auto request_message = client.read_request();
+// Decodes a request frame, handles the request and encodes its response with size prefix,
+// timing every stage and, when profiling, counting its events. The response bytes and the time
+// spent, less any time the request waited, count against the quota of the client; a client
+// above it is told in the response how long it is throttled for.
+static Task<ResponseFrame> handle_frame(const ServerConfig &config, ClientQuotaManager &quota_manager,
+                                        RequestMetrics &metrics, PerfProfile &perf_profile, DelayQueue &delay_queue,
+                                        Executor &handlers, QueuedRequest &queued_request) {
+    HandlerContext context{config, delay_queue, handlers};
+    ResponseFrame response_frame;
+    RequestTrace &trace = response_frame.trace;
+    RequestTimes &times = trace.times;
+    times.enqueued = queued_request.enqueue_time;
+    times.dequeued = queued_request.dequeue_time;
+    // Counter readings at the start of decoding and at the end of every stage after it.
+    std::array<PerfCounts, 4> counts;
+    auto count_events = [&](std::size_t boundary) {
+        if (perf_profile.enabled()) {
+            counts[boundary] = perf_profile.read();
+        }
+    };
+    count_events(0);
+    RequestMessage request_message;
+    request_message.read(std::move(queued_request.frame));
+    times.decoded = std::chrono::steady_clock::now();
+    count_events(1);
+    ResponseMessage response = co_await handle_request(context, request_message);
+    times.handled = std::chrono::steady_clock::now();
+    count_events(2);
+    WritableBuffer wb;
+    response.write(wb);
+    times.encoded = std::chrono::steady_clock::now();
+    count_events(3);
 
-        ResponseHeader response_header(request_message.header().correlation_id());
-        std::unique_ptr<AbstractResponse> response;
-        switch (request_message.header().request_api_key()) {
-            case ApiKey::FETCH:
-                response = handle_fetch(request_message);
-                break;
-            case ApiKey::API_VERSIONS:
-                response = handle_api_versions(request_message);
-                break;
-            case ApiKey::DESCRIBE_TOPIC_PARTITIONS:
-                response = handle_describe_topic_partitions(request_message);
-                break;
+    const RequestHeader &header = request_message.header();
+    trace.api_key = header.request_api_key();
+    trace.api_version = header.request_api_version();
+    trace.correlation_id = header.correlation_id();
+    trace.set_client_id(header.client_id());
+    count_topics(request_message.request(), trace);
+    ErrorCounts error_counts{};
+    response.add_error_counts(error_counts);
+    metrics.record_request(trace.api_key, times, error_counts);
+    if (perf_profile.enabled()) {
+        perf_profile.record(trace.api_key, RequestStage::DECODE, counts[0], counts[1]);
+        // A request that waited may have been resumed on another thread, with other counters.
+        if (context.delayed == std::chrono::steady_clock::duration::zero()) {
+            perf_profile.record(trace.api_key, RequestStage::HANDLE, counts[1], counts[2]);
         }
+        perf_profile.record(trace.api_key, RequestStage::ENCODE, counts[2], counts[3]);
+    }
 
-        client.write_response(ResponseMessage(std::move(response_header), std::move(response)));
+    // ApiVersions is never throttled, so that clients can always find the supported versions.
+    if (quota_manager.enabled() && trace.api_key != ApiKey::API_VERSIONS) {
+        response_frame.throttle_time = quota_manager.record(anonymous_user, header.client_id(), wb.buffer().size(),
+                                                            times.encoded - times.dequeued - context.delayed);
+    }
+    if (response_frame.throttle_time.count() == 0) {
+        response_frame.bytes = wb.release();
+        co_return response_frame;
+    }
+    response.set_throttle_time_ms(static_cast<INT32>(response_frame.throttle_time.count()));
+    WritableBuffer throttled;
+    response.write(throttled);
+    response_frame.bytes = throttled.release();
+    co_return response_frame;
+}
+
+void Server::write_metrics(std::string &out) const {
+    request_metrics_->write_prometheus(out);
+    MemoryAccounting::get_instance().write_prometheus(out);
+    SegmentReader::get_instance().write_prometheus(out);
+    if (perf_profile_->enabled()) {
+        perf_profile_->write_prometheus(out);
+    }
+    Processor::Stats totals{};
+    for (const auto &processor : processors_) {
+        Processor::Stats stats = processor->stats();
+        totals.connections += stats.connections;
+        totals.output_bytes += stats.output_bytes;
+        totals.output_full_connections += stats.output_full_connections;
+        totals.memory_muted_connections += stats.memory_muted_connections;
+        totals.throttled_connections += stats.throttled_connections;
+        totals.blocked_sends += stats.blocked_sends;
+    }
+    auto queues = handler_pool_->queue_stats();
+    std::size_t queued_requests = 0;
+    for (const auto &queue : queues) {
+        queued_requests += queue.depth;
+    }
+    MemoryPool::Stats memory = memory_pool_->stats();
+    MetadataApplyStats metadata = ClusterMetadata::get_instance().apply_stats();
+    auto append = std::back_inserter(out);
+    auto gauge = [&](std::string_view name, std::string_view help, auto value) {
+        std::format_to(append, "# HELP {0} {1}\n# TYPE {0} gauge\n{0} {2}\n", name, help, value);
+    };
+    auto counter = [&](std::string_view name, std::string_view help, auto value) {
+        std::format_to(append, "# HELP {0} {1}\n# TYPE {0} counter\n{0} {2}\n", name, help, value);
+    };
+    // Writes one metric per handler queue, labelled with the queue's index.
+    auto per_queue = [&](std::string_view name, std::string_view type, std::string_view help, auto value) {
+        std::format_to(append, "# HELP {0} {1}\n# TYPE {0} {2}\n", name, help, type);
+        for (std::size_t i = 0; i < queues.size(); i++) {
+            std::format_to(append, "{}{{queue=\"{}\"}} {}\n", name, i, value(queues[i]));
+        }
+    };
+    gauge("kafka_network_connections", "Open client connections.", totals.connections);
+    gauge("kafka_network_output_queue_bytes", "Response bytes waiting for the sockets.", totals.output_bytes);
+    gauge("kafka_network_output_full_connections", "Connections muted by their queued responses.",
+          totals.output_full_connections);
+    gauge("kafka_network_memory_muted_connections", "Connections muted until pool memory is released.",
+          totals.memory_muted_connections);
+    gauge("kafka_network_throttled_connections", "Connections muted by client quotas.", totals.throttled_connections);
+    counter("kafka_network_blocked_sends_total", "Sends that left responses queued because the socket was full.",
+            totals.blocked_sends);
+    gauge("kafka_request_queue_size", "Requests waiting for a handler thread.", queued_requests);
+    using QueueStats = RequestHandlerPool::QueueStats;
+    per_queue("kafka_request_queue_depth", "gauge", "Requests waiting in each handler queue.",
+              [](const QueueStats &queue) { return queue.depth; });
+    per_queue("kafka_request_queue_dequeued_total", "counter", "Requests taken from each handler queue.",
+              [](const QueueStats &queue) { return queue.dequeued; });
+    per_queue("kafka_request_queue_stolen_total", "counter",
+              "Requests taken from each handler queue by the threads of other queues.",
+              [](const QueueStats &queue) { return queue.stolen; });
+    per_queue("kafka_request_queue_wait_seconds_total", "counter", "Time requests waited in each handler queue.",
+              [](const QueueStats &queue) { return queue.total_wait_ns / 1e9; });
+    per_queue("kafka_request_queue_max_wait_seconds", "gauge",
+              "Longest a request has waited in each handler queue since startup.",
+              [](const QueueStats &queue) { return queue.max_wait_ns / 1e9; });
+    gauge("kafka_request_delayed", "Requests waiting in the delay queue, such as Fetches waiting for records.",
+          delay_queue_->size());
+    gauge("kafka_request_memory_used_bytes", "Memory of the requests received but not handled yet.", memory.used);
+    gauge("kafka_request_memory_peak_bytes", "Most memory ever held by queued requests.", memory.peak_used);
+    gauge("kafka_request_memory_capacity_bytes", "Memory queued requests may hold.", memory.capacity);
+    gauge("kafka_request_memory_waiting_connections", "Connections waiting for request memory.", memory.waiting);
+    counter("kafka_request_memory_waits_total", "Waits for request memory that ended with an allocation.",
+            memory.waits);
+    counter("kafka_request_memory_wait_seconds_total", "Time connections waited for request memory.",
+            memory.total_wait_ns / 1e9);
+    gauge("kafka_request_memory_max_wait_seconds", "Longest a connection has waited for request memory since startup.",
+          memory.max_wait_ns / 1e9);
+    gauge("kafka_metadata_next_offset", "Offset after the last metadata record applied.", metadata.next_offset);
+    gauge("kafka_metadata_records_applied", "Metadata records applied since startup.", metadata.records_applied);
+    gauge("kafka_metadata_records_skipped", "Metadata records skipped because they could not be decoded.",
+          metadata.records_skipped);
+    gauge("kafka_metadata_records_per_second", "Metadata records applied per second over the last window.",
+          metadata.records_per_second);
+    gauge("kafka_metadata_apply_lag_ms", "Milliseconds since the newest applied metadata record was appended.",
+          metadata.apply_lag_ms);
+    if (request_capture_->enabled()) {
+        gauge("kafka_request_capture_dropped_frames", "Frames the traffic capture dropped.",
+              request_capture_->dropped_frames());
     }
 }
 
 void Server::start() {
-    for ( ; ; ) {
+    // A client may disconnect before its responses are written.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Clients are only accepted once the logs are consistent and the metadata is loaded.
+    RecoveryStats recovery = recover_logs(default_log_dir, config_.num_recovery_threads,
+                                          config_.log_recovery_truncate_enable);
+    double seconds = std::max(recovery.elapsed.count(), std::chrono::milliseconds::rep(1)) / 1000.0;
+    std::clog << std::format("Recovered {} partitions ({} segments, {:.1f} MiB, {} batches) in {} ms: "
+                             "{:.1f} MiB/s, {} bytes truncated, {} bytes damaged, {} indexes rebuilt, "
+                             "{} partitions skipped\n",
+                             recovery.partitions, recovery.segments_scanned, recovery.bytes_scanned / 1048576.0,
+                             recovery.batches_validated, recovery.elapsed.count(),
+                             recovery.bytes_scanned / 1048576.0 / seconds, recovery.bytes_truncated,
+                             recovery.bytes_damaged, recovery.indexes_rebuilt, recovery.partitions_failed);
+    ClusterMetadata::get_instance();
+    SegmentReader::get_instance().set_cold_read_drop_bytes(config_.log_cold_read_drop_bytes);
+
+    CpuTopology topology = CpuTopology::detect();
+    ThreadPlacement acceptor_placement(topology, config_.cpu_affinity_acceptor);
+    ThreadPlacement network_placement(topology, config_.cpu_affinity_network);
+    ThreadPlacement handler_placement(topology, config_.cpu_affinity_handler);
+    std::clog << std::format("CPU topology: {}\n"
+                             "Thread placement: acceptor {}; network {}; handler {}\n",
+                             topology.describe(), acceptor_placement.describe(1),
+                             network_placement.describe(config_.num_network_threads),
+                             handler_placement.describe(config_.num_io_threads));
+
+    memory_pool_ = std::make_unique<MemoryPool>(config_.queued_max_request_bytes);
+    quota_manager_ = std::make_unique<ClientQuotaManager>(config_);
+    request_metrics_ = std::make_unique<RequestMetrics>();
+    request_tracer_ = std::make_unique<RequestTracer>(config_.request_trace_buffer_size,
+                                                      std::chrono::milliseconds(config_.slow_request_threshold_ms));
+    request_capture_ = config_.request_capture_file.empty()
+                           ? std::make_unique<RequestCapture>()
+                           : std::make_unique<RequestCapture>(config_.request_capture_file,
+                                                              config_.request_capture_max_bytes);
+    perf_profile_ = std::make_unique<PerfProfile>(config_.perf_counters_enable);
+    delay_queue_ = std::make_unique<DelayQueue>();
+    // The handler is a coroutine; the pool keeps it, and so its captures, alive while it runs.
+    handler_pool_ = std::make_unique<RequestHandlerPool>(
+        config_.num_io_threads, config_.queued_max_requests, [this](QueuedRequest &request) -> Task<ResponseFrame> {
+            try {
+                co_return co_await handle_frame(config_, *quota_manager_, *request_metrics_, *perf_profile_,
+                                                *delay_queue_, *handler_pool_, request);
+            } catch (const std::exception &) {
+                request_metrics_->record_failed_request();
+                throw;
+            }
+        }, handler_placement);
+    for (std::size_t i = 0; i < config_.num_network_threads; i++) {
+        processors_.push_back(
+            std::make_unique<Processor>(*handler_pool_, *memory_pool_, *request_metrics_, *request_tracer_,
+                                        *request_capture_, config_.socket_request_max_bytes,
+                                        config_.output_queue_high_water_bytes, network_placement.slot(i)));
+    }
+    memory_pool_->set_release_listener([this] {
+        for (auto &processor : processors_) {
+            processor->memory_released();
+        }
+    });
+
+    const int backlog = 5;
+    if (listen(server_socket_, backlog) < 0) {
+        throw_system_error("listen");
+    }
+    if (config_.metrics_port != 0) {
+        std::vector<MetricsServer::Page> pages;
+        pages.push_back({"/metrics", "text/plain; version=0.0.4; charset=utf-8", [this] {
+            std::string out;
+            write_metrics(out);
+            return out;
+        }});
+        pages.push_back({"/trace", "application/json", [this] {
+            std::string out;
+            request_tracer_->write_chrome_trace(out);
+            return out;
+        }});
+        metrics_server_ = std::make_unique<MetricsServer>(config_.metrics_port, std::move(pages));
+        std::clog << std::format("Serving metrics on http://127.0.0.1:{}/metrics\n", config_.metrics_port);
+    }
+    std::clog << "Ready to accept connections on port 9092\n";
+    pin_thread(pthread_self(), acceptor_placement.slot(0));
+
+    for (std::size_t next_processor = 0; ; next_processor++) {
         int client_socket = accept(server_socket_, nullptr, nullptr);
         if (client_socket < 0) {
             if (errno == ECONNABORTED || errno == EINTR) {
@@ -180,10 +612,12 @@ void Server::start() {
             }
             throw_system_error("accept");
         }
+        // Responses are written whole, so Nagle's algorithm would only hold a response back
+        // until the client acknowledges the one before it.
+        const int no_delay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
 
-        Client client(client_socket);
-        std::thread t(serve_client, std::move(client));
-        t.detach();
+        processors_[next_processor % processors_.size()]->accept(client_socket);
     }
 }
 
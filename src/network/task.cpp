@@ -0,0 +1,95 @@
+#include "kafka/network/task.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <new>
+
+namespace kafka {
+
+namespace {
+
+constexpr std::size_t size_class_count =
+    std::countr_zero(CoroutineFrameAllocator::max_frame_size / CoroutineFrameAllocator::min_frame_size) + 1;
+
+// Returns the size class of a frame, `size_class_count` for frames too large to keep.
+std::size_t size_class(std::size_t size) {
+    if (size > CoroutineFrameAllocator::max_frame_size) {
+        return size_class_count;
+    }
+    size = std::max(size, CoroutineFrameAllocator::min_frame_size);
+    return std::countr_zero(std::bit_ceil(size) / CoroutineFrameAllocator::min_frame_size);
+}
+
+// A free frame, linked through its own memory.
+struct FreeFrame {
+    FreeFrame *next;
+};
+
+// The free frames of one thread per size class.
+class FreeLists {
+public:
+    ~FreeLists() {
+        for (std::size_t index = 0; index < size_class_count; index++) {
+            while (FreeFrame *frame = lists_[index].head) {
+                lists_[index].head = frame->next;
+                ::operator delete(frame);
+            }
+        }
+    }
+
+    void *pop(std::size_t index) {
+        List &list = lists_[index];
+        FreeFrame *frame = list.head;
+        if (!frame) {
+            return ::operator new(CoroutineFrameAllocator::min_frame_size << index);
+        }
+        list.head = frame->next;
+        list.count--;
+        return frame;
+    }
+
+    void push(std::size_t index, void *memory) {
+        List &list = lists_[index];
+        if (list.count == CoroutineFrameAllocator::max_free_frames) {
+            ::operator delete(memory);
+            return;
+        }
+        list.head = new (memory) FreeFrame{list.head};
+        list.count++;
+    }
+
+private:
+    struct List {
+        FreeFrame *head = nullptr;
+        std::size_t count = 0;
+    };
+
+    std::array<List, size_class_count> lists_;
+};
+
+FreeLists &local_free_lists() {
+    thread_local FreeLists free_lists;
+    return free_lists;
+}
+
+}
+
+void *CoroutineFrameAllocator::allocate(std::size_t size) {
+    std::size_t index = size_class(size);
+    if (index == size_class_count) {
+        return ::operator new(size);
+    }
+    return local_free_lists().pop(index);
+}
+
+void CoroutineFrameAllocator::deallocate(void *frame, std::size_t size) noexcept {
+    std::size_t index = size_class(size);
+    if (index == size_class_count) {
+        ::operator delete(frame);
+        return;
+    }
+    local_free_lists().push(index, frame);
+}
+
+}
@@ -0,0 +1,85 @@
+#include "kafka/protocol/crc32c.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace kafka {
+
+// Slicing-by-8 tables for the reflected Castagnoli polynomial.
+static const std::array<std::array<UINT32, 256>, 8> crc32c_tables = [] {
+    std::array<std::array<UINT32, 256>, 8> tables{};
+    for (UINT32 i = 0; i < 256; i++) {
+        UINT32 crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+        }
+        tables[0][i] = crc;
+    }
+    for (UINT32 i = 0; i < 256; i++) {
+        for (std::size_t t = 1; t < tables.size(); t++) {
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}();
+
+static UINT32 crc32c_portable(UINT32 crc, const unsigned char *p, std::size_t nbytes) {
+    const auto &t = crc32c_tables;
+    while (nbytes >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        if constexpr (std::endian::native == std::endian::big) {
+            word = std::byteswap(word);
+        }
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+              t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        p += 8;
+        nbytes -= 8;
+    }
+    while (nbytes--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static UINT32 crc32c_sse42(UINT32 crc, const unsigned char *p, std::size_t nbytes) {
+    std::uint64_t crc64 = crc;
+    while (nbytes >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        nbytes -= 8;
+    }
+    crc = static_cast<UINT32>(crc64);
+    while (nbytes--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+UINT32 crc32c(const void *data, std::size_t nbytes) {
+    return crc32c(0, data, nbytes);
+}
+
+UINT32 crc32c(UINT32 crc, const void *data, std::size_t nbytes) {
+    const auto *p = static_cast<const unsigned char *>(data);
+#if defined(__x86_64__)
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (has_sse42) {
+        return ~crc32c_sse42(~crc, p, nbytes);
+    }
+#endif
+    return ~crc32c_portable(~crc, p, nbytes);
+}
+
+}
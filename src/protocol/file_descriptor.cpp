@@ -1,5 +1,6 @@
 #include "kafka/protocol/file_descriptor.hpp"
 
+#include <cerrno>
 #include <unistd.h>
 
 namespace kafka {
@@ -18,6 +19,17 @@ void FileDescriptor::read(void *dst, std::size_t nbytes) {
     }
 }
 
+std::size_t FileDescriptor::read_some(void *dst, std::size_t nbytes) {
+    for ( ; ; ) {
+        ssize_t nr = ::read(fd_, dst, nbytes);
+        if (nr >= 0) {
+            return nr;
+        } else if (errno != EINTR) {
+            throw_system_error("read");
+        }
+    }
+}
+
 void FileDescriptor::write(const void *src, std::size_t nbytes) {
     const char *p = static_cast<const char *>(src);
     while (nbytes > 0) {
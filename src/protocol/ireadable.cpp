@@ -1,8 +1,16 @@
 #include "kafka/protocol/ireadable.hpp"
 #include "kafka/utils.hpp"
 
+#include <algorithm>
+
 namespace kafka {
 
+void check_length(IReadable &readable, INT64 n) {
+    if (n > 0 && static_cast<std::uint64_t>(n) > readable.remaining()) {
+        throw_runtime_error("length exceeds the remaining bytes");
+    }
+}
+
 INT8 read_int8(IReadable &readable) {
     INT8 n;
     readable.read(&n, sizeof(n));
@@ -66,7 +74,8 @@ COMPACT_STRING read_compact_string(IReadable &readable) {
     if (n == 0) {
         return "";
     }
-    COMPACT_STRING str(--n, 0);
+    check_length(readable, --n);
+    COMPACT_STRING str(n, 0);
     readable.read(str.data(), str.size());
     return str;
 }
@@ -76,6 +85,7 @@ NULLABLE_STRING read_nullable_string(IReadable &readable) {
     if (n < 0) {
         return "";
     }
+    check_length(readable, n);
     NULLABLE_STRING str(n, 0);
     readable.read(str.data(), str.size());
     return str;
@@ -83,16 +93,25 @@ NULLABLE_STRING read_nullable_string(IReadable &readable) {
 
 BYTES read_bytes(IReadable &readable) {
     INT32 n = read_int32(readable);
+    if (n < 0) {
+        throw_runtime_error("negative length");
+    }
+    check_length(readable, n);
     BYTES bytes(n);
     readable.read(bytes.data(), bytes.size());
     return bytes;
 }
 
 void read_tagged_fields(IReadable &readable) {
-    char c;
-    readable.read(&c, sizeof(c));
-    if (c != 0x00) {
-        throw_runtime_error("unexpected tagged fields");
+    // Unknown tagged fields are skipped.
+    for (UNSIGNED_VARINT n = read_unsigned_varint(readable); n > 0; n--) {
+        read_unsigned_varint(readable);
+        char discard[256];
+        for (UNSIGNED_VARINT size = read_unsigned_varint(readable); size > 0; ) {
+            UNSIGNED_VARINT chunk = std::min<UNSIGNED_VARINT>(size, sizeof(discard));
+            readable.read(discard, chunk);
+            size -= chunk;
+        }
     }
 }
 
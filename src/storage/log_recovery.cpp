@@ -0,0 +1,359 @@
+#include "kafka/storage/log_recovery.hpp"
+#include "kafka/metadata/log_tailer.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/storage/record_batch_format.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace kafka {
+
+namespace {
+
+constexpr const char *recovery_point_checkpoint_file = "recovery-point-offset-checkpoint";
+constexpr const char *clean_shutdown_file = ".kafka_cleanshutdown";
+
+// Fields of a record batch that the indexes are built from.
+constexpr std::size_t last_offset_delta_position = 23;
+constexpr std::size_t max_timestamp_position = 35;
+
+// Bytes of log between two offset index entries, as Kafka's `index.interval.bytes` default.
+constexpr std::size_t index_interval_bytes = 4096;
+
+template<typename IntType>
+IntType load_big_endian(const unsigned char *p) {
+    IntType n;
+    std::memcpy(&n, p, sizeof(n));
+    return to_host_byte_order(n);
+}
+
+template<typename IntType>
+void store_big_endian(std::vector<unsigned char> &out, IntType n) {
+    n = to_network_byte_order(n);
+    const auto *p = reinterpret_cast<const unsigned char *>(&n);
+    out.insert(out.end(), p, p + sizeof(n));
+}
+
+std::string index_path(const std::string &log_dir, INT64 base_offset, const char *extension) {
+    return std::format("{}/{:020}{}", log_dir, base_offset, extension);
+}
+
+// Writes `bytes` to a temporary file and renames it over `path`.
+void replace_file(const std::string &path, const std::vector<unsigned char> &bytes) {
+    std::string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw_system_error(temporary_path.c_str());
+    }
+    {
+        FileDescriptor file(fd);
+        file.write(bytes.data(), bytes.size());
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) < 0) {
+        throw_system_error("rename");
+    }
+}
+
+// Outcome of scanning one segment.
+struct SegmentScan {
+    std::size_t valid_bytes = 0;
+    std::uint64_t batches = 0;
+    // Offset after the last valid batch, or -1 if the segment holds none.
+    INT64 next_offset = -1;
+    std::vector<unsigned char> offset_index;
+    std::vector<unsigned char> time_index;
+};
+
+// Validates the batches of a segment up to the first invalid or torn one and builds its offset
+// and time indexes the way Kafka's `LogSegment.recover` does.
+SegmentScan scan_segment(const std::string &path, INT64 base_offset) {
+    SegmentScan scan;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_system_error(path.c_str());
+    }
+    FileDescriptor file(fd);
+    struct stat st;
+    if (fstat(file.get(), &st) < 0) {
+        throw_system_error("fstat");
+    }
+    std::size_t size = st.st_size;
+    if (size == 0) {
+        return scan;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.get(), 0);
+    if (mapping == MAP_FAILED) {
+        throw_system_error("mmap");
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const auto *data = static_cast<const unsigned char *>(mapping);
+
+    std::size_t last_index_entry = 0;
+    INT64 max_timestamp_so_far = -1;
+    INT64 offset_of_max_timestamp = -1;
+    INT64 last_indexed_timestamp = -1;
+    auto append_time_entry = [&] {
+        if (max_timestamp_so_far > last_indexed_timestamp) {
+            store_big_endian(scan.time_index, max_timestamp_so_far);
+            store_big_endian(scan.time_index, static_cast<INT32>(offset_of_max_timestamp - base_offset));
+            last_indexed_timestamp = max_timestamp_so_far;
+        }
+    };
+
+    std::size_t position = 0;
+    while (position + batch_header_size <= size) {
+        const unsigned char *batch = data + position;
+        auto batch_length = load_big_endian<INT32>(batch + sizeof(INT64));
+        if (batch_length < min_batch_length || position + batch_header_size + batch_length > size) {
+            break;
+        }
+        std::size_t batch_size = batch_header_size + batch_length;
+        if (!record_batch_valid(batch, batch_size)) {
+            break;
+        }
+
+        auto last_offset = load_big_endian<INT64>(batch) + load_big_endian<INT32>(batch + last_offset_delta_position);
+        auto max_timestamp = load_big_endian<INT64>(batch + max_timestamp_position);
+        if (max_timestamp > max_timestamp_so_far) {
+            max_timestamp_so_far = max_timestamp;
+            offset_of_max_timestamp = last_offset;
+        }
+        if (position - last_index_entry > index_interval_bytes) {
+            store_big_endian(scan.offset_index, static_cast<INT32>(last_offset - base_offset));
+            store_big_endian(scan.offset_index, static_cast<INT32>(position));
+            append_time_entry();
+            last_index_entry = position;
+        }
+        position += batch_size;
+        scan.batches++;
+        scan.next_offset = last_offset + 1;
+    }
+    append_time_entry();
+    munmap(mapping, size);
+    scan.valid_bytes = position;
+    return scan;
+}
+
+// Removes a segment together with its indexes. Returns the size of the segment.
+std::uint64_t delete_segment(const std::string &log_dir, INT64 base_offset) {
+    std::string path = segment_path(log_dir, base_offset);
+    struct stat st;
+    std::uint64_t size = stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+    std::remove(path.c_str());
+    std::remove(index_path(log_dir, base_offset, ".index").c_str());
+    std::remove(index_path(log_dir, base_offset, ".timeindex").c_str());
+    return size;
+}
+
+bool file_exists(const std::string &path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+// Returns whether a directory entry names a partition log directory (`<topic>-<partition>`).
+bool is_partition_dir(std::string_view name) {
+    auto dash = name.rfind('-');
+    return dash != std::string_view::npos && dash > 0 && dash + 1 < name.size() &&
+           std::all_of(name.begin() + dash + 1, name.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Recovers one partition log and returns its log end offset. The active segment is always
+// scanned, since that is where the log end offset is found.
+INT64 recover_partition(const std::string &log_dir, INT64 recovery_point, bool truncate, RecoveryStats &stats) {
+    auto segments = list_segments(log_dir);
+    INT64 log_end_offset = 0;
+    for (std::size_t i = 0; i < segments.size(); i++) {
+        INT64 base_offset = segments[i];
+        std::string path = segment_path(log_dir, base_offset);
+        bool last = i + 1 == segments.size();
+        // Segments that end before the recovery point were flushed; check only their indexes.
+        bool validate = last || segments[i + 1] > recovery_point;
+        bool indexes_missing = !file_exists(index_path(log_dir, base_offset, ".index")) ||
+                               !file_exists(index_path(log_dir, base_offset, ".timeindex"));
+        if (!validate && !indexes_missing) {
+            continue;
+        }
+
+        SegmentScan scan = scan_segment(path, base_offset);
+        stats.segments_scanned++;
+        stats.bytes_scanned += scan.valid_bytes;
+        stats.batches_validated += scan.batches;
+        log_end_offset = scan.next_offset >= 0 ? scan.next_offset : base_offset;
+
+        struct stat st;
+        if (stat(path.c_str(), &st) < 0) {
+            throw_system_error(path.c_str());
+        }
+        std::size_t size = st.st_size;
+        if (size > scan.valid_bytes && !truncate) {
+            std::cerr << std::format("Segment {} is damaged after byte {} of {}; left in place\n", path,
+                                     scan.valid_bytes, size);
+            stats.bytes_damaged += size - scan.valid_bytes;
+            if (!indexes_missing) {
+                continue;
+            }
+        } else if (size > scan.valid_bytes) {
+            std::cerr << std::format("Segment {} is damaged after byte {} of {}; truncating it and deleting {} "
+                                     "later segments\n", path, scan.valid_bytes, size, segments.size() - i - 1);
+            if (::truncate(path.c_str(), scan.valid_bytes) < 0) {
+                throw_system_error(path.c_str());
+            }
+            stats.bytes_truncated += size - scan.valid_bytes;
+            for (std::size_t j = i + 1; j < segments.size(); j++) {
+                stats.bytes_truncated += delete_segment(log_dir, segments[j]);
+            }
+            segments.resize(i + 1);
+        }
+
+        replace_file(index_path(log_dir, base_offset, ".index"), scan.offset_index);
+        replace_file(index_path(log_dir, base_offset, ".timeindex"), scan.time_index);
+        stats.indexes_rebuilt += 2;
+    }
+    return log_end_offset;
+}
+
+}
+
+RecoveryPoints read_recovery_point_checkpoint(const std::string &path) {
+    RecoveryPoints recovery_points;
+    std::ifstream in(path);
+    int version;
+    std::size_t count;
+    if (!(in >> version >> count) || version != 0) {
+        return recovery_points;
+    }
+    std::string topic;
+    INT32 partition;
+    INT64 offset;
+    for (std::size_t i = 0; i < count && in >> topic >> partition >> offset; i++) {
+        recovery_points[std::format("{}-{}", topic, partition)] = offset;
+    }
+    return recovery_points;
+}
+
+void write_recovery_point_checkpoint(const std::string &path, const RecoveryPoints &recovery_points) {
+    std::string contents = std::format("0\n{}\n", recovery_points.size());
+    for (const auto &[partition_dir, offset] : recovery_points) {
+        auto dash = partition_dir.rfind('-');
+        contents += std::format("{} {} {}\n", partition_dir.substr(0, dash), partition_dir.substr(dash + 1), offset);
+    }
+
+    std::string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw_system_error(temporary_path.c_str());
+    }
+    {
+        FileDescriptor file(fd);
+        file.write(contents.data(), contents.size());
+        if (fsync(file.get()) < 0) {
+            throw_system_error("fsync");
+        }
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) < 0) {
+        throw_system_error("rename");
+    }
+}
+
+RecoveryStats recover_logs(const std::string &log_dir, std::size_t num_threads, bool truncate) {
+    auto start_time = std::chrono::steady_clock::now();
+    RecoveryStats stats;
+
+    std::vector<std::string> partition_dirs;
+    if (DIR *dir = opendir(log_dir.c_str())) {
+        while (dirent *entry = readdir(dir)) {
+            if (!is_partition_dir(entry->d_name)) {
+                continue;
+            }
+            struct stat st;
+            if (entry->d_type == DT_DIR || (entry->d_type == DT_UNKNOWN &&
+                                            stat((log_dir + "/" + entry->d_name).c_str(), &st) == 0 &&
+                                            S_ISDIR(st.st_mode))) {
+                partition_dirs.emplace_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+    stats.partitions = partition_dirs.size();
+
+    // After a clean shutdown every segment was flushed, so only missing indexes are rebuilt.
+    std::string clean_shutdown_path = log_dir + "/" + clean_shutdown_file;
+    bool clean_shutdown = file_exists(clean_shutdown_path);
+    std::string checkpoint_path = log_dir + "/" + recovery_point_checkpoint_file;
+    RecoveryPoints recovery_points = read_recovery_point_checkpoint(checkpoint_path);
+
+    // Workers claim partitions one at a time, so a few large logs do not serialize the rest.
+    std::atomic<std::size_t> next_partition = 0;
+    std::mutex mutex;
+    RecoveryPoints log_end_offsets;
+    auto work = [&] {
+        RecoveryStats local;
+        RecoveryPoints local_end_offsets;
+        for (std::size_t i; (i = next_partition.fetch_add(1)) < partition_dirs.size(); ) {
+            const std::string &name = partition_dirs[i];
+            auto it = recovery_points.find(name);
+            // Only what this broker wrote since its last checkpoint can be torn. Without a
+            // checkpoint entry nothing is known to be flushed, so the whole log is validated.
+            INT64 recovery_point = std::numeric_limits<INT64>::max();
+            if (!clean_shutdown) {
+                recovery_point = it != recovery_points.end() ? it->second : 0;
+            }
+            try {
+                local_end_offsets[name] = recover_partition(log_dir + "/" + name, recovery_point, truncate, local);
+            } catch (const std::exception &e) {
+                std::cerr << std::format("Skipping recovery of partition {}: {}\n", name, e.what());
+                local.partitions_failed++;
+                if (it != recovery_points.end()) {
+                    local_end_offsets[name] = it->second;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.segments_scanned += local.segments_scanned;
+        stats.bytes_scanned += local.bytes_scanned;
+        stats.batches_validated += local.batches_validated;
+        stats.bytes_truncated += local.bytes_truncated;
+        stats.bytes_damaged += local.bytes_damaged;
+        stats.partitions_failed += local.partitions_failed;
+        stats.indexes_rebuilt += local.indexes_rebuilt;
+        log_end_offsets.merge(local_end_offsets);
+    };
+
+    std::vector<std::thread> threads;
+    num_threads = std::clamp<std::size_t>(num_threads, 1, std::max<std::size_t>(partition_dirs.size(), 1));
+    for (std::size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (!partition_dirs.empty()) {
+        write_recovery_point_checkpoint(checkpoint_path, log_end_offsets);
+    }
+    if (clean_shutdown) {
+        std::remove(clean_shutdown_path.c_str());
+    }
+
+    stats.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+    return stats;
+}
+
+}
@@ -0,0 +1,48 @@
+#include "kafka/storage/record_batch_format.hpp"
+#include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+
+namespace kafka {
+
+static void write_record(WritableBuffer &records, VARINT offset_delta, const BYTES &value) {
+    WritableBuffer record;
+    write_int8(record, 0);       // Attributes.
+    write_varlong(record, 0);    // Timestamp delta.
+    write_varint(record, offset_delta);
+    write_varint(record, -1);    // Null key.
+    write_varint(record, static_cast<VARINT>(value.size()));
+    record.write(value.data(), value.size());
+    write_varint(record, 0);     // No headers.
+    write_varint(records, static_cast<VARINT>(record.buffer().size()));
+    records.write(record.buffer().data(), record.buffer().size());
+}
+
+BYTES encode_record_batch(INT64 base_offset, const std::vector<BYTES> &values) {
+    WritableBuffer records;
+    for (std::size_t i = 0; i < values.size(); i++) {
+        write_record(records, static_cast<VARINT>(i), values[i]);
+    }
+
+    WritableBuffer batch;
+    write_int64(batch, base_offset);
+    write_int32(batch, static_cast<INT32>(min_batch_length + records.buffer().size()));
+    write_int32(batch, 0);       // Partition leader epoch.
+    write_int8(batch, current_magic);
+    write_uint32(batch, 0);      // CRC, computed below.
+    write_int16(batch, 0);       // Attributes.
+    write_int32(batch, static_cast<INT32>(values.size()) - 1);  // Last offset delta.
+    write_int64(batch, 0);       // Base timestamp.
+    write_int64(batch, 0);       // Max timestamp.
+    write_int64(batch, -1);      // Producer ID.
+    write_int16(batch, -1);      // Producer epoch.
+    write_int32(batch, -1);      // Base sequence.
+    write_int32(batch, static_cast<INT32>(values.size()));
+    batch.write(records.buffer().data(), records.buffer().size());
+
+    BYTES bytes = batch.release();
+    UINT32 crc = to_network_byte_order(crc32c(bytes.data() + attributes_position, bytes.size() - attributes_position));
+    std::memcpy(bytes.data() + crc_position, &crc, sizeof(crc));
+    return bytes;
+}
+
+}
@@ -0,0 +1,124 @@
+#include "kafka/storage/segment_reader.hpp"
+#include "kafka/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <format>
+#include <iterator>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace kafka {
+
+SegmentReader &SegmentReader::get_instance() {
+    static SegmentReader instance;
+    return instance;
+}
+
+BYTES SegmentReader::read(int fd, std::size_t size, const std::function<bool()> &inactive) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    BYTES bytes(size);
+    std::size_t position = 0;
+    std::uint64_t page_cache_bytes = 0;
+    std::uint64_t disk_bytes = 0;
+    bool cold = false;
+    bool nowait = nowait_supported_.load(std::memory_order_relaxed);
+    while (position < size) {
+        if (nowait) {
+            iovec iov{bytes.data() + position, size - position};
+            ssize_t nr = preadv2(fd, &iov, 1, static_cast<off_t>(position), RWF_NOWAIT);
+            if (nr > 0) {
+                position += nr;
+                page_cache_bytes += nr;
+                continue;
+            }
+            if (nr == 0) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EOPNOTSUPP || errno == EINVAL) {
+                nowait_supported_.store(false, std::memory_order_relaxed);
+                nowait = false;
+            } else if (errno != EAGAIN) {
+                throw_system_error("preadv2");
+            } else if (!cold) {
+                // Have the kernel read in the rest while this read waits for the next part.
+                cold = true;
+                posix_fadvise(fd, static_cast<off_t>(position), static_cast<off_t>(size - position),
+                              POSIX_FADV_WILLNEED);
+            }
+        }
+        std::size_t length = nowait ? std::min(size - position, disk_read_size) : size - position;
+        ssize_t nr = pread(fd, bytes.data() + position, length, static_cast<off_t>(position));
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_system_error("pread");
+        }
+        if (nr == 0) {
+            break;
+        }
+        position += nr;
+        if (nowait) {
+            disk_bytes += nr;
+        }
+    }
+    bytes.resize(position);
+
+    reads_.fetch_add(1, std::memory_order_relaxed);
+    if (cold) {
+        cold_reads_.fetch_add(1, std::memory_order_relaxed);
+    }
+    page_cache_bytes_.fetch_add(page_cache_bytes, std::memory_order_relaxed);
+    disk_bytes_.fetch_add(disk_bytes, std::memory_order_relaxed);
+    std::size_t drop_bytes = cold_read_drop_bytes_.load(std::memory_order_relaxed);
+    if (drop_bytes > 0 && position >= drop_bytes && cold && inactive()) {
+        posix_fadvise(fd, 0, static_cast<off_t>(position), POSIX_FADV_DONTNEED);
+        dropped_bytes_.fetch_add(position, std::memory_order_relaxed);
+    }
+    return bytes;
+}
+
+SegmentReader::Stats SegmentReader::stats() const {
+    return Stats{
+        reads_.load(std::memory_order_relaxed),
+        cold_reads_.load(std::memory_order_relaxed),
+        page_cache_bytes_.load(std::memory_order_relaxed),
+        disk_bytes_.load(std::memory_order_relaxed),
+        dropped_bytes_.load(std::memory_order_relaxed),
+    };
+}
+
+void SegmentReader::write_prometheus(std::string &out) const {
+    Stats stats = this->stats();
+    auto append = std::back_inserter(out);
+    std::format_to(append, "# HELP kafka_log_reads_total Segment reads for Fetches.\n"
+                           "# TYPE kafka_log_reads_total counter\n"
+                           "kafka_log_reads_total{{cache=\"hit\"}} {}\n"
+                           "kafka_log_reads_total{{cache=\"miss\"}} {}\n",
+                   stats.reads - stats.cold_reads, stats.cold_reads);
+    std::format_to(append, "# HELP kafka_log_read_bytes_total Bytes read from segments, by where they came from.\n"
+                           "# TYPE kafka_log_read_bytes_total counter\n"
+                           "kafka_log_read_bytes_total{{source=\"page_cache\"}} {}\n"
+                           "kafka_log_read_bytes_total{{source=\"disk\"}} {}\n",
+                   stats.page_cache_bytes, stats.disk_bytes);
+    std::format_to(append, "# HELP kafka_log_read_dropped_bytes_total Bytes dropped from the page cache after cold "
+                           "reads.\n"
+                           "# TYPE kafka_log_read_dropped_bytes_total counter\n"
+                           "kafka_log_read_dropped_bytes_total {}\n",
+                   stats.dropped_bytes);
+    std::uint64_t classified = stats.page_cache_bytes + stats.disk_bytes;
+    if (classified > 0) {
+        std::format_to(append, "# HELP kafka_log_read_cache_hit_ratio Share of the bytes read that came from the "
+                               "page cache.\n"
+                               "# TYPE kafka_log_read_cache_hit_ratio gauge\n"
+                               "kafka_log_read_cache_hit_ratio {:.4f}\n",
+                       static_cast<double>(stats.page_cache_bytes) / static_cast<double>(classified));
+    }
+}
+
+}
@@ -0,0 +1,34 @@
+#include "loadgen/connection.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <format>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "kafka/utils.hpp"
+
+namespace kafka::loadgen {
+
+FileDescriptor connect_to_server(const std::string &host, INT32 port) {
+    FileDescriptor socket_fd(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (socket_fd.get() < 0) {
+        throw_system_error("socket");
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        throw_runtime_error(std::format("invalid IPv4 address: {}", host).c_str());
+    }
+    if (connect(socket_fd.get(), reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        throw_system_error("connect");
+    }
+    int one = 1;
+    setsockopt(socket_fd.get(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(socket_fd.get(), F_SETFL, fcntl(socket_fd.get(), F_GETFL) | O_NONBLOCK);
+    return socket_fd;
+}
+
+}
@@ -0,0 +1,17 @@
+#ifndef CODECRAFTERS_KAFKA_TOOLS_LOADGEN_CONNECTION_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_TOOLS_LOADGEN_CONNECTION_HPP_INCLUDED
+
+#include <string>
+
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka::loadgen {
+
+// Connects to a server at an IPv4 address, and returns the socket in non-blocking mode with
+// Nagle's algorithm off.
+FileDescriptor connect_to_server(const std::string &host, INT32 port);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_TOOLS_LOADGEN_CONNECTION_HPP_INCLUDED
@@ -0,0 +1,136 @@
+#include "loadgen/dataset.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+#include "kafka/storage/record_batch_format.hpp"
+#include "kafka/utils.hpp"
+
+namespace kafka::loadgen {
+
+// Metadata records per batch of the metadata log.
+constexpr std::size_t metadata_records_per_batch = 1000;
+
+std::string dataset_topic_name(std::size_t index) {
+    return std::format("loadgen-topic-{:06}", index);
+}
+
+UUID dataset_topic_id(std::size_t index) {
+    UUID uuid{};
+    std::memcpy(uuid.data(), "loadgen-", 8);
+    for (std::size_t i = 0; i < 8; i++) {
+        uuid.data()[8 + i] = static_cast<unsigned char>(index >> (8 * (7 - i)));
+    }
+    return uuid;
+}
+
+BYTES encode_topic_record(std::size_t index) {
+    WritableBuffer wb;
+    write_int8(wb, 1);  // Frame version.
+    write_int8(wb, 2);  // TopicRecord.
+    write_int8(wb, 0);  // Version.
+    write_compact_nullable_string(wb, dataset_topic_name(index));
+    write_uuid(wb, dataset_topic_id(index));
+    write_tagged_fields(wb);
+    return wb.release();
+}
+
+BYTES encode_partition_record(std::size_t index, INT32 partition_id, INT32 node_id) {
+    WritableBuffer wb;
+    write_int8(wb, 1);  // Frame version.
+    write_int8(wb, 3);  // PartitionRecord.
+    write_int8(wb, 0);  // Version.
+    write_int32(wb, partition_id);
+    write_uuid(wb, dataset_topic_id(index));
+    for (int replica_list = 0; replica_list < 2; replica_list++) {  // Replicas and ISR.
+        write_unsigned_varint(wb, 2);
+        write_int32(wb, node_id);
+    }
+    write_unsigned_varint(wb, 1);  // No removing replicas.
+    write_unsigned_varint(wb, 1);  // No adding replicas.
+    write_int32(wb, node_id);      // Leader.
+    write_int32(wb, 0);            // Leader epoch.
+    write_int32(wb, 0);            // Partition epoch.
+    write_tagged_fields(wb);
+    return wb.release();
+}
+
+static void write_file(const std::filesystem::path &path, const BYTES &bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file) {
+        throw_runtime_error(std::format("cannot write {}", path.string()).c_str());
+    }
+}
+
+static std::filesystem::path segment(const std::filesystem::path &partition_dir) {
+    std::filesystem::create_directories(partition_dir);
+    return partition_dir / "00000000000000000000.log";
+}
+
+static void write_metadata_log(const DatasetOptions &options) {
+    constexpr INT32 node_id = 1;
+    auto path = segment(std::filesystem::path(options.log_dir) / "__cluster_metadata-0");
+    INT64 next_offset = 0;
+    std::vector<BYTES> values;
+    auto flush = [&] {
+        write_file(path, encode_record_batch(next_offset, values));
+        next_offset += static_cast<INT64>(values.size());
+        values.clear();
+    };
+    for (std::size_t i = 0; i < options.topic_count; i++) {
+        values.push_back(encode_topic_record(i));
+        for (INT32 p = 0; p < options.partitions_per_topic; p++) {
+            values.push_back(encode_partition_record(i, p, node_id));
+        }
+        if (values.size() >= metadata_records_per_batch) {
+            flush();
+        }
+    }
+    if (!values.empty()) {
+        flush();
+    }
+}
+
+static void write_partition_logs(const DatasetOptions &options) {
+    // Every batch holds the same records, so one is encoded and only its base offset, which
+    // the CRC does not cover, changes from batch to batch.
+    std::vector<BYTES> values(static_cast<std::size_t>(options.records_per_batch), BYTES(options.value_size, 'v'));
+    BYTES batch = encode_record_batch(0, values);
+    BYTES partition_log;
+    partition_log.reserve(batch.size() * options.batches_per_partition);
+    for (std::size_t b = 0; b < options.batches_per_partition; b++) {
+        INT64 base_offset = to_network_byte_order(static_cast<INT64>(b) * options.records_per_batch);
+        std::memcpy(batch.data(), &base_offset, sizeof(base_offset));
+        partition_log.insert(partition_log.end(), batch.begin(), batch.end());
+    }
+    for (std::size_t i = 0; i < options.topic_count; i++) {
+        for (INT32 p = 0; p < options.partitions_per_topic; p++) {
+            auto partition_dir = std::format("{}-{}", dataset_topic_name(i), p);
+            write_file(segment(std::filesystem::path(options.log_dir) / partition_dir), partition_log);
+        }
+    }
+}
+
+void generate_dataset(const DatasetOptions &options) {
+    std::filesystem::path log_dir(options.log_dir);
+    if (std::filesystem::exists(log_dir) && !std::filesystem::is_empty(log_dir)) {
+        if (!options.overwrite) {
+            throw_runtime_error(std::format("{} is not empty; pass --overwrite to replace it", options.log_dir).c_str());
+        }
+        std::filesystem::remove_all(log_dir);
+    }
+    std::filesystem::create_directories(log_dir);
+    write_metadata_log(options);
+    if (options.records_per_batch > 0) {
+        write_partition_logs(options);
+    }
+    std::ofstream(log_dir / "meta.properties") << "version=1\ncluster.id=loadgen-cluster\nnode.id=1\n";
+}
+
+}
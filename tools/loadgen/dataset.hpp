@@ -0,0 +1,45 @@
+#ifndef CODECRAFTERS_KAFKA_TOOLS_LOADGEN_DATASET_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_TOOLS_LOADGEN_DATASET_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+#include "kafka/protocol/types.hpp"
+#include "kafka/protocol/uuid.hpp"
+
+namespace kafka::loadgen {
+
+// Shape of a synthetic log directory: topics in the `__cluster_metadata` log and the record
+// batches of their partition logs.
+struct DatasetOptions {
+    std::string log_dir = "/tmp/kraft-combined-logs";
+    std::size_t topic_count = 100;
+    INT32 partitions_per_topic = 3;
+    std::size_t batches_per_partition = 10;
+    INT32 records_per_batch = 10;
+    std::size_t value_size = 100;
+    // Whether an existing log directory is deleted first rather than refused.
+    bool overwrite = false;
+};
+
+// Returns the name of the `index`-th topic of a dataset.
+std::string dataset_topic_name(std::size_t index);
+
+// Returns the ID of the `index`-th topic of a dataset, which is derived from its index so that
+// requests can name it without reading the metadata.
+UUID dataset_topic_id(std::size_t index);
+
+// Returns the metadata record value of a TopicRecord that creates the `index`-th topic.
+BYTES encode_topic_record(std::size_t index);
+
+// Returns the metadata record value of a PartitionRecord for a partition of the `index`-th
+// topic, with `node_id` as its only replica and leader.
+BYTES encode_partition_record(std::size_t index, INT32 partition_id, INT32 node_id);
+
+// Writes a dataset into an empty log directory: a metadata log that creates its topics, a
+// partition log per partition and a `meta.properties` file.
+void generate_dataset(const DatasetOptions &options);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_TOOLS_LOADGEN_DATASET_HPP_INCLUDED
@@ -0,0 +1,410 @@
+#include "loadgen/load_generator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <format>
+#include <memory>
+#include <random>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+#include "kafka/message/api_registry.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/protocol/iwritable.hpp"
+#include "kafka/protocol/writable_buffer.hpp"
+#include "kafka/utils.hpp"
+#include "loadgen/connection.hpp"
+#include "loadgen/dataset.hpp"
+
+namespace kafka::loadgen {
+
+using Clock = std::chrono::steady_clock;
+
+// Frames encoded ahead per request kind, each naming other topics.
+constexpr std::size_t frames_per_kind = 64;
+
+// Offset of the correlation ID in a request frame, after the size prefix, API key and version.
+constexpr std::size_t correlation_id_position = 8;
+
+// Time given to requests in flight at the end to be answered.
+constexpr std::chrono::seconds drain_timeout{1};
+
+static std::vector<std::size_t> pick_topics(const LoadOptions &options, std::mt19937_64 &rng) {
+    std::vector<std::size_t> topics;
+    for (std::size_t i = 0; i < options.topics_per_request; i++) {
+        topics.push_back(rng() % std::max<std::size_t>(options.topic_count, 1));
+    }
+    return topics;
+}
+
+static RequestVariant make_request(RequestKind kind, const LoadOptions &options, std::mt19937_64 &rng) {
+    switch (kind) {
+    case RequestKind::API_VERSIONS: {
+        ApiVersionsRequest request;
+        request.client_software_name = "kafka-loadgen";
+        request.client_software_version = "1.0";
+        return request;
+    }
+    case RequestKind::METADATA: {
+        MetadataRequest request;
+        request.topics.emplace();
+        for (std::size_t topic : pick_topics(options, rng)) {
+            request.topics->emplace_back().name = dataset_topic_name(topic);
+        }
+        return request;
+    }
+    case RequestKind::DESCRIBE_TOPIC_PARTITIONS: {
+        DescribeTopicPartitionsRequest request;
+        request.response_partition_limit = 2000;
+        for (std::size_t topic : pick_topics(options, rng)) {
+            request.topics.emplace_back().name = dataset_topic_name(topic);
+        }
+        return request;
+    }
+    case RequestKind::FETCH: {
+        FetchRequest request;
+        request.max_wait_ms = options.fetch_max_wait_ms;
+        request.min_bytes = options.fetch_min_bytes;
+        request.max_bytes = 50 << 20;
+        for (std::size_t topic : pick_topics(options, rng)) {
+            auto &fetch_topic = request.topics.emplace_back();
+            fetch_topic.topic_id = dataset_topic_id(topic);
+            for (INT32 p = 0; p < options.partitions_per_topic; p++) {
+                auto &partition = fetch_topic.partitions.emplace_back();
+                partition.partition = p;
+                partition.partition_max_bytes = 1 << 20;
+            }
+        }
+        return request;
+    }
+    }
+    throw_runtime_error("unknown request kind");
+    return {};
+}
+
+// Encodes a request frame with its size prefix, in the newest version the server serves.
+static BYTES encode_frame(const RequestVariant &request, const std::string &client_id) {
+    return std::visit([&](const auto &request) {
+        using Request = std::decay_t<decltype(request)>;
+        constexpr INT16 version = SupportedApis::versions[*find_api(Request::api_key)].max_version;
+        WritableBuffer wb;
+        write_api_key(wb, Request::api_key);
+        write_int16(wb, version);
+        write_int32(wb, 0);  // Correlation ID, set when sent.
+        write_int16(wb, static_cast<INT16>(client_id.size()));
+        wb.write(client_id.data(), client_id.size());
+        if (Request::is_flexible(version)) {
+            write_tagged_fields(wb);
+        }
+        request.write(wb, version);
+        WritableBuffer frame;
+        write_bytes(frame, wb.buffer());
+        return frame.release();
+    }, request);
+}
+
+namespace {
+
+struct InFlight {
+    INT32 correlation_id;
+    RequestKind kind;
+    Clock::time_point due;
+};
+
+struct Connection {
+    FileDescriptor socket{-1};
+    BYTES output;
+    std::size_t output_position = 0;
+    BYTES input;
+    std::deque<InFlight> in_flight;
+    INT32 next_correlation_id = 0;
+    bool writable_registered = false;
+};
+
+// Drives the connections of one thread.
+class Worker {
+public:
+    Worker(const LoadOptions &options, std::size_t connection_count, std::uint64_t seed)
+        : options_(options), rng_(seed), epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epoll_fd_.get() < 0) {
+            throw_system_error("epoll_create1");
+        }
+        for (std::size_t kind = 0; kind < request_kind_count; kind++) {
+            for (unsigned weight = 0; weight < options.mix[kind]; weight++) {
+                kinds_.push_back(static_cast<RequestKind>(kind));
+            }
+            for (std::size_t i = 0; options.mix[kind] > 0 && i < frames_per_kind; i++) {
+                frames_[kind].push_back(
+                    encode_frame(make_request(static_cast<RequestKind>(kind), options, rng_), options.client_id));
+            }
+        }
+        if (kinds_.empty()) {
+            throw_runtime_error("the request mix is empty");
+        }
+        for (std::size_t i = 0; i < connection_count; i++) {
+            connect();
+        }
+    }
+
+    // Sends requests until `end`, at `rate` requests per second from `start` or closed-loop if
+    // 0, and records the latencies of those due from `measure_start` on.
+    void run(Clock::time_point start, Clock::time_point measure_start, Clock::time_point end, double rate) {
+        measure_start_ = measure_start;
+        measure_end_ = end;
+        std::uint64_t scheduled = 0;
+        auto due = [&](std::uint64_t index) {
+            return start + std::chrono::nanoseconds(static_cast<std::int64_t>(index * 1e9 / rate));
+        };
+        for (auto now = Clock::now(); now < end; now = Clock::now()) {
+            Clock::time_point wake_up = end;
+            if (rate > 0) {
+                // Requests are due on a fixed schedule, however late the responses are; those
+                // that find every connection at its depth wait and count from when they were due.
+                while (due(scheduled) <= now) {
+                    Connection *connection = free_connection();
+                    if (!connection) {
+                        break;
+                    }
+                    send(*connection, due(scheduled++));
+                }
+                if (due(scheduled) > now) {
+                    wake_up = std::min(end, due(scheduled));
+                }
+            } else {
+                for (auto &connection : connections_) {
+                    while (connection->in_flight.size() < options_.pipeline_depth) {
+                        send(*connection, now);
+                    }
+                }
+            }
+            flush();
+            poll(wake_up - now);
+        }
+        if (rate > 0) {
+            auto due_count = static_cast<std::uint64_t>(std::chrono::duration<double>(end - start).count() * rate);
+            unsent_ = due_count > scheduled ? due_count - scheduled : 0;
+        }
+        drain();
+    }
+
+    // Adds the latencies recorded to `report`.
+    void add_to(LoadReport &report) const {
+        for (std::size_t kind = 0; kind < request_kind_count; kind++) {
+            latencies_[kind].add_to(report.latencies[kind].histogram);
+            report.latencies[kind].max = std::max(report.latencies[kind].max, max_latencies_[kind]);
+        }
+        report.unsent += unsent_;
+    }
+
+private:
+    const LoadOptions &options_;
+    std::mt19937_64 rng_;
+    FileDescriptor epoll_fd_;
+    std::vector<RequestKind> kinds_;
+    std::array<std::vector<BYTES>, request_kind_count> frames_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::size_t next_connection_ = 0;
+    Clock::time_point measure_start_;
+    Clock::time_point measure_end_;
+    std::array<LatencyHistogram, request_kind_count> latencies_;
+    std::array<std::chrono::nanoseconds, request_kind_count> max_latencies_{};
+    std::uint64_t unsent_ = 0;
+
+    void connect() {
+        auto connection = std::make_unique<Connection>();
+        connection->socket = connect_to_server(options_.host, options_.port);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = connection.get();
+        if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, connection->socket.get(), &event) != 0) {
+            throw_system_error("epoll_ctl");
+        }
+        connections_.push_back(std::move(connection));
+    }
+
+    // Returns the next connection, round robin, that is below its pipeline depth, if any.
+    Connection *free_connection() {
+        for (std::size_t i = 0; i < connections_.size(); i++) {
+            Connection &connection = *connections_[next_connection_];
+            next_connection_ = (next_connection_ + 1) % connections_.size();
+            if (connection.in_flight.size() < options_.pipeline_depth) {
+                return &connection;
+            }
+        }
+        return nullptr;
+    }
+
+    void send(Connection &connection, Clock::time_point due) {
+        auto kind = kinds_[rng_() % kinds_.size()];
+        const auto &frames = frames_[static_cast<std::size_t>(kind)];
+        const BYTES &frame = frames[rng_() % frames.size()];
+        INT32 correlation_id = connection.next_correlation_id++;
+        std::size_t position = connection.output.size();
+        connection.output.insert(connection.output.end(), frame.begin(), frame.end());
+        INT32 encoded = to_network_byte_order(correlation_id);
+        std::memcpy(connection.output.data() + position + correlation_id_position, &encoded, sizeof(encoded));
+        connection.in_flight.push_back({correlation_id, kind, due});
+    }
+
+    // Writes the queued requests of every connection, waiting for the sockets that are full to
+    // become writable.
+    void flush() {
+        for (auto &connection : connections_) {
+            while (connection->output_position < connection->output.size()) {
+                ssize_t n = ::send(connection->socket.get(), connection->output.data() + connection->output_position,
+                                   connection->output.size() - connection->output_position, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        break;
+                    }
+                    throw_system_error("send");
+                }
+                connection->output_position += static_cast<std::size_t>(n);
+            }
+            if (connection->output_position == connection->output.size()) {
+                connection->output.clear();
+                connection->output_position = 0;
+            }
+            bool pending = !connection->output.empty();
+            if (pending != connection->writable_registered) {
+                epoll_event event{};
+                event.events = EPOLLIN | (pending ? static_cast<std::uint32_t>(EPOLLOUT) : std::uint32_t{0});
+                event.data.ptr = connection.get();
+                epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, connection->socket.get(), &event);
+                connection->writable_registered = pending;
+            }
+        }
+    }
+
+    // Waits up to `timeout` for responses and handles them.
+    void poll(Clock::duration timeout) {
+        auto nanoseconds = std::max<std::int64_t>(std::chrono::nanoseconds(timeout).count(), 0);
+        timespec ts{static_cast<time_t>(nanoseconds / 1'000'000'000), static_cast<long>(nanoseconds % 1'000'000'000)};
+        std::array<epoll_event, 64> events;
+        int n = epoll_pwait2(epoll_fd_.get(), events.data(), static_cast<int>(events.size()), &ts, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                return;
+            }
+            throw_system_error("epoll_pwait2");
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                receive(*static_cast<Connection *>(events[i].data.ptr));
+            }
+        }
+    }
+
+    void receive(Connection &connection) {
+        constexpr std::size_t chunk_size = 64 * 1024;
+        while (true) {
+            std::size_t size = connection.input.size();
+            connection.input.resize(size + chunk_size);
+            ssize_t n = recv(connection.socket.get(), connection.input.data() + size, chunk_size, 0);
+            connection.input.resize(size + static_cast<std::size_t>(std::max<ssize_t>(n, 0)));
+            if (n == 0) {
+                throw_runtime_error("the server closed a connection");
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                throw_system_error("recv");
+            }
+        }
+
+        auto now = Clock::now();
+        std::size_t position = 0;
+        while (connection.input.size() - position >= 8) {
+            INT32 size;
+            std::memcpy(&size, connection.input.data() + position, sizeof(size));
+            size = to_host_byte_order(size);
+            if (connection.input.size() - position - 4 < static_cast<std::size_t>(size)) {
+                break;
+            }
+            INT32 correlation_id;
+            std::memcpy(&correlation_id, connection.input.data() + position + 4, sizeof(correlation_id));
+            complete(connection, to_host_byte_order(correlation_id), now);
+            position += 4 + static_cast<std::size_t>(size);
+        }
+        connection.input.erase(connection.input.begin(), connection.input.begin() + static_cast<std::ptrdiff_t>(position));
+    }
+
+    void complete(Connection &connection, INT32 correlation_id, Clock::time_point now) {
+        if (connection.in_flight.empty() || connection.in_flight.front().correlation_id != correlation_id) {
+            throw_runtime_error(std::format("unexpected response with correlation ID {}", correlation_id).c_str());
+        }
+        InFlight request = connection.in_flight.front();
+        connection.in_flight.pop_front();
+        if (request.due >= measure_start_ && request.due < measure_end_) {
+            auto kind = static_cast<std::size_t>(request.kind);
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - request.due);
+            latencies_[kind].record(latency);
+            max_latencies_[kind] = std::max(max_latencies_[kind], latency);
+        }
+    }
+
+    // Waits for the requests in flight to be answered, so that the slowest ones are counted.
+    void drain() {
+        auto deadline = Clock::now() + drain_timeout;
+        auto in_flight = [&] {
+            return std::any_of(connections_.begin(), connections_.end(),
+                               [](const auto &connection) { return !connection->in_flight.empty(); });
+        };
+        for (auto now = Clock::now(); in_flight() && now < deadline; now = Clock::now()) {
+            flush();
+            poll(deadline - now);
+        }
+    }
+};
+
+}
+
+LoadReport run_load(const LoadOptions &options) {
+    std::size_t threads = std::clamp<std::size_t>(options.threads, 1, std::max<std::size_t>(options.connections, 1));
+    if (options.connections == 0 || options.pipeline_depth == 0) {
+        throw_runtime_error("connections and pipeline depth must be positive");
+    }
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t i = 0; i < threads; i++) {
+        std::size_t connection_count = options.connections / threads + (i < options.connections % threads);
+        workers.push_back(std::make_unique<Worker>(options, connection_count, i + 1));
+    }
+
+    auto start = Clock::now();
+    auto measure_start = start + options.warmup;
+    auto end = measure_start + options.duration;
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> worker_threads;
+    for (std::size_t i = 0; i < threads; i++) {
+        worker_threads.emplace_back([&, i] {
+            try {
+                workers[i]->run(start, measure_start, end, options.rate / static_cast<double>(threads));
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto &thread : worker_threads) {
+        thread.join();
+    }
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    LoadReport report;
+    report.elapsed = end - measure_start;
+    for (const auto &worker : workers) {
+        worker->add_to(report);
+    }
+    return report;
+}
+
+}
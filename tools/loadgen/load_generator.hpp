@@ -0,0 +1,88 @@
+#ifndef CODECRAFTERS_KAFKA_TOOLS_LOADGEN_LOAD_GENERATOR_HPP_INCLUDED
+#define CODECRAFTERS_KAFKA_TOOLS_LOADGEN_LOAD_GENERATOR_HPP_INCLUDED
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "kafka/metrics/latency_histogram.hpp"
+#include "kafka/protocol/types.hpp"
+
+namespace kafka::loadgen {
+
+// Requests the load generator sends. Produce is not among them, as the server does not serve it.
+enum class RequestKind {
+    API_VERSIONS,
+    METADATA,
+    DESCRIBE_TOPIC_PARTITIONS,
+    FETCH,
+};
+
+inline constexpr std::size_t request_kind_count = 4;
+
+// Returns the name of a request kind in options and reports, such as "fetch".
+constexpr std::string_view request_kind_name(RequestKind kind) {
+    switch (kind) {
+    case RequestKind::API_VERSIONS:
+        return "api_versions";
+    case RequestKind::METADATA:
+        return "metadata";
+    case RequestKind::DESCRIBE_TOPIC_PARTITIONS:
+        return "describe_topic_partitions";
+    case RequestKind::FETCH:
+        return "fetch";
+    }
+    return "unknown";
+}
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    INT32 port = 9092;
+    std::size_t connections = 8;
+    // Threads that the connections are spread over, each with an epoll loop of its own.
+    std::size_t threads = 1;
+    // Requests in flight per connection at most.
+    std::size_t pipeline_depth = 1;
+    // Requests per second over all connections, or 0 to keep every connection at its pipeline
+    // depth (closed loop).
+    double rate = 0;
+    std::chrono::seconds warmup{1};
+    std::chrono::seconds duration{10};
+    // Relative weights of the request kinds.
+    std::array<unsigned, request_kind_count> mix{1, 1, 1, 1};
+    // Topics of the dataset that requests pick from, and the partitions fetched of each.
+    std::size_t topic_count = 100;
+    INT32 partitions_per_topic = 3;
+    std::size_t topics_per_request = 1;
+    // `max_wait_ms` and `min_bytes` of Fetch requests. A Fetch whose partitions hold fewer bytes
+    // waits on the server for up to `max_wait_ms`.
+    INT32 fetch_max_wait_ms = 0;
+    INT32 fetch_min_bytes = 0;
+    std::string client_id = "kafka-loadgen";
+};
+
+// Requests answered while measuring, and their latencies.
+struct LoadReport {
+    struct Latencies {
+        LatencyHistogram::Snapshot histogram;
+        std::chrono::nanoseconds max{0};
+    };
+
+    std::chrono::nanoseconds elapsed{0};
+    // Per request kind; latencies run from the time a request was due to be sent, so that the
+    // time it waited behind slow responses counts (no coordinated omission).
+    std::array<Latencies, request_kind_count> latencies;
+    // Requests due that could not be sent by the end, as every connection was at its depth.
+    std::uint64_t unsent = 0;
+};
+
+// Drives a server with the requests of `options` over loopback for the warmup and the
+// measured duration, and reports the responses received while measuring.
+LoadReport run_load(const LoadOptions &options);
+
+}
+
+#endif  // CODECRAFTERS_KAFKA_TOOLS_LOADGEN_LOAD_GENERATOR_HPP_INCLUDED
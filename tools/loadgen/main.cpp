@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "kafka/utils.hpp"
+#include "loadgen/dataset.hpp"
+#include "loadgen/load_generator.hpp"
+
+using namespace kafka;
+using namespace kafka::loadgen;
+
+namespace {
+
+constexpr const char *usage = R"(Usage:
+  kafka_loadgen generate [--log-dir=/tmp/kraft-combined-logs] [--topics=100] [--partitions=3]
+                         [--batches=10] [--records=10] [--value-size=100] [--overwrite]
+  kafka_loadgen run [--host=127.0.0.1] [--port=9092] [--connections=8] [--threads=1] [--pipeline=1]
+                    [--rate=0] [--warmup=1] [--duration=10]
+                    [--mix=api_versions:1,metadata:1,describe_topic_partitions:1,fetch:1]
+                    [--topics=100] [--partitions=3] [--topics-per-request=1] [--client-id=kafka-loadgen]
+                    [--fetch-max-wait=0] [--fetch-min-bytes=0]
+
+`generate` writes a synthetic dataset of topics and partition logs for the server to load.
+`run` sends requests for the topics of such a dataset. With --rate=0 every connection keeps
+--pipeline requests in flight; otherwise requests are sent open-loop at --rate per second, and
+latencies run from when each request was due. Fetches ask for --fetch-min-bytes of records and
+wait on the server for up to --fetch-max-wait milliseconds for them.
+)";
+
+// Options as `--name=value`, or `--name` for flags.
+using Arguments = std::map<std::string, std::string, std::less<>>;
+
+Arguments parse_arguments(int argc, char *argv[]) {
+    Arguments arguments;
+    for (int i = 2; i < argc; i++) {
+        std::string_view argument(argv[i]);
+        if (!argument.starts_with("--")) {
+            throw_runtime_error(std::format("unexpected argument: {}", argument).c_str());
+        }
+        argument.remove_prefix(2);
+        auto equals = argument.find('=');
+        std::string_view name = argument.substr(0, equals);
+        std::string_view value = equals == std::string_view::npos ? "" : argument.substr(equals + 1);
+        arguments.emplace(name, value);
+    }
+    return arguments;
+}
+
+template<typename T>
+void take_number(std::string_view name, const std::string &text, T &value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw_runtime_error(std::format("invalid value of --{}: {}", name, text).c_str());
+    }
+}
+
+// Takes the option `name` out of `arguments` into `value`, if given.
+template<typename T>
+void take(Arguments &arguments, std::string_view name, T &value) {
+    auto iter = arguments.find(name);
+    if (iter == arguments.end()) {
+        return;
+    }
+    const std::string &text = iter->second;
+    if constexpr (std::is_same_v<T, std::string>) {
+        value = text;
+    } else if constexpr (std::is_same_v<T, bool>) {
+        value = text.empty() || text == "true";
+    } else if constexpr (std::is_same_v<T, std::chrono::seconds>) {
+        std::chrono::seconds::rep seconds;
+        take_number(name, text, seconds);
+        value = std::chrono::seconds(seconds);
+    } else {
+        take_number(name, text, value);
+    }
+    arguments.erase(iter);
+}
+
+void reject_unknown(const Arguments &arguments) {
+    if (!arguments.empty()) {
+        throw_runtime_error(std::format("unknown option: --{}", arguments.begin()->first).c_str());
+    }
+}
+
+// Parses a mix such as "fetch:3,metadata:1". Kinds left out get no weight.
+std::array<unsigned, request_kind_count> parse_mix(std::string_view text) {
+    std::array<unsigned, request_kind_count> mix{};
+    while (!text.empty()) {
+        std::string_view entry = text.substr(0, text.find(','));
+        text.remove_prefix(std::min(text.size(), entry.size() + 1));
+        auto colon = entry.find(':');
+        std::string_view name = entry.substr(0, colon);
+        unsigned weight = 1;
+        if (colon != std::string_view::npos) {
+            take_number("mix", std::string(entry.substr(colon + 1)), weight);
+        }
+        bool found = false;
+        for (std::size_t kind = 0; kind < request_kind_count; kind++) {
+            if (request_kind_name(static_cast<RequestKind>(kind)) == name) {
+                mix[kind] = weight;
+                found = true;
+            }
+        }
+        if (!found) {
+            throw_runtime_error(std::format("unknown request kind in --mix: {}", name).c_str());
+        }
+    }
+    return mix;
+}
+
+void generate(Arguments &arguments) {
+    DatasetOptions options;
+    take(arguments, "log-dir", options.log_dir);
+    take(arguments, "topics", options.topic_count);
+    take(arguments, "partitions", options.partitions_per_topic);
+    take(arguments, "batches", options.batches_per_partition);
+    take(arguments, "records", options.records_per_batch);
+    take(arguments, "value-size", options.value_size);
+    take(arguments, "overwrite", options.overwrite);
+    reject_unknown(arguments);
+    generate_dataset(options);
+    std::cout << std::format("Wrote {} topics of {} partitions to {}\n", options.topic_count,
+                             options.partitions_per_topic, options.log_dir);
+}
+
+double milliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void print_report(const LoadReport &report) {
+    double seconds = std::chrono::duration<double>(report.elapsed).count();
+    std::cout << std::format("{:<26} {:>10} {:>10} {:>9} {:>9} {:>9} {:>9}\n", "request", "count", "req/s",
+                             "p50 ms", "p99 ms", "p99.9 ms", "max ms");
+    LoadReport::Latencies total;
+    auto print_row = [&](std::string_view name, const LoadReport::Latencies &latencies) {
+        const auto &histogram = latencies.histogram;
+        std::cout << std::format("{:<26} {:>10} {:>10.0f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}\n", name,
+                                 histogram.count, static_cast<double>(histogram.count) / seconds,
+                                 milliseconds(histogram.value_at_quantile(0.5)),
+                                 milliseconds(histogram.value_at_quantile(0.99)),
+                                 milliseconds(histogram.value_at_quantile(0.999)), milliseconds(latencies.max));
+    };
+    for (std::size_t kind = 0; kind < request_kind_count; kind++) {
+        const auto &latencies = report.latencies[kind];
+        if (latencies.histogram.count == 0) {
+            continue;
+        }
+        print_row(request_kind_name(static_cast<RequestKind>(kind)), latencies);
+        for (std::size_t i = 0; i < latencies.histogram.counts.size(); i++) {
+            total.histogram.counts[i] += latencies.histogram.counts[i];
+        }
+        total.histogram.count += latencies.histogram.count;
+        total.histogram.sum_ns += latencies.histogram.sum_ns;
+        total.max = std::max(total.max, latencies.max);
+    }
+    print_row("total", total);
+    if (report.unsent > 0) {
+        std::cout << std::format("{} requests due were never sent, as every connection was at its pipeline depth\n",
+                                 report.unsent);
+    }
+}
+
+void run(Arguments &arguments) {
+    LoadOptions options;
+    std::string mix;
+    take(arguments, "host", options.host);
+    take(arguments, "port", options.port);
+    take(arguments, "connections", options.connections);
+    take(arguments, "threads", options.threads);
+    take(arguments, "pipeline", options.pipeline_depth);
+    take(arguments, "rate", options.rate);
+    take(arguments, "warmup", options.warmup);
+    take(arguments, "duration", options.duration);
+    take(arguments, "mix", mix);
+    take(arguments, "topics", options.topic_count);
+    take(arguments, "partitions", options.partitions_per_topic);
+    take(arguments, "topics-per-request", options.topics_per_request);
+    take(arguments, "client-id", options.client_id);
+    take(arguments, "fetch-max-wait", options.fetch_max_wait_ms);
+    take(arguments, "fetch-min-bytes", options.fetch_min_bytes);
+    reject_unknown(arguments);
+    if (!mix.empty()) {
+        options.mix = parse_mix(mix);
+    }
+    print_report(run_load(options));
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string_view command = argc > 1 ? argv[1] : "";
+    if (command != "generate" && command != "run") {
+        std::cerr << usage;
+        return 2;
+    }
+    try {
+        Arguments arguments = parse_arguments(argc, argv);
+        if (command == "generate") {
+            generate(arguments);
+        } else {
+            run(arguments);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "kafka_loadgen: " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <vector>
+
+#include "kafka/metrics/latency_histogram.hpp"
+#include "kafka/network/request_capture.hpp"
+#include "kafka/protocol/constants.hpp"
+#include "kafka/protocol/file_descriptor.hpp"
+#include "kafka/utils.hpp"
+#include "loadgen/connection.hpp"
+
+using namespace kafka;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr const char *usage = R"(Usage:
+  kafka_replay --capture=FILE [--host=127.0.0.1] [--port=9092] [--speed=1] [--timeout=5]
+
+Replays the requests of a capture written by the server (request.capture.file) against a
+server, one connection per captured connection and at the captured times divided by --speed,
+or as fast as possible with --speed=0. Each response is compared with the captured one, and
+the latencies of the capture and the replay are reported per API. Exits with 1 if a response
+differs or is missing after waiting --timeout seconds for the last ones.
+)";
+
+// A captured request and the response the server sent to it, if captured.
+struct Exchange {
+    BYTES request;
+    std::chrono::nanoseconds request_time{0};
+    std::optional<BYTES> response;
+    std::chrono::nanoseconds response_time{0};
+    // When the replay was due to send the request.
+    Clock::time_point due;
+};
+
+// A captured connection and the socket that replays it.
+struct Session {
+    std::vector<Exchange> exchanges;
+    std::size_t sent = 0;
+    std::size_t next_response = 0;
+    FileDescriptor socket{-1};
+    BYTES output;
+    std::size_t output_position = 0;
+    BYTES input;
+    bool writable_registered = false;
+    bool closed = false;
+};
+
+// Outcome of the replay per API.
+struct ApiReport {
+    LatencyHistogram captured;
+    LatencyHistogram replayed;
+    std::uint64_t requests = 0;
+    std::uint64_t matching = 0;
+    std::uint64_t differing = 0;
+    std::uint64_t missing = 0;
+    // Responses received to requests whose response the capture lacks.
+    std::uint64_t uncompared = 0;
+};
+
+struct Options {
+    std::string capture;
+    std::string host = "127.0.0.1";
+    INT32 port = 9092;
+    double speed = 1;
+    double timeout = 5;
+};
+
+template<typename T>
+void parse_number(std::string_view name, std::string_view text, T &value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw_runtime_error(std::format("invalid value of --{}: {}", name, text).c_str());
+    }
+}
+
+Options parse_options(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument(argv[i]);
+        auto equals = argument.find('=');
+        if (!argument.starts_with("--") || equals == std::string_view::npos) {
+            throw_runtime_error(std::format("unexpected argument: {}", argument).c_str());
+        }
+        std::string_view name = argument.substr(2, equals - 2);
+        std::string_view value = argument.substr(equals + 1);
+        if (name == "capture") {
+            options.capture = value;
+        } else if (name == "host") {
+            options.host = value;
+        } else if (name == "port") {
+            parse_number(name, value, options.port);
+        } else if (name == "speed") {
+            parse_number(name, value, options.speed);
+        } else if (name == "timeout") {
+            parse_number(name, value, options.timeout);
+        } else {
+            throw_runtime_error(std::format("unknown option: --{}", name).c_str());
+        }
+    }
+    if (options.capture.empty() || options.speed < 0) {
+        throw_runtime_error("--capture is required, and --speed must not be negative");
+    }
+    return options;
+}
+
+// Returns the end of the correlation ID in a frame, which follows the API key and version in a
+// request and starts a response.
+std::size_t correlation_id_end(CaptureDirection direction) {
+    return (direction == CaptureDirection::REQUEST ? 2 * sizeof(INT16) : 0) + sizeof(INT32);
+}
+
+INT32 correlation_id_of(const BYTES &frame, CaptureDirection direction) {
+    INT32 correlation_id;
+    std::memcpy(&correlation_id, frame.data() + correlation_id_end(direction) - sizeof(INT32), sizeof(correlation_id));
+    return to_host_byte_order(correlation_id);
+}
+
+// Reads a capture into its connections. Responses are matched to requests by correlation ID,
+// so that a frame the capture dropped does not shift the responses after it.
+std::map<std::uint32_t, Session> load_capture(const std::string &path) {
+    std::map<std::uint32_t, Session> sessions;
+    // The exchanges of each connection still waiting for a response, by correlation ID.
+    std::map<std::uint32_t, std::map<INT32, std::size_t>> awaiting;
+    CaptureReader reader(path);
+    while (auto frame = reader.next()) {
+        Session &session = sessions[frame->connection];
+        auto &session_awaiting = awaiting[frame->connection];
+        if (frame->bytes.size() < correlation_id_end(frame->direction)) {
+            throw_runtime_error(std::format("{} has a frame without a correlation ID", path).c_str());
+        }
+        INT32 correlation_id = correlation_id_of(frame->bytes, frame->direction);
+        if (frame->direction == CaptureDirection::REQUEST) {
+            session_awaiting[correlation_id] = session.exchanges.size();
+            session.exchanges.push_back({std::move(frame->bytes), frame->time, std::nullopt, {}, {}});
+        } else if (auto it = session_awaiting.find(correlation_id); it != session_awaiting.end()) {
+            Exchange &exchange = session.exchanges[it->second];
+            exchange.response = std::move(frame->bytes);
+            exchange.response_time = frame->time;
+            session_awaiting.erase(it);
+        }
+    }
+    return sessions;
+}
+
+INT16 api_key_of(const BYTES &request) {
+    INT16 api_key;
+    std::memcpy(&api_key, request.data(), sizeof(api_key));
+    return to_host_byte_order(api_key);
+}
+
+class Replayer {
+public:
+    Replayer(const Options &options, std::map<std::uint32_t, Session> &sessions)
+        : options_(options), sessions_(sessions), epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epoll_fd_.get() < 0) {
+            throw_system_error("epoll_create1");
+        }
+        for (auto &[connection, session] : sessions_) {
+            for (std::size_t i = 0; i < session.exchanges.size(); i++) {
+                const Exchange &exchange = session.exchanges[i];
+                ApiReport &report = reports_[api_key_of(exchange.request)];
+                report.requests++;
+                if (exchange.response) {
+                    report.captured.record(exchange.response_time - exchange.request_time);
+                }
+                schedule_.push_back({&session, i});
+            }
+        }
+        // Stable, so that the requests of a connection keep their order even at equal times.
+        std::ranges::stable_sort(schedule_, {}, [](const Scheduled &scheduled) {
+            return scheduled.session->exchanges[scheduled.index].request_time;
+        });
+    }
+
+    // Sends every request when due and waits for the responses, up to the timeout after the last
+    // request was sent.
+    void run() {
+        if (schedule_.empty()) {
+            return;
+        }
+        auto first = schedule_.front().session->exchanges[schedule_.front().index].request_time;
+        auto start = Clock::now();
+        auto due = [&](const Scheduled &scheduled) {
+            auto offset = scheduled.session->exchanges[scheduled.index].request_time - first;
+            if (options_.speed == 0) {
+                return start;
+            }
+            return start + std::chrono::duration_cast<Clock::duration>(offset / options_.speed);
+        };
+        std::size_t next = 0;
+        Clock::time_point deadline = Clock::time_point::max();
+        for (auto now = Clock::now(); outstanding_ > 0 || next < schedule_.size(); now = Clock::now()) {
+            while (next < schedule_.size() && due(schedule_[next]) <= now) {
+                send(schedule_[next], due(schedule_[next]));
+                next++;
+            }
+            flush();
+            Clock::time_point wake_up;
+            if (next < schedule_.size()) {
+                wake_up = due(schedule_[next]);
+            } else {
+                if (deadline == Clock::time_point::max()) {
+                    deadline = now + std::chrono::duration_cast<Clock::duration>(
+                                         std::chrono::duration<double>(options_.timeout));
+                }
+                if (now >= deadline) {
+                    break;
+                }
+                wake_up = deadline;
+            }
+            poll(wake_up - now);
+        }
+    }
+
+    // Returns the outcome per API, counting the requests left unanswered as missing.
+    const std::map<INT16, ApiReport> &report() {
+        for (const auto &[connection, session] : sessions_) {
+            for (std::size_t i = session.next_response; i < session.exchanges.size(); i++) {
+                reports_[api_key_of(session.exchanges[i].request)].missing++;
+            }
+        }
+        return reports_;
+    }
+
+private:
+    struct Scheduled {
+        Session *session;
+        std::size_t index;
+    };
+
+    const Options &options_;
+    std::map<std::uint32_t, Session> &sessions_;
+    FileDescriptor epoll_fd_;
+    std::vector<Scheduled> schedule_;
+    std::map<INT16, ApiReport> reports_;
+    std::size_t outstanding_ = 0;
+
+    void send(const Scheduled &scheduled, Clock::time_point due) {
+        Session &session = *scheduled.session;
+        if (session.closed) {
+            return;
+        }
+        if (session.socket.get() < 0) {
+            session.socket = loadgen::connect_to_server(options_.host, options_.port);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = &session;
+            if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, session.socket.get(), &event) != 0) {
+                throw_system_error("epoll_ctl");
+            }
+        }
+        Exchange &exchange = session.exchanges[scheduled.index];
+        exchange.due = due;
+        session.sent++;
+        INT32 size = to_network_byte_order(static_cast<INT32>(exchange.request.size()));
+        auto size_bytes = reinterpret_cast<const unsigned char *>(&size);
+        session.output.insert(session.output.end(), size_bytes, size_bytes + sizeof(size));
+        session.output.insert(session.output.end(), exchange.request.begin(), exchange.request.end());
+        outstanding_++;
+    }
+
+    // Writes the queued requests of every connection, waiting for the sockets that are full to
+    // become writable.
+    void flush() {
+        for (auto &[connection, session] : sessions_) {
+            while (!session.closed && session.output_position < session.output.size()) {
+                ssize_t n = ::send(session.socket.get(), session.output.data() + session.output_position,
+                                   session.output.size() - session.output_position, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        break;
+                    }
+                    close(session);
+                    break;
+                }
+                session.output_position += static_cast<std::size_t>(n);
+            }
+            if (session.output_position == session.output.size()) {
+                session.output.clear();
+                session.output_position = 0;
+            }
+            bool pending = !session.output.empty();
+            if (!session.closed && pending != session.writable_registered) {
+                epoll_event event{};
+                event.events = EPOLLIN | (pending ? static_cast<std::uint32_t>(EPOLLOUT) : std::uint32_t{0});
+                event.data.ptr = &session;
+                epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, session.socket.get(), &event);
+                session.writable_registered = pending;
+            }
+        }
+    }
+
+    // Waits up to `timeout` for responses and handles them.
+    void poll(Clock::duration timeout) {
+        auto nanoseconds = std::max<std::int64_t>(std::chrono::nanoseconds(timeout).count(), 0);
+        timespec ts{static_cast<time_t>(nanoseconds / 1'000'000'000), static_cast<long>(nanoseconds % 1'000'000'000)};
+        std::array<epoll_event, 64> events;
+        int n = epoll_pwait2(epoll_fd_.get(), events.data(), static_cast<int>(events.size()), &ts, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                return;
+            }
+            throw_system_error("epoll_pwait2");
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                receive(*static_cast<Session *>(events[i].data.ptr));
+            }
+        }
+    }
+
+    void receive(Session &session) {
+        constexpr std::size_t chunk_size = 64 * 1024;
+        bool closed = false;
+        while (true) {
+            std::size_t size = session.input.size();
+            session.input.resize(size + chunk_size);
+            ssize_t n = recv(session.socket.get(), session.input.data() + size, chunk_size, 0);
+            session.input.resize(size + static_cast<std::size_t>(std::max<ssize_t>(n, 0)));
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                closed = true;
+                break;
+            }
+            if (n < 0) {
+                break;
+            }
+        }
+
+        auto now = Clock::now();
+        std::size_t position = 0;
+        while (session.input.size() - position >= sizeof(INT32)) {
+            INT32 size;
+            std::memcpy(&size, session.input.data() + position, sizeof(size));
+            size = to_host_byte_order(size);
+            if (session.input.size() - position - sizeof(INT32) < static_cast<std::size_t>(size)) {
+                break;
+            }
+            auto response = session.input.begin() + static_cast<std::ptrdiff_t>(position + sizeof(INT32));
+            position += sizeof(INT32) + static_cast<std::size_t>(size);
+            if (session.next_response >= session.exchanges.size()) {
+                continue;
+            }
+            const Exchange &exchange = session.exchanges[session.next_response++];
+            outstanding_--;
+            ApiReport &report = reports_[api_key_of(exchange.request)];
+            report.replayed.record(now - exchange.due);
+            if (!exchange.response) {
+                report.uncompared++;
+            } else if (std::equal(response, response + size, exchange.response->begin(), exchange.response->end())) {
+                report.matching++;
+            } else {
+                report.differing++;
+            }
+        }
+        session.input.erase(session.input.begin(), session.input.begin() + static_cast<std::ptrdiff_t>(position));
+        if (closed) {
+            close(session);
+        }
+    }
+
+    // Stops replaying a connection the server closed; its requests left unanswered are missing.
+    void close(Session &session) {
+        if (session.closed) {
+            return;
+        }
+        session.closed = true;
+        epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, session.socket.get(), nullptr);
+        outstanding_ -= session.sent - session.next_response;
+    }
+};
+
+double milliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Prints the outcome per API, and returns whether every response matched the capture.
+bool print_report(const std::map<INT16, ApiReport> &reports) {
+    std::cout << std::format("{:<24} {:>8} {:>8} {:>8} {:>8} {:>10} {:>10} {:>10} {:>10}\n", "api", "requests",
+                             "matching", "differing", "missing", "capt p50", "capt p99", "repl p50", "repl p99");
+    bool all_matching = true;
+    for (const auto &[api_key, report] : reports) {
+        LatencyHistogram::Snapshot captured;
+        LatencyHistogram::Snapshot replayed;
+        report.captured.add_to(captured);
+        report.replayed.add_to(replayed);
+        std::cout << std::format("{:<24} {:>8} {:>8} {:>8} {:>8} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}\n",
+                                 api_name(static_cast<ApiKey>(api_key)), report.requests, report.matching,
+                                 report.differing, report.missing, milliseconds(captured.value_at_quantile(0.5)),
+                                 milliseconds(captured.value_at_quantile(0.99)),
+                                 milliseconds(replayed.value_at_quantile(0.5)),
+                                 milliseconds(replayed.value_at_quantile(0.99)));
+        if (report.uncompared > 0) {
+            std::cout << std::format("  {} responses not compared, as the capture lacks them\n", report.uncompared);
+        }
+        all_matching = all_matching && report.differing == 0 && report.missing == 0;
+    }
+    return all_matching;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << usage;
+        return 2;
+    }
+    try {
+        Options options = parse_options(argc, argv);
+        auto sessions = load_capture(options.capture);
+        Replayer replayer(options, sessions);
+        replayer.run();
+        return print_report(replayer.report()) ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << "kafka_replay: " << e.what() << '\n';
+        return 2;
+    }
+}